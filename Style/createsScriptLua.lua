@@ -189,7 +189,7 @@ function incGetValues(file, layoutProc)
   local inc = 0
   local auxName = ""
   local t = "function getValues(auxLayP)".. "\n" ..
-            "\t" .. "smt.mark_backtrack(m)".. "\n"
+            "\t" .. "local visible = {}".. "\n"
     
   for k,v in pairs(auxLayP) do
     for l,m in ipairs(v) do
@@ -197,9 +197,10 @@ function incGetValues(file, layoutProc)
         for i,j in ipairs(m.medias) do
           auxName = k .. "_" .. j._attr.id
           auxT1 = auxT1 .. "if auxLayP."..k.."["..i.."].medias["..i.."].value then".. "\n" ..
-                  "\t" .. "smt.assert(m, " .. auxName .. ".oc)".. "\n" ..
+                  "\t" .. "visible[#visible + 1] = " .. auxName .. ".oc".. "\n" ..
                 "else".. "\n" ..
-                  "\t" .."smt.assert(m, smt.lnot(f" .. auxName .. ".oc))".. "\n"
+                  "\t" .."visible[#visible + 1] = smt.lnot(" .. auxName .. ".oc)".. "\n" ..
+                "end".. "\n"
                   
           auxT2 = auxT2 .. "if auxLayP."..k.."["..i.."].medias["..i.."].value then".. "\n" ..
               "\t" .. "m:eval(" .. auxName .. ")" .. "\n" ..
@@ -212,7 +213,7 @@ function incGetValues(file, layoutProc)
     end
   end
   
-  t = t .. auxT1 .. "\t" .."print(m:check())".. "\n" .. auxT2 .. "\t" .."smt.backtrack(m)".. "\n" ..
+  t = t .. auxT1 .. "\t" .."print(m:check_assuming(visible))".. "\n" .. auxT2 ..
           "end" .. "\n\n"
              
   f = f .. t
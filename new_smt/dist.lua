@@ -4,7 +4,7 @@ local spatial = require('model.spatial')
 local item_size = {{20,20}, {30,30}, {40,40}, {50,50}, {20,20}}
 
 
-m = model:new{scenario = SCENARIO.S, x_size = 300, y_size = 100}
+m = model:new{scenario = SCENARIO.S, x_size = 300, y_size = 100, features = {}}
 m:init_document()
 
 -- create the items to be inside the flow
@@ -21,11 +21,10 @@ local sat = m:check()
 
 -- pretty print
 if sat then
-    m:eval(canvas)
+    m:eval_all{canvas, unpack(test_items)}
     print('Canvas x:[' .. canvas.xi.value .. ', ' .. canvas.xe.value .. ']  y:[' .. canvas.yi.value .. ', ' .. canvas.ye.value .. ']')
     
     for i,item in ipairs(test_items) do
-        m:eval(item)
         print('Item' .. i .. ' x:[' .. item.xi.value .. ', ' .. item.xe.value .. ']  y:[' .. item.yi.value .. ', ' .. item.ye.value .. ']')
     end
 else
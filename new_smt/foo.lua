@@ -25,6 +25,17 @@ layout = {
 }
 
 
+function read(path)
+    local file = io.open(path, 'rb')
+    if not file then
+        return ''
+    end
+    local s = file:read('*a')
+    file:close()
+    return s
+end
+
+
 function criaEvt(p, v)
     e1 = {}
     e1.class = 'ncl'
@@ -44,28 +55,48 @@ function criaEvt(p, v)
 end
 
 
-function getValues()
-    smt.mark_backtrack(m)
-    
-    -- create assertions
+function visibility()
+    local visible = {}
     if layout.arj.value then
-        smt.assert(m, f1.oc)
+        visible[#visible + 1] = f1.oc
     else
-        smt.assert(m, smt.lnot(f1.oc))
+        visible[#visible + 1] = smt.lnot(f1.oc)
     end
     if layout.apr.value then
-        smt.assert(m, f2.oc)
+        visible[#visible + 1] = f2.oc
     else
-        smt.assert(m, smt.lnot(f2.oc))
+        visible[#visible + 1] = smt.lnot(f2.oc)
     end
     if layout.atr.value then
-        smt.assert(m, f3.oc)
+        visible[#visible + 1] = f3.oc
     else
-        smt.assert(m, smt.lnot(f3.oc))
+        visible[#visible + 1] = smt.lnot(f3.oc)
+    end
+    return visible
+end
+
+
+function idle()
+    -- one state is solved per timer, so events are not delayed
+    if m and m:presolve() then
+        event.timer(0, idle)
     end
+end
+
+
+function speculate()
+    -- the layouts reached by the next event are solved in advance
+    m:speculate(visibility(), {f1, f2, f3})
+    event.timer(0, idle)
+end
+
+
+function getValues()
+    -- the visibility of the items is assumed in the check
+    local visible = visibility()
     
-    -- check the model
-    print(m:check())
+    -- check the model (the layout may have been solved in advance)
+    print(m:check_assuming(visible))
     
     -- evaluate and get value
     if layout.arj.value then
@@ -86,8 +117,6 @@ function getValues()
         print(layout.atr.position)
         criaEvt(layout.atr.prop,layout.atr.position)
     end
-    
-    smt.backtrack(m)
 end
 
 
@@ -96,32 +125,42 @@ function handler(evt)
     if (evt.type ~= 'presentation') then return end
     if evt.label == '' then
         if (evt.action == 'start') then
-            m = model:new()
-            m:init_document()
-
-            f1 = m:new_item{x_size = 240, y_size = 135}
-            f2 = m:new_item{x_size = 160, y_size = 90}
-            f3 = m:new_item{x_size = 80, y_size = 53}
-
-            local flow_canvas = {
-                name = "flow_canvas",
-                x_init = 0,
-                x_size = 600,
-                y_init = 0,
-                y_size = 400}
-            flow_canvas = m:flow(flow_canvas,
-                                 {f1,f2,f3},
-                                 10, 10,
-                                 model.FLOW_ALIGN.CENTER,
-                                 model.FLOW_ALIGN.CENTER,
-                                 model.FLOW_ALIGN.CENTER)
+            -- the constraints are reloaded from the cache if the
+            -- document and this script did not change
+            m = model:new{cache_dir = '.'}
+            local key = model.cache_key(read('main.ncl'), read('foo.lua'))
+            f1, f2, f3 = m:build(key, function (m)
+                m:init_document()
+
+                local f1 = m:new_item{x_size = 240, y_size = 135}
+                local f2 = m:new_item{x_size = 160, y_size = 90}
+                local f3 = m:new_item{x_size = 80, y_size = 53}
+
+                local flow_canvas = {
+                    name = "flow_canvas",
+                    x_init = 0,
+                    x_size = 600,
+                    y_init = 0,
+                    y_size = 400}
+                flow_canvas = m:flow(flow_canvas,
+                                     {f1,f2,f3},
+                                     10, 10,
+                                     model.FLOW_ALIGN.CENTER,
+                                     model.FLOW_ALIGN.CENTER,
+                                     model.FLOW_ALIGN.CENTER)
+                return f1, f2, f3
+            end)
+            m:check_assuming(visibility())
+            speculate()
         else
             m:end_document()
+            m = nil
         end
     else
 		-- criarStateTable
         layout[evt.label].value = (evt.action == 'start')
         getValues()
+        speculate()
         -- criaEvt(layout[evt.label].prop,layout[evt.label].position)
     end
 end
@@ -0,0 +1,101 @@
+/////////////////////////////////////////////////////////////////////
+// Operators of the expressions built by `compile_term`.
+// Shared by the `yices` module and by the replay driver.
+//
+// @module lib.operator
+// @author Joel dos Santos <joel@dossantos.cc>
+
+#ifndef L_OPERATOR_H
+#define L_OPERATOR_H
+
+#include <string.h>
+#include <yices.h>
+
+
+/////////////////////////////////////////////////////////////////////
+// The operators.
+enum {
+    L_OP_AND, L_OP_OR, L_OP_NOT, L_OP_IFF, L_OP_IMP, L_OP_ITE,
+    L_OP_EQ, L_OP_NE, L_OP_GE, L_OP_LE, L_OP_GT, L_OP_LT,
+    L_OP_SUM, L_OP_SUB, L_OP_MUL, L_OP_DIV, L_OP_NEG,
+    L_OP_DISTINCT, L_OP_APPLY
+};
+
+// names of the operators, in the order of the enum
+static const char *const l_operators[] = {
+        "and", "or", "not", "iff", "imp", "ite",
+        "eq", "ne", "ge", "le", "gt", "lt",
+        "sum", "sub", "mul", "div", "neg",
+        "distinct", "apply", NULL
+};
+
+// number of operands of the operators (-1 for one or more)
+static const int l_operator_arity[] = {
+        -1, -1, 1, 2, 2, 3,
+        2, 2, 2, 2, 2, 2,
+        -1, 2, 2, 2, 1,
+        -1, -1
+};
+
+
+/////////////////////////////////////////////////////////////////////
+// Finds an operator by name.
+//
+// @function l_find_operator
+// @local here
+// @tparam const char* name Name of the operator.
+// @tparam size_t n Number of operands.
+//
+// @treturn int The operator, -1 if there is no operator with that
+// name and -2 if it does not take `n` operands.
+static int l_find_operator(const char *name, size_t n) {
+    int op;
+    for(op = 0; l_operators[op] != NULL; op++)
+        if(strcmp(l_operators[op], name) == 0)
+            break;
+
+    if(l_operators[op] == NULL)
+        return -1;
+    if(n == 0 || (l_operator_arity[op] >= 0 && n != (size_t) l_operator_arity[op]))
+        return -2;
+    return op;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Applies an operator to the terms of its operands. Builds the same
+// term as the function of the binding with the same name.
+//
+// @function l_apply_operator
+// @local here
+// @tparam int op The operator.
+// @tparam uint32_t n Number of operands.
+// @tparam term_t* t The operands.
+//
+// @treturn term_t The term or `NULL_TERM` on error.
+static term_t l_apply_operator(int op, uint32_t n, term_t *t) {
+    switch(op) {
+        case L_OP_AND: return yices_and(n, t);
+        case L_OP_OR: return yices_or(n, t);
+        case L_OP_NOT: return yices_not(t[0]);
+        case L_OP_IFF: return yices_iff(t[0], t[1]);
+        case L_OP_IMP: return yices_implies(t[0], t[1]);
+        case L_OP_ITE: return yices_ite(t[0], t[1], t[2]);
+        case L_OP_EQ: return yices_arith_eq_atom(t[0], t[1]);
+        case L_OP_NE: return yices_arith_neq_atom(t[0], t[1]);
+        case L_OP_GE: return yices_arith_geq_atom(t[0], t[1]);
+        case L_OP_LE: return yices_arith_leq_atom(t[0], t[1]);
+        case L_OP_GT: return yices_arith_gt_atom(t[0], t[1]);
+        case L_OP_LT: return yices_arith_lt_atom(t[0], t[1]);
+        case L_OP_SUM: return yices_sum(n, t);
+        case L_OP_SUB: return yices_sub(t[0], t[1]);
+        case L_OP_MUL: return yices_mul(t[0], t[1]);
+        case L_OP_DIV: return yices_division(t[0], t[1]);
+        case L_OP_NEG: return yices_neg(t[0]);
+        case L_OP_DISTINCT: return yices_distinct(n, t);
+        case L_OP_APPLY: return yices_application(t[0], n - 1, t + 1);
+        default: return NULL_TERM;
+    }
+}
+
+#endif
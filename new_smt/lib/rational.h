@@ -0,0 +1,63 @@
+/////////////////////////////////////////////////////////////////////
+// Conversion of numbers to Yices constant terms.
+// Shared by the `yices` module and by the replay driver, so a
+// replayed trace creates the same constants as the recorded run.
+//
+// @module lib.rational
+// @author Joel dos Santos <joel@dossantos.cc>
+
+#ifndef L_RATIONAL_H
+#define L_RATIONAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <yices.h>
+
+
+/////////////////////////////////////////////////////////////////////
+// Converts a double to the rational constant with exactly the same
+// value.
+//
+// A finite double is `m / 2^k`, with an integer mantissa `m`. When
+// the reduced fraction fits in 64 bits it is built directly,
+// otherwise (integers above 2^63 or denominators above 2^63) the
+// exact decimal expansion of the double, as printed by glibc, is
+// parsed.
+//
+// @function l_double_term
+// @local here
+// @tparam double val Number to be converted.
+//
+// @treturn term_t The constant or `NULL_TERM` if `val` is not finite.
+static term_t l_double_term(double val) {
+    if(isnan(val) || isinf(val))
+        return NULL_TERM;
+
+    char buf[1200];
+    if(val == floor(val)) {
+        if(fabs(val) < 9.2e18)
+            return yices_int64((int64_t) val);
+
+        snprintf(buf, sizeof(buf), "%.0f", val);
+        return yices_parse_float(buf);
+    }
+
+    // val = num / 2^k, with num holding the 53 bits of the mantissa
+    int exp;
+    int64_t num = (int64_t) ldexp(frexp(val, &exp), 53);
+    int k = 53 - exp;
+    while(num % 2 == 0) {
+        num /= 2;
+        k--;
+    }
+
+    if(k < 64)
+        return yices_rational64(num, (uint64_t) 1 << k);
+
+    // k fractional digits represent num / 2^k exactly
+    snprintf(buf, sizeof(buf), "%.*f", k, val);
+    return yices_parse_float(buf);
+}
+
+#endif
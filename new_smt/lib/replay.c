@@ -0,0 +1,1210 @@
+/////////////////////////////////////////////////////////////////////
+// Replay driver for the binding call traces.
+// Re-executes a trace recorded by the `yices` module (see
+// `trace_start`) against libyices, without Lua, and reports the
+// recorded and replayed time of the calls.
+//
+// Terms, types and handles are mapped from the recorded identifiers
+// to the replayed ones, so a trace may be replayed with another
+// Yices version. The configuration of the contexts and the search
+// parameters of the checks may be changed from the command line.
+// Time limits of the checks are not enforced when replaying.
+//
+// @module lib.replay
+// @usage
+//    gcc -o replay lib/replay.c -lyices -lm
+//    ./replay [-v] [-c name=value]... [-p name=value]... trace
+// @author Joel dos Santos <joel@dossantos.cc>
+
+
+// clock_gettime and the POSIX clocks are not declared by strict C99
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <yices.h>
+#include "trace.h"
+#include "rational.h"
+#include "operator.h"
+
+
+/////////////////////////////////////////////////////////////////////
+// Whether Yices checks a context under assumptions (since 2.6).
+#define R_NATIVE_ASSUMPTIONS (__YICES_VERSION > 2 || __YICES_VERSION_MAJOR >= 6)
+
+/////////////////////////////////////////////////////////////////////
+// Maximum number of arguments or results of a call.
+#define R_MAX_VALUES 8
+
+
+/////////////////////////////////////////////////////////////////////
+// Value read from a trace.
+//
+// @field tag Tag of the value.
+// @field number Value of a number or boolean.
+// @field size Length of a string, array or table, number of options,
+// number of elements of an expression or identifier of a handle.
+// @field string Bytes of a string or error message.
+// @field array Elements of an array.
+// @field options Fields of an options table.
+// @field operands Operands of an expression, whose operator is in
+// `string`.
+typedef struct r_value_s {
+    uint8_t tag;
+    double number;
+    uint32_t size;
+    char *string;
+    int32_t *array;
+    struct r_option_s *options;
+    struct r_value_s *operands;
+} r_value_t;
+
+
+/////////////////////////////////////////////////////////////////////
+// Field of an options table.
+//
+// @field name Name of the field.
+// @field value Value of the field.
+typedef struct r_option_s {
+    char *name;
+    r_value_t value;
+} r_option_t;
+
+
+/////////////////////////////////////////////////////////////////////
+// Call read from a trace.
+//
+// @field op Index of the function in the trace header.
+// @field n_args Number of arguments.
+// @field args The arguments.
+// @field n_results Number of results.
+// @field results The results.
+// @field elapsed Recorded wall time, in nanoseconds.
+typedef struct r_record_s {
+    uint16_t op;
+    uint8_t n_args;
+    r_value_t args[R_MAX_VALUES];
+    uint8_t n_results;
+    r_value_t results[R_MAX_VALUES];
+    uint64_t elapsed;
+} r_record_t;
+
+
+/////////////////////////////////////////////////////////////////////
+// Context, model or configuration created during the replay.
+//
+// @field ptr Pointer to the object.
+// @field assuming Whether a context has an open backtracking point
+// holding the assumptions of its last check.
+typedef struct r_handle_s {
+    void *ptr;
+    bool assuming;
+} r_handle_t;
+
+
+/////////////////////////////////////////////////////////////////////
+// State of the replay.
+//
+// @field terms Replayed term of each recorded term.
+// @field types Replayed type of each recorded type.
+// @field handles Replayed object of each recorded handle.
+// @field buffer Buffer for arrays of terms or types.
+// @field config Configuration parameters given in the command line.
+// @field params Search parameters given in the command line.
+// @field mismatches Number of checks with a different result.
+// @field failures Number of calls that failed only when replayed.
+typedef struct r_state_s {
+    term_t *terms;
+    uint32_t n_terms;
+    type_t *types;
+    uint32_t n_types;
+    r_handle_t *handles;
+    uint32_t n_handles;
+    int32_t *buffer;
+    uint32_t n_buffer;
+    char **config;
+    int n_config;
+    char **params;
+    int n_params;
+    unsigned int mismatches;
+    unsigned int failures;
+} r_state_t;
+
+
+/////////////////////////////////////////////////////////////////////
+// Handler replaying a call.
+//
+// @tparam r_state_t* r The replay state.
+// @tparam r_record_t* rec The call.
+//
+// @treturn int Zero if the call succeeded.
+typedef int (*r_handler_t)(r_state_t *r, r_record_t *rec);
+
+
+/////////////////////////////////////////////////////////////////////
+// Timing of a function of the binding.
+//
+// @field name Name of the function.
+// @field handler Handler replaying the function or `NULL` if the
+// function is not supported.
+// @field calls Number of calls.
+// @field recorded Total recorded time, in nanoseconds.
+// @field replayed Total replayed time, in nanoseconds.
+// @field max Maximum replayed time of a call, in nanoseconds.
+typedef struct r_op_s {
+    char name[256];
+    r_handler_t handler;
+    unsigned long calls;
+    uint64_t recorded;
+    uint64_t replayed;
+    uint64_t max;
+} r_op_t;
+
+
+/////////////////////////////////////////////////////////////////////
+// Grows an array to hold at least `n` elements.
+//
+// @function r_grow
+// @local here
+// @tparam void** data Pointer to the array.
+// @tparam uint32_t* size Pointer to the number of elements.
+// @tparam uint32_t n Number of elements needed.
+// @tparam size_t elem Size of an element.
+// @tparam int fill Byte used for the new elements.
+static void r_grow(void **data, uint32_t *size, uint32_t n, size_t elem, int fill) {
+    if(n <= *size)
+        return;
+
+    uint32_t new_size = *size < 64 ? 64 : *size;
+    while(new_size < n)
+        new_size *= 2;
+    *data = realloc(*data, new_size * elem);
+    if(*data == NULL) {
+        fprintf(stderr, "replay: not enough memory\n");
+        exit(1);
+    }
+    memset((char *) *data + *size * elem, fill, (new_size - *size) * elem);
+    *size = new_size;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Reads raw data from the trace.
+//
+// @function r_read
+// @local here
+// @tparam FILE* f The trace.
+// @tparam void* data Where to store the data.
+// @tparam size_t size Size of the data.
+//
+// @treturn int Zero if the data was read.
+static int r_read(FILE *f, void *data, size_t size) {
+    return size == 0 || fread(data, size, 1, f) == 1 ? 0 : -1;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Reads a string payload from the trace. The string is terminated
+// by a NUL byte.
+//
+// @function r_read_string
+// @local here
+// @tparam FILE* f The trace.
+// @tparam uint32_t* len Where to store the length of the string.
+//
+// @treturn char* The string or `NULL` on error.
+static char * r_read_string(FILE *f, uint32_t *len) {
+    if(r_read(f, len, sizeof(*len)) != 0)
+        return NULL;
+
+    char *str = (char *) malloc(*len + 1);
+    if(str == NULL || r_read(f, str, *len) != 0) {
+        free(str);
+        return NULL;
+    }
+    str[*len] = '\0';
+    return str;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Reads a tagged value from the trace.
+//
+// @function r_read_value
+// @local here
+// @tparam FILE* f The trace.
+// @tparam r_value_t* v Where to store the value.
+//
+// @treturn int Zero if the value was read.
+static int r_read_value(FILE *f, r_value_t *v) {
+    memset(v, 0, sizeof(*v));
+    if(r_read(f, &v->tag, 1) != 0)
+        return -1;
+
+    switch(v->tag) {
+        case L_TRACE_NIL:
+            return 0;
+
+        case L_TRACE_BOOL: {
+            uint8_t b;
+            if(r_read(f, &b, 1) != 0)
+                return -1;
+            v->number = b;
+            return 0;
+        }
+
+        case L_TRACE_NUMBER:
+            return r_read(f, &v->number, sizeof(v->number));
+
+        case L_TRACE_STRING:
+        case L_TRACE_ERROR:
+            v->string = r_read_string(f, &v->size);
+            return v->string != NULL ? 0 : -1;
+
+        case L_TRACE_ARRAY:
+            if(r_read(f, &v->size, sizeof(v->size)) != 0)
+                return -1;
+            v->array = (int32_t *) malloc((v->size + 1) * sizeof(int32_t));
+            return v->array != NULL ? r_read(f, v->array, v->size * sizeof(int32_t)) : -1;
+
+        case L_TRACE_OPTIONS: {
+            if(r_read(f, &v->size, sizeof(v->size)) != 0)
+                return -1;
+            v->options = (r_option_t *) calloc(v->size + 1, sizeof(r_option_t));
+            if(v->options == NULL)
+                return -1;
+            uint32_t i, len;
+            for(i = 0; i < v->size; i++) {
+                v->options[i].name = r_read_string(f, &len);
+                if(v->options[i].name == NULL || r_read_value(f, &v->options[i].value) != 0)
+                    return -1;
+            }
+            return 0;
+        }
+
+        case L_TRACE_HANDLE:
+        case L_TRACE_TABLE:
+            return r_read(f, &v->size, sizeof(v->size));
+
+        case L_TRACE_TERM: {
+            int32_t t;
+            if(r_read(f, &t, sizeof(t)) != 0)
+                return -1;
+            v->number = t;
+            return 0;
+        }
+
+        case L_TRACE_EXPRESSION: {
+            uint32_t i, len;
+            if(r_read(f, &v->size, sizeof(v->size)) != 0 || v->size == 0)
+                return -1;
+            v->string = r_read_string(f, &len);
+            v->operands = (r_value_t *) calloc(v->size, sizeof(r_value_t));
+            if(v->string == NULL || v->operands == NULL)
+                return -1;
+            for(i = 0; i < v->size - 1; i++)
+                if(r_read_value(f, &v->operands[i]) != 0)
+                    return -1;
+            return 0;
+        }
+
+        default:
+            return -1;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Frees the memory used by a value.
+//
+// @function r_free_value
+// @local here
+// @tparam r_value_t* v The value.
+static void r_free_value(r_value_t *v) {
+    free(v->string);
+    free(v->array);
+    if(v->options != NULL) {
+        uint32_t i;
+        for(i = 0; i < v->size; i++) {
+            free(v->options[i].name);
+            r_free_value(&v->options[i].value);
+        }
+        free(v->options);
+    }
+    if(v->operands != NULL) {
+        uint32_t i;
+        for(i = 0; i < v->size - 1; i++)
+            r_free_value(&v->operands[i]);
+        free(v->operands);
+    }
+    memset(v, 0, sizeof(*v));
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Reads a call from the trace.
+//
+// @function r_read_record
+// @local here
+// @tparam FILE* f The trace.
+// @tparam r_record_t* rec Where to store the call.
+//
+// @treturn int Zero if a call was read, 1 at the end of the trace
+// and -1 if the trace is corrupted.
+static int r_read_record(FILE *f, r_record_t *rec) {
+    memset(rec, 0, sizeof(*rec));
+    if(r_read(f, &rec->op, sizeof(rec->op)) != 0)
+        return 1;
+
+    int i;
+    if(r_read(f, &rec->n_args, 1) != 0 || rec->n_args > R_MAX_VALUES)
+        return -1;
+    for(i = 0; i < rec->n_args; i++)
+        if(r_read_value(f, &rec->args[i]) != 0)
+            return -1;
+
+    if(r_read(f, &rec->n_results, 1) != 0 || rec->n_results > R_MAX_VALUES)
+        return -1;
+    for(i = 0; i < rec->n_results; i++)
+        if(r_read_value(f, &rec->results[i]) != 0)
+            return -1;
+
+    return r_read(f, &rec->elapsed, sizeof(rec->elapsed));
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Frees the memory used by a call.
+//
+// @function r_free_record
+// @local here
+// @tparam r_record_t* rec The call.
+static void r_free_record(r_record_t *rec) {
+    int i;
+    for(i = 0; i < R_MAX_VALUES; i++) {
+        r_free_value(&rec->args[i]);
+        r_free_value(&rec->results[i]);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Functions mapping recorded identifiers to replayed ones.
+
+// Gets the replayed term of a recorded term argument.
+static term_t r_term(r_state_t *r, r_record_t *rec, int i) {
+    int32_t t = (int32_t) rec->args[i].number;
+    if(t >= 0 && (uint32_t) t < r->n_terms && r->terms[t] != NULL_TERM)
+        return r->terms[t];
+    return t;
+}
+
+// Gets the replayed type of a recorded type argument.
+static type_t r_type(r_state_t *r, r_record_t *rec, int i) {
+    int32_t t = (int32_t) rec->args[i].number;
+    if(t >= 0 && (uint32_t) t < r->n_types && r->types[t] != NULL_TYPE)
+        return r->types[t];
+    return t;
+}
+
+// Gets the replayed terms (or types) of a recorded array argument.
+static int32_t * r_array(r_state_t *r, r_record_t *rec, int i, bool types) {
+    r_value_t *v = &rec->args[i];
+    r_grow((void **) &r->buffer, &r->n_buffer, v->size, sizeof(int32_t), 0);
+
+    uint32_t k;
+    for(k = 0; k < v->size; k++) {
+        int32_t t = v->array[k];
+        if(types)
+            r->buffer[k] = t >= 0 && (uint32_t) t < r->n_types && r->types[t] != NULL_TYPE ? r->types[t] : t;
+        else
+            r->buffer[k] = t >= 0 && (uint32_t) t < r->n_terms && r->terms[t] != NULL_TERM ? r->terms[t] : t;
+    }
+    return r->buffer;
+}
+
+// Gets the replayed object of a recorded handle argument.
+static r_handle_t * r_handle(r_state_t *r, r_record_t *rec, int i) {
+    r_value_t *v = &rec->args[i];
+    if(i >= rec->n_args || v->tag != L_TRACE_HANDLE || v->size >= r->n_handles)
+        return NULL;
+    return &r->handles[v->size];
+}
+
+// Gets the replayed object of a recorded handle argument, or NULL.
+static void * r_ptr(r_state_t *r, r_record_t *rec, int i) {
+    r_handle_t *h = r_handle(r, rec, i);
+    return h != NULL ? h->ptr : NULL;
+}
+
+// Stores the replayed term of the recorded result.
+static int r_set_term(r_state_t *r, r_record_t *rec, term_t t) {
+    if(t == NULL_TERM)
+        return -1;
+    if(rec->n_results > 0 && rec->results[0].tag == L_TRACE_NUMBER) {
+        uint32_t id = (uint32_t) rec->results[0].number;
+        r_grow((void **) &r->terms, &r->n_terms, id + 1, sizeof(term_t), 0xff);
+        r->terms[id] = t;
+    }
+    return 0;
+}
+
+// Stores the replayed type of the recorded result.
+static int r_set_type(r_state_t *r, r_record_t *rec, type_t t) {
+    if(t == NULL_TYPE)
+        return -1;
+    if(rec->n_results > 0 && rec->results[0].tag == L_TRACE_NUMBER) {
+        uint32_t id = (uint32_t) rec->results[0].number;
+        r_grow((void **) &r->types, &r->n_types, id + 1, sizeof(type_t), 0xff);
+        r->types[id] = t;
+    }
+    return 0;
+}
+
+// Stores the replayed object of the recorded result.
+static int r_set_handle(r_state_t *r, r_record_t *rec, void *ptr) {
+    if(ptr == NULL)
+        return -1;
+    if(rec->n_results > 0 && rec->results[0].tag == L_TRACE_HANDLE) {
+        uint32_t id = rec->results[0].size;
+        r_grow((void **) &r->handles, &r->n_handles, id + 1, sizeof(r_handle_t), 0);
+        r->handles[id].ptr = ptr;
+        r->handles[id].assuming = false;
+    }
+    return 0;
+}
+
+// Gets a string argument, formatting numbers as Lua does.
+static const char * r_string(r_record_t *rec, int i, char *buf, size_t size) {
+    r_value_t *v = &rec->args[i];
+    if(v->tag == L_TRACE_STRING)
+        return v->string;
+    if(v->tag == L_TRACE_NUMBER) {
+        snprintf(buf, size, "%.14g", v->number);
+        return buf;
+    }
+    return NULL;
+}
+
+// Drops the assumptions of the last check of a context.
+static context_t * r_idle_context(r_record_t *rec, r_handle_t *h) {
+    (void) rec;
+    if(h == NULL)
+        return NULL;
+    if(h->assuming) {
+        h->assuming = false;
+        yices_pop((context_t *) h->ptr);
+    }
+    return (context_t *) h->ptr;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Applies `name=value` pairs to a configuration or parameter record.
+//
+// @function r_apply
+// @local here
+// @tparam char** pairs The pairs.
+// @tparam int n Number of pairs.
+// @tparam ctx_config_t* config Configuration to change, or `NULL`.
+// @tparam param_t* params Parameter record to change, or `NULL`.
+static void r_apply(char **pairs, int n, ctx_config_t *config, param_t *params) {
+    int i;
+    for(i = 0; i < n; i++) {
+        char name[256];
+        const char *eq = strchr(pairs[i], '=');
+        size_t len = eq - pairs[i];
+        if(len >= sizeof(name))
+            len = sizeof(name) - 1;
+        memcpy(name, pairs[i], len);
+        name[len] = '\0';
+
+        if(config != NULL && strcmp(name, "logic") == 0)
+            yices_default_config_for_logic(config, eq + 1);
+        else if(config != NULL)
+            yices_set_config(config, name, eq + 1);
+        else
+            yices_set_param(params, name, eq + 1);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Creates the parameter record of a check from its recorded options
+// and the command line parameters.
+//
+// @function r_params
+// @local here
+// @tparam r_state_t* r The replay state.
+// @tparam r_record_t* rec The call.
+// @tparam int i Index of the options argument.
+//
+// @treturn param_t* The parameter record or `NULL` if no parameter is set.
+static param_t * r_params(r_state_t *r, r_record_t *rec, int i) {
+    r_value_t *v = &rec->args[i];
+    bool recorded = i < rec->n_args && v->tag == L_TRACE_OPTIONS;
+    if(!recorded && r->n_params == 0)
+        return NULL;
+
+    param_t *params = yices_new_param_record();
+    if(recorded) {
+        uint32_t k;
+        for(k = 0; k < v->size; k++) {
+            r_option_t *o = &v->options[k];
+            char buf[64];
+            const char *value = NULL;
+            if(strcmp(o->name, "timeout_ms") == 0)
+                continue;
+            if(o->value.tag == L_TRACE_BOOL)
+                value = o->value.number ? "true" : "false";
+            else if(o->value.tag == L_TRACE_STRING)
+                value = o->value.string;
+            else if(o->value.tag == L_TRACE_NUMBER) {
+                snprintf(buf, sizeof(buf), "%.14g", o->value.number);
+                value = buf;
+            }
+            if(value != NULL)
+                yices_set_param(params, o->name, value);
+        }
+    }
+    r_apply(r->params, r->n_params, NULL, params);
+
+    return params;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Compares the result of a check with the recorded one.
+//
+// @function r_status
+// @local here
+// @tparam r_state_t* r The replay state.
+// @tparam r_record_t* rec The call.
+// @tparam smt_status_t status Result of the replayed check.
+//
+// @treturn int Zero if the check succeeded.
+static int r_status(r_state_t *r, r_record_t *rec, smt_status_t status) {
+    if(status == STATUS_ERROR)
+        return -1;
+
+    r_value_t *v = &rec->results[0];
+    int recorded = v->tag == L_TRACE_BOOL ? (v->number ? STATUS_SAT : STATUS_UNSAT) : -1;
+    int replayed = status == STATUS_SAT || status == STATUS_UNSAT ? (int) status : -1;
+    if(recorded != replayed)
+        r->mismatches++;
+
+    return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Handlers of the functions of the binding.
+
+static int r_init(r_state_t *r, r_record_t *rec) {
+    (void) r; (void) rec;
+    yices_init();
+    return 0;
+}
+
+static int r_exit(r_state_t *r, r_record_t *rec) {
+    (void) rec;
+    yices_exit();
+
+    // everything created by the solver was deleted
+    memset(r->terms, 0xff, r->n_terms * sizeof(term_t));
+    memset(r->types, 0xff, r->n_types * sizeof(type_t));
+    memset(r->handles, 0, r->n_handles * sizeof(r_handle_t));
+    return 0;
+}
+
+static int r_new_config(r_state_t *r, r_record_t *rec) {
+    return r_set_handle(r, rec, yices_new_config());
+}
+
+static int r_free_config(r_state_t *r, r_record_t *rec) {
+    r_handle_t *h = r_handle(r, rec, 0);
+    if(h == NULL || h->ptr == NULL)
+        return -1;
+    yices_free_config((ctx_config_t *) h->ptr);
+    h->ptr = NULL;
+    return 0;
+}
+
+static int r_set_config(r_state_t *r, r_record_t *rec) {
+    char buf[64];
+    const char *value = r_string(rec, 2, buf, sizeof(buf));
+    return yices_set_config((ctx_config_t *) r_ptr(r, rec, 0), rec->args[1].string, value);
+}
+
+static int r_default_config_for_logic(r_state_t *r, r_record_t *rec) {
+    return yices_default_config_for_logic((ctx_config_t *) r_ptr(r, rec, 0), rec->args[1].string);
+}
+
+static int r_new_context(r_state_t *r, r_record_t *rec) {
+    ctx_config_t *config = (ctx_config_t *) r_ptr(r, rec, 0);
+    ctx_config_t *own = NULL;
+
+    if(r->n_config > 0) {
+        if(config == NULL)
+            config = own = yices_new_config();
+        r_apply(r->config, r->n_config, config, NULL);
+    }
+
+    context_t *context = yices_new_context(config);
+    if(own != NULL)
+        yices_free_config(own);
+    return r_set_handle(r, rec, context);
+}
+
+static int r_free_context(r_state_t *r, r_record_t *rec) {
+    r_handle_t *h = r_handle(r, rec, 0);
+    if(h == NULL || h->ptr == NULL)
+        return -1;
+    yices_free_context((context_t *) h->ptr);
+    h->ptr = NULL;
+    return 0;
+}
+
+static int r_push(r_state_t *r, r_record_t *rec) {
+    return yices_push(r_idle_context(rec, r_handle(r, rec, 0)));
+}
+
+static int r_pop(r_state_t *r, r_record_t *rec) {
+    return yices_pop(r_idle_context(rec, r_handle(r, rec, 0)));
+}
+
+static int r_int_type(r_state_t *r, r_record_t *rec) {
+    return r_set_type(r, rec, yices_int_type());
+}
+
+static int r_real_type(r_state_t *r, r_record_t *rec) {
+    return r_set_type(r, rec, yices_real_type());
+}
+
+static int r_bool_type(r_state_t *r, r_record_t *rec) {
+    return r_set_type(r, rec, yices_bool_type());
+}
+
+static int r_function_type(r_state_t *r, r_record_t *rec) {
+    return r_set_type(r, rec, yices_function_type(rec->args[0].size, r_array(r, rec, 0, true), r_type(r, rec, 1)));
+}
+
+static int r_parse_type(r_state_t *r, r_record_t *rec) {
+    return r_set_type(r, rec, yices_parse_type(rec->args[0].string));
+}
+
+static int r_new_term(r_state_t *r, r_record_t *rec) {
+    term_t t = yices_new_uninterpreted_term(r_type(r, rec, 0));
+    if(t != NULL_TERM && rec->n_args > 1 && rec->args[1].tag == L_TRACE_STRING)
+        yices_set_term_name(t, rec->args[1].string);
+    return r_set_term(r, rec, t);
+}
+
+static int r_int_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_int64((int64_t) rec->args[0].number));
+}
+
+static int r_real_term(r_state_t *r, r_record_t *rec) {
+    if(rec->args[0].tag == L_TRACE_NUMBER)
+        return r_set_term(r, rec, l_double_term(rec->args[0].number));
+    return r_set_term(r, rec, yices_parse_float(rec->args[0].string));
+}
+
+static int r_neg_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_neg(r_term(r, rec, 0)));
+}
+
+static int r_sum_terms(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_sum(rec->args[0].size, r_array(r, rec, 0, false)));
+}
+
+static int r_sub_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_sub(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_mul_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_mul(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_div_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_division(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_pow_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_power(r_term(r, rec, 0), (uint32_t) rec->args[1].number));
+}
+
+static int r_eq_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_arith_eq_atom(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_ne_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_arith_neq_atom(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_ge_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_arith_geq_atom(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_le_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_arith_leq_atom(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_gt_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_arith_gt_atom(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_lt_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_arith_lt_atom(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_const_true(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_true());
+}
+
+static int r_const_false(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_false());
+}
+
+static int r_not_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_not(r_term(r, rec, 0)));
+}
+
+static int r_and_terms(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_and(rec->args[0].size, r_array(r, rec, 0, false)));
+}
+
+static int r_or_terms(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_or(rec->args[0].size, r_array(r, rec, 0, false)));
+}
+
+static int r_iff_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_iff(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_imp_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_implies(r_term(r, rec, 0), r_term(r, rec, 1)));
+}
+
+static int r_ite_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_ite(r_term(r, rec, 0), r_term(r, rec, 1), r_term(r, rec, 2)));
+}
+
+static int r_distinct_terms(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_distinct(rec->args[0].size, r_array(r, rec, 0, false)));
+}
+
+static int r_apply_function(r_state_t *r, r_record_t *rec) {
+    term_t fun = r_term(r, rec, 0);
+    return r_set_term(r, rec, yices_application(fun, rec->args[1].size, r_array(r, rec, 1, false)));
+}
+
+// Builds the term of an expression, as `compile_term` does.
+static term_t r_compile(r_state_t *r, r_value_t *v) {
+    switch(v->tag) {
+        case L_TRACE_NUMBER:
+            return l_double_term(v->number);
+
+        case L_TRACE_BOOL:
+            return v->number ? yices_true() : yices_false();
+
+        case L_TRACE_TERM: {
+            int32_t t = (int32_t) v->number;
+            return t >= 0 && (uint32_t) t < r->n_terms && r->terms[t] != NULL_TERM ? r->terms[t] : t;
+        }
+
+        case L_TRACE_EXPRESSION: {
+            uint32_t i, n = v->size - 1;
+            int op = l_find_operator(v->string, n);
+            if(op < 0)
+                return NULL_TERM;
+
+            term_t *t = (term_t *) malloc(n * sizeof(term_t));
+            term_t term = NULL_TERM;
+            for(i = 0; i < n; i++)
+                if((t[i] = r_compile(r, &v->operands[i])) == NULL_TERM)
+                    break;
+            if(i == n)
+                term = l_apply_operator(op, n, t);
+            free(t);
+            return term;
+        }
+
+        default:
+            return NULL_TERM;
+    }
+}
+
+static int r_compile_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, r_compile(r, &rec->args[0]));
+}
+
+static int r_parse_term(r_state_t *r, r_record_t *rec) {
+    return r_set_term(r, rec, yices_parse_term(rec->args[0].string));
+}
+
+static int r_get_term_by_name(r_state_t *r, r_record_t *rec) {
+    term_t t = yices_get_term_by_name(rec->args[0].string);
+    return t == NULL_TERM ? 0 : r_set_term(r, rec, t);
+}
+
+static int r_term_to_string(r_state_t *r, r_record_t *rec) {
+    char *str = yices_term_to_string(r_term(r, rec, 0), UINT32_MAX, UINT32_MAX, 0);
+    if(str == NULL)
+        return -1;
+    yices_free_string(str);
+    return 0;
+}
+
+static int r_type_to_string(r_state_t *r, r_record_t *rec) {
+    char *str = yices_type_to_string(r_type(r, rec, 0), UINT32_MAX, UINT32_MAX, 0);
+    if(str == NULL)
+        return -1;
+    yices_free_string(str);
+    return 0;
+}
+
+static int r_assert_formula(r_state_t *r, r_record_t *rec) {
+    context_t *context = r_idle_context(rec, r_handle(r, rec, 0));
+    return yices_assert_formula(context, r_term(r, rec, 1));
+}
+
+static int r_assert_formulas(r_state_t *r, r_record_t *rec) {
+    context_t *context = r_idle_context(rec, r_handle(r, rec, 0));
+    return yices_assert_formulas(context, rec->args[1].size, r_array(r, rec, 1, false));
+}
+
+static int r_check_context(r_state_t *r, r_record_t *rec) {
+    context_t *context = r_idle_context(rec, r_handle(r, rec, 0));
+    param_t *params = r_params(r, rec, 1);
+    smt_status_t status = yices_check_context(context, params);
+    if(params != NULL)
+        yices_free_param_record(params);
+    return r_status(r, rec, status);
+}
+
+static int r_check_with_assumptions(r_state_t *r, r_record_t *rec) {
+    r_handle_t *h = r_handle(r, rec, 0);
+    context_t *context = r_idle_context(rec, h);
+    int32_t *t = r_array(r, rec, 1, false);
+    param_t *params = r_params(r, rec, 2);
+    smt_status_t status;
+
+#if R_NATIVE_ASSUMPTIONS
+    status = yices_check_context_with_assumptions(context, params, rec->args[1].size, t);
+#else
+    // same emulation as the binding
+    status = STATUS_ERROR;
+    if(yices_push(context) == 0) {
+        h->assuming = true;
+        if(yices_assert_formulas(context, rec->args[1].size, t) == 0)
+            status = yices_check_context(context, params);
+    }
+#endif
+
+    if(params != NULL)
+        yices_free_param_record(params);
+    return r_status(r, rec, status);
+}
+
+static int r_get_model(r_state_t *r, r_record_t *rec) {
+    return r_set_handle(r, rec, yices_get_model((context_t *) r_ptr(r, rec, 0), 1));
+}
+
+static int r_free_model(r_state_t *r, r_record_t *rec) {
+    r_handle_t *h = r_handle(r, rec, 0);
+    if(h == NULL || h->ptr == NULL)
+        return -1;
+    yices_free_model((model_t *) h->ptr);
+    h->ptr = NULL;
+    return 0;
+}
+
+static int r_get_bool_value(r_state_t *r, r_record_t *rec) {
+    int32_t val;
+    return yices_get_bool_value((model_t *) r_ptr(r, rec, 0), r_term(r, rec, 1), &val);
+}
+
+static int r_get_int_value(r_state_t *r, r_record_t *rec) {
+    int32_t val;
+    return yices_get_int32_value((model_t *) r_ptr(r, rec, 0), r_term(r, rec, 1), &val);
+}
+
+static int r_get_real_value(r_state_t *r, r_record_t *rec) {
+    double val;
+    return yices_get_double_value((model_t *) r_ptr(r, rec, 0), r_term(r, rec, 1), &val);
+}
+
+static int r_get_values(r_state_t *r, r_record_t *rec) {
+    model_t *model = (model_t *) r_ptr(r, rec, 0);
+    r_value_t *terms = &rec->args[1];
+    r_value_t *kinds = &rec->args[2];
+    type_t bool_type = yices_bool_type();
+    type_t int_type = yices_int_type();
+
+    uint32_t i;
+    for(i = 0; i < terms->size && i < kinds->size; i++) {
+        int32_t t = terms->array[i];
+        term_t term = t >= 0 && (uint32_t) t < r->n_terms && r->terms[t] != NULL_TERM ? r->terms[t] : t;
+        int32_t k = kinds->array[i];
+        type_t kind = k >= 0 && (uint32_t) k < r->n_types && r->types[k] != NULL_TYPE ? r->types[k] : k;
+
+        int32_t ival;
+        double dval;
+        int32_t error;
+        if(kind == bool_type)
+            error = yices_get_bool_value(model, term, &ival);
+        else if(kind == int_type)
+            error = yices_get_int32_value(model, term, &ival);
+        else
+            error = yices_get_double_value(model, term, &dval);
+        if(error)
+            return -1;
+    }
+    return 0;
+}
+
+static int r_skip(r_state_t *r, r_record_t *rec) {
+    (void) r; (void) rec;
+    return 0;
+}
+
+
+// handlers of the functions, by name
+static const struct {
+    const char *name;
+    r_handler_t handler;
+} r_handlers[] = {
+        {"init", r_init},
+        {"exit", r_exit},
+        {"new_config", r_new_config},
+        {"free_config", r_free_config},
+        {"set_config", r_set_config},
+        {"default_config_for_logic", r_default_config_for_logic},
+        {"new_context", r_new_context},
+        {"free_context", r_free_context},
+        {"mark_backtrack", r_push},
+        {"backtrack", r_pop},
+        {"int_type", r_int_type},
+        {"real_type", r_real_type},
+        {"bool_type", r_bool_type},
+        {"function_type", r_function_type},
+        {"parse_type", r_parse_type},
+        {"new_term", r_new_term},
+        {"int_term", r_int_term},
+        {"real_term", r_real_term},
+        {"neg_term", r_neg_term},
+        {"sum_terms", r_sum_terms},
+        {"sub_term", r_sub_term},
+        {"mul_term", r_mul_term},
+        {"div_term", r_div_term},
+        {"pow_term", r_pow_term},
+        {"eq_term", r_eq_term},
+        {"ne_term", r_ne_term},
+        {"ge_term", r_ge_term},
+        {"le_term", r_le_term},
+        {"gt_term", r_gt_term},
+        {"lt_term", r_lt_term},
+        {"const_true", r_const_true},
+        {"const_false", r_const_false},
+        {"not_term", r_not_term},
+        {"and_terms", r_and_terms},
+        {"or_terms", r_or_terms},
+        {"iff_term", r_iff_term},
+        {"imp_term", r_imp_term},
+        {"ite_term", r_ite_term},
+        {"distinct_terms", r_distinct_terms},
+        {"apply_function", r_apply_function},
+        {"compile_term", r_compile_term},
+        {"parse_term", r_parse_term},
+        {"get_term_by_name", r_get_term_by_name},
+        {"term_to_string", r_term_to_string},
+        {"type_to_string", r_type_to_string},
+        {"assert_formula", r_assert_formula},
+        {"assert_formulas", r_assert_formulas},
+        {"check_context", r_check_context},
+        {"check_with_assumptions", r_check_with_assumptions},
+        {"get_model", r_get_model},
+        {"free_model", r_free_model},
+        {"get_bool_value", r_get_bool_value},
+        {"get_int_value", r_get_int_value},
+        {"get_real_value", r_get_real_value},
+        {"get_values", r_get_values},
+        {"sample_polynomials", r_skip},
+        {"clock", r_skip},
+        {"pp_term", r_skip},
+        {"pp_model", r_skip},
+        {NULL, NULL}
+};
+
+
+/////////////////////////////////////////////////////////////////////
+// Reads the header of a trace.
+//
+// @function r_read_header
+// @local here
+// @tparam FILE* f The trace.
+// @tparam uint16_t* n_ops Where to store the number of functions.
+//
+// @treturn r_op_t* The functions of the trace or `NULL` on error.
+static r_op_t * r_read_header(FILE *f, uint16_t *n_ops) {
+    char magic[4];
+    uint32_t version;
+    if(r_read(f, magic, 4) != 0 || memcmp(magic, L_TRACE_MAGIC, 4) != 0
+            || r_read(f, &version, sizeof(version)) != 0 || version != L_TRACE_VERSION
+            || r_read(f, n_ops, sizeof(*n_ops)) != 0)
+        return NULL;
+
+    r_op_t *ops = (r_op_t *) calloc(*n_ops + 1, sizeof(r_op_t));
+    int op, k;
+    for(op = 0; ops != NULL && op < *n_ops; op++) {
+        uint8_t len;
+        if(r_read(f, &len, 1) != 0 || r_read(f, ops[op].name, len) != 0) {
+            free(ops);
+            return NULL;
+        }
+        for(k = 0; r_handlers[k].name != NULL; k++)
+            if(strcmp(r_handlers[k].name, ops[op].name) == 0)
+                ops[op].handler = r_handlers[k].handler;
+    }
+
+    return ops;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Orders the functions by decreasing replayed time.
+static int r_compare_ops(const void *a, const void *b) {
+    const r_op_t *op_a = (const r_op_t *) a;
+    const r_op_t *op_b = (const r_op_t *) b;
+    return op_a->replayed < op_b->replayed ? 1 : op_a->replayed > op_b->replayed ? -1 : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Prints the usage of the driver.
+static int r_usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-v] [-c name=value]... [-p name=value]... trace\n"
+                    "  -v            print the time of each call\n"
+                    "  -c name=value context configuration (logic=... selects a logic)\n"
+                    "  -p name=value search parameter of the checks\n", prog);
+    return 2;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Replays a trace and prints the timing of each function.
+int main(int argc, char **argv) {
+    r_state_t r;
+    memset(&r, 0, sizeof(r));
+    r.config = (char **) calloc(argc, sizeof(char *));
+    r.params = (char **) calloc(argc, sizeof(char *));
+    bool verbose = false;
+    const char *path = NULL;
+
+    int i;
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-v") == 0)
+            verbose = true;
+        else if((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "-p") == 0) && i + 1 < argc && strchr(argv[i + 1], '=')) {
+            if(argv[i][1] == 'c')
+                r.config[r.n_config++] = argv[++i];
+            else
+                r.params[r.n_params++] = argv[++i];
+        }
+        else if(argv[i][0] != '-' && path == NULL)
+            path = argv[i];
+        else
+            return r_usage(argv[0]);
+    }
+    if(path == NULL)
+        return r_usage(argv[0]);
+
+    FILE *f = fopen(path, "rb");
+    if(f == NULL) {
+        fprintf(stderr, "replay: can not open %s\n", path);
+        return 1;
+    }
+    uint16_t n_ops;
+    r_op_t *ops = r_read_header(f, &n_ops);
+    if(ops == NULL) {
+        fprintf(stderr, "replay: %s is not a trace\n", path);
+        return 1;
+    }
+
+    // replay the calls
+    r_record_t rec;
+    unsigned long n = 0, unsupported = 0;
+    int status;
+    while((status = r_read_record(f, &rec)) == 0) {
+        if(rec.op >= n_ops) {
+            status = -1;
+            break;
+        }
+        r_op_t *op = &ops[rec.op];
+        bool recorded_error = rec.n_results > 0 && rec.results[0].tag == L_TRACE_ERROR;
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int error = op->handler != NULL ? op->handler(&r, &rec) : 0;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        uint64_t elapsed = (uint64_t) (end.tv_sec - start.tv_sec) * 1000000000ULL + (end.tv_nsec - start.tv_nsec);
+
+        if(op->handler == NULL)
+            unsupported++;
+        if(error && !recorded_error) {
+            r.failures++;
+            if(verbose)
+                fprintf(stderr, "replay: call %lu (%s) failed: error %d\n", n, op->name, (int) yices_error_code());
+        }
+        yices_clear_error();
+
+        op->calls++;
+        op->recorded += rec.elapsed;
+        op->replayed += elapsed;
+        if(elapsed > op->max)
+            op->max = elapsed;
+        if(verbose)
+            printf("%8lu %-24s %12.3f %12.3f\n", n, op->name, rec.elapsed / 1e3, elapsed / 1e3);
+
+        r_free_record(&rec);
+        n++;
+    }
+    r_free_record(&rec);
+    fclose(f);
+    if(status < 0)
+        fprintf(stderr, "replay: trace is corrupted after call %lu\n", n);
+
+    // report the timing of the functions
+    uint64_t recorded = 0, replayed = 0;
+    qsort(ops, n_ops, sizeof(r_op_t), r_compare_ops);
+    printf("%-24s %10s %14s %14s %12s\n", "function", "calls", "recorded ms", "replayed ms", "max ms");
+    for(i = 0; i < n_ops; i++) {
+        if(ops[i].calls == 0)
+            continue;
+        printf("%-24s %10lu %14.3f %14.3f %12.3f%s\n", ops[i].name, ops[i].calls,
+               ops[i].recorded / 1e6, ops[i].replayed / 1e6, ops[i].max / 1e6,
+               ops[i].handler == NULL ? "  (not replayed)" : "");
+        recorded += ops[i].recorded;
+        replayed += ops[i].replayed;
+    }
+    printf("%-24s %10lu %14.3f %14.3f\n", "total", n, recorded / 1e6, replayed / 1e6);
+    if(r.mismatches > 0)
+        printf("%u checks had a different result\n", r.mismatches);
+    if(r.failures > 0)
+        printf("%u calls failed only when replayed\n", r.failures);
+    if(unsupported > 0)
+        printf("%lu calls were not replayed\n", unsupported);
+
+    free(ops);
+    free(r.terms);
+    free(r.types);
+    free(r.handles);
+    free(r.buffer);
+    free(r.config);
+    free(r.params);
+    return status < 0 ? 1 : 0;
+}
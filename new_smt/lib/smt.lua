@@ -8,7 +8,23 @@
 
 require('lib.util')
 package.cpath = package.cpath .. ';./lib/?.so'
-local solver = require('yices')
+
+-- Under LuaJIT the FFI binding is used, unless the C module is asked
+-- for by `YICES_LUA_BINDING=c` or calls are traced (`YICES_LUA_TRACE`).
+-- `YICES_LUA_BINDING=ffi` requires the FFI binding.
+local solver, binding
+local selected = os.getenv('YICES_LUA_BINDING')
+if selected == 'ffi' then
+    solver, binding = require('lib.yices_ffi'), 'ffi'
+elseif jit and selected ~= 'c' and not os.getenv('YICES_LUA_TRACE') then
+    local ok, ffi_solver = pcall(require, 'lib.yices_ffi')
+    if ok then
+        solver, binding = ffi_solver, 'ffi'
+    end
+end
+if not solver then
+    solver, binding = require('yices'), 'c'
+end
 
 
 --- Class to represent a type. Holds information about the type.
@@ -49,10 +65,25 @@ local solver_term = {
 -- @field BOOL `Boolean` primitive type.
 -- @field TRUE The constant `true`.
 -- @field FALSE The constant `false`.
--- @field CONTEXT List of contexts currently in use.
+-- @field CONTEXT Contexts currently in use, indexed by model.
+-- @field MODEL Valorations currently in use, indexed by model.
+-- @field VERSION Version of the formulas asserted in the context of
+-- each model, indexed by model. It changes whenever formulas are
+-- asserted or removed by backtracking.
+-- @field CONSTANT Numeric constants already created in the current
+-- session, indexed by value.
+-- @field RECORD Constraint set being recorded (see `smt.record`).
+-- @field BINDING Binding to Yices in use: `'ffi'` for the LuaJIT FFI
+-- module or `'c'` for the `yices` C module.
 local smt = {}
-smt.CONTEXT = {}
-smt.MODEL = {}
+smt.BINDING = binding
+smt.CONTEXT = setmetatable({}, {__mode = 'k'})
+smt.MODEL = setmetatable({}, {__mode = 'k'})
+smt.VERSION = setmetatable({}, {__mode = 'k'})
+smt.CONSTANT = {}
+
+-- backtracking points of each context, with the version at each one
+local marks = setmetatable({}, {__mode = 'k'})
 
 
 -- Gather inexistent values from the solver
@@ -99,28 +130,62 @@ function smt.exit()
     
     solver.exit()
     smt.INIT = nil
+    smt.RECORD = nil
+    smt.CONTEXT = setmetatable({}, {__mode = 'k'})
+    smt.MODEL = setmetatable({}, {__mode = 'k'})
+    smt.VERSION = setmetatable({}, {__mode = 'k'})
+    smt.CONSTANT = {}
+    marks = setmetatable({}, {__mode = 'k'})
 end
 
 
 ---------------------------------------------------------------------
 -- Creates a context for the given model.
 -- 
+-- The context configuration is given by table `options`. Field
+-- `logic` selects the default configuration for a SMT-LIB logic
+-- (e.g. `QF_LRA`). The other fields are set as solver configuration
+-- parameters, e.g. `mode` (`one-shot`, `multi-checks`, `push-pop`)
+-- or `arith-solver`.
+-- 
 -- @tparam model model Model for which create the context.
+-- @tparam table options Configuration of the context. If `nil` the
+-- solver default configuration is used.
 -- 
 -- @raise Error if one of the following occurs:
 --
 --  * the solver is not yet initiated;
 --  * `model` type is not the exepcted one;
+--  * `options` is not a table;
 --  * there is already a context for the model;
+--  * the logic or one of the parameters is not valid;
 --  * error occurs while creating the context.
-function smt.create_context(model)
+function smt.create_context(model, options)
     assert(smt.INIT, 'You must initiate the solver first.')
     assert(typeof(model) == 'model', 'Wrong type for argument model.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
     assert(not smt.CONTEXT[model], 'There is already a context built for this model.')
     
-    local ctx_name = tostring(model):sub(7) .. '_ctx'
-    solver.new_context(ctx_name);
-    smt.CONTEXT[model] = ctx_name
+    local cfg
+    if options then
+        cfg = solver.new_config()
+        if options.logic then
+            cfg:default_for_logic(options.logic)
+        end
+        for k,v in pairs(options) do
+            if k ~= 'logic' then
+                cfg:set(k, tostring(v))
+            end
+        end
+    end
+    
+    smt.CONTEXT[model] = solver.new_context(cfg)
+    smt.VERSION[model] = (smt.VERSION[model] or 0) + 1
+    marks[model] = {}
+    
+    if cfg then
+        cfg:free()
+    end
 end
 
 
@@ -139,8 +204,9 @@ function smt.destroy_context(model)
     assert(typeof(model) == 'model', 'Wrong type for argument model.')
     assert(smt.CONTEXT[model], 'There is not a context for this model.')
     
-    solver.free_context(smt.CONTEXT[model]);
+    smt.CONTEXT[model]:free()
     smt.CONTEXT[model] = nil
+    marks[model] = nil
 end
 
 
@@ -160,7 +226,31 @@ function smt.mark_backtrack(model)
     assert(typeof(model) == 'model', 'Wrong type for argument model.')
     assert(smt.CONTEXT[model], 'There is not a context for this model.')
     
-    solver.mark_backtrack(smt.CONTEXT[model]);
+    smt.CONTEXT[model]:mark_backtrack()
+    table.insert(marks[model], {version = smt.VERSION[model]})
+end
+
+
+---------------------------------------------------------------------
+-- Gets the innermost backtracking point of the model's context. Its
+-- field `removed` is set by `smt.backtrack`, so whether the formulas
+-- asserted after it were removed can be known later.
+-- 
+-- @tparam model model Model whose context is used.
+-- 
+-- @treturn table The backtracking point or `nil` if there is none.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * the solver is not yet initiated;
+--  * `model` type is not the exepcted one;
+--  * there is not a context for the model.
+function smt.backtrack_point(model)
+    assert(smt.INIT, 'You must initiate the solver first.')
+    assert(typeof(model) == 'model', 'Wrong type for argument model.')
+    assert(smt.CONTEXT[model], 'There is not a context for this model.')
+    
+    return marks[model][#marks[model]]
 end
 
 
@@ -180,7 +270,17 @@ function smt.backtrack(model)
     assert(typeof(model) == 'model', 'Wrong type for argument model.')
     assert(smt.CONTEXT[model], 'There is not a context for this model.')
     
-    solver.backtrack(smt.CONTEXT[model]);
+    smt.CONTEXT[model]:backtrack()
+    
+    -- the formulas are the same if none was asserted after the point
+    local point = table.remove(marks[model])
+    point.removed = true
+    if point.version ~= smt.VERSION[model] then
+        smt.VERSION[model] = smt.VERSION[model] + 1
+    end
+    if smt.RECORD and smt.RECORD.model == model then
+        smt.RECORD.backtracked = true
+    end
 end
 
 
@@ -225,11 +325,18 @@ function smt.constant(type, name)
     assert(typeof(type) == 'type', 'Wrong type for argument type.')
     assert(not name or typeof(name) == 'string', 'Wrong type for argument name.')
     
+    local term
     if name then
-        return solver_term:new(solver.new_term(type.index, name), name)
+        term = solver_term:new(solver.new_term(type.index, name), name)
     else
-        return solver_term:new(solver.new_term(type.index))
+        term = solver_term:new(solver.new_term(type.index))
     end
+    
+    if smt.RECORD then
+        local c = smt.RECORD.constants
+        c[#c + 1] = {term, type.index}
+    end
+    return term
 end
 
 
@@ -264,12 +371,19 @@ function smt.create_function(args, type, name)
     end
     
     local type = solver.function_type(_a, type.index)
-    return solver_term:new(solver.new_term(type, name), name)
+    local term = solver_term:new(solver.new_term(type, name), name)
+    
+    if smt.RECORD then
+        local c = smt.RECORD.constants
+        c[#c + 1] = {term, type}
+    end
+    return term
 end
 
 
 ---------------------------------------------------------------------
--- Converts `val` to a constant integer term.
+-- Converts `val` to a constant integer term. Constants are interned,
+-- the same term object is returned for the same value.
 -- 
 -- @tparam number val Integer to be converted to a term.
 -- 
@@ -284,12 +398,19 @@ function smt.int(val)
     assert(smt.INIT, 'You must initiate the solver first.')
     assert(typeof(val) == 'integer', 'Wrong type for argument val.')
     
-    return solver_term:new(solver.int_term(val))
+    local term = smt.CONSTANT[val]
+    if not term then
+        term = solver_term:new(solver.int_term(val))
+        smt.CONSTANT[val] = term
+    end
+    return term
 end
 
 
 ---------------------------------------------------------------------
--- Converts `val` to a constant real term.
+-- Converts `val` to a constant real term. The term has exactly the
+-- value of the double. Constants are interned, the same term object
+-- is returned for the same value.
 -- 
 -- @tparam number val Double to be converted to a term.
 -- 
@@ -298,13 +419,18 @@ end
 -- @raise Error if one of the following occurs:
 --
 --  * the solver is not yet initiated;
---  * `val` is not a number;
+--  * `val` is not a finite number;
 --  * an error occurs while creating the term.
 function smt.real(val)
     assert(smt.INIT, 'You must initiate the solver first.')
     assert(({typeof(val)})[2] == 'number', 'Wrong type for argument val.')
     
-    return solver_term:new(solver.real_term(tostring(val / 1.0)))
+    local term = smt.CONSTANT[val]
+    if not term then
+        term = solver_term:new(solver.real_term(val))
+        smt.CONSTANT[val] = term
+    end
+    return term
 end
 
 
@@ -830,6 +956,38 @@ function smt.apply(fun, t)
 end
 
 
+---------------------------------------------------------------------
+-- Builds the term of a whole expression in a single call to the
+-- solver, instead of one call per operator.
+-- 
+-- The expression is a tree of tables `{op, e1, ..., en}`, where `op`
+-- is one of `and`, `or`, `not`, `iff`, `imp`, `ite`, `eq`, `ne`,
+-- `ge`, `le`, `gt`, `lt`, `sum`, `sub`, `mul`, `div`, `neg`,
+-- `distinct` or `apply` (whose first operand is the function). Each
+-- operator builds the same term as the function of this module with
+-- the same meaning (e.g. `and` as `smt.land`). The leaves are terms,
+-- numbers (constants, as `smt.real`) or booleans.
+-- 
+-- @tparam table exp The expression.
+-- 
+-- @treturn term Object representing the term.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * the solver is not yet initiated;
+--  * `exp` is not a table;
+--  * an operator or operand of the expression is not valid;
+--  * an error occurs while creating the term.
+-- 
+-- @usage smt.compile{'ite', c, {'le', x, 0}, {'gt', {'sum', x, y}, 1.5}}
+function smt.compile(exp)
+    assert(smt.INIT, 'You must initiate the solver first.')
+    assert(type(exp) == 'table', 'Wrong type for argument exp.')
+    
+    return solver_term:new(solver.compile_term(exp))
+end
+
+
 ---------------------------------------------------------------------
 -- Creates a term from an expression.
 -- 
@@ -850,6 +1008,27 @@ function smt.parse_term(exp)
 end
 
 
+---------------------------------------------------------------------
+-- Gets the expression of a term, which `smt.parse_term` turns into
+-- the same term while its constants have the same names.
+-- 
+-- @tparam term term The term.
+-- 
+-- @treturn string The expression.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * the solver is not yet initiated;
+--  * `term` is not a term;
+--  * an error occurs while printing the term.
+function smt.to_string(term)
+    assert(smt.INIT, 'You must initiate the solver first.')
+    assert(typeof(term) == 'term', 'Wrong type for argument term.')
+    
+    return solver.term_to_string(term.index)
+end
+
+
 ---------------------------------------------------------------------
 -- Asserts an expression in the context.
 -- Equivalent to the command `(assert expression)`.
@@ -870,31 +1049,252 @@ function smt.assert(model, term)
     assert(smt.CONTEXT[model], 'There is not a context for this model.')
     assert(typeof(term) == 'term', 'Wrong type for argument term.')
     
-    solver.assert_formula(smt.CONTEXT[model], term.index)
+    smt.CONTEXT[model]:assert_formula(term.index)
+    smt.VERSION[model] = smt.VERSION[model] + 1
+    if smt.RECORD and smt.RECORD.model == model then
+        local f = smt.RECORD.formulas
+        f[#f + 1] = term
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Asserts a list of expressions in the context with a single call to
+-- the solver. Equivalent to one command `(assert expression)` for
+-- each expression in `terms`.
+-- 
+-- @tparam model model Model for which context the terms will be asserted.
+-- @tparam table terms Table with the terms to be asserted.
+--
+-- @raise Error if one of the following occurs:
+--
+--  * the solver is not yet initiated;
+--  * `model` type is not the exepcted one;
+--  * there is not a context for the model;
+--  * `terms` is not a table of terms;
+--  * an error occurs while asserting the terms.
+function smt.assert_all(model, terms)
+    assert(smt.INIT, 'You must initiate the solver first.')
+    assert(typeof(model) == 'model', 'Wrong type for argument model.')
+    assert(smt.CONTEXT[model], 'There is not a context for this model.')
+    assert(typeof(terms) == 'table', 'Wrong type for argument terms.')
+    
+    if #terms == 0 then
+        return
+    end
+    
+    local t = {}
+    for i = 1, #terms do
+        assert(typeof(terms[i]) == 'term', 'Table terms must have only terms.')
+        t[i] = terms[i].index
+    end
+    smt.CONTEXT[model]:assert_formulas(t)
+    smt.VERSION[model] = smt.VERSION[model] + 1
+    
+    if smt.RECORD and smt.RECORD.model == model then
+        local f = smt.RECORD.formulas
+        for i = 1, #terms do
+            f[#f + 1] = terms[i]
+        end
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Starts recording the constraint set of a model: the constants and
+-- functions created and the formulas asserted in the model's context.
+-- The record is ended by `smt.dump`, which gives the constraint set
+-- as expressions of the solver language, so it can be rebuilt later
+-- by `smt.restore` without creating each term again.
+-- 
+-- @tparam model model Model whose constraint set is recorded.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * the solver is not yet initiated;
+--  * `model` type is not the exepcted one;
+--  * a constraint set is already being recorded.
+function smt.record(model)
+    assert(smt.INIT, 'You must initiate the solver first.')
+    assert(typeof(model) == 'model', 'Wrong type for argument model.')
+    assert(not smt.RECORD, 'There is already a record in progress.')
+    
+    smt.RECORD = {model = model, constants = {}, formulas = {}}
+end
+
+
+---------------------------------------------------------------------
+-- Ends the record of the constraint set of a model.
+-- 
+-- The formulas refer to the constants by name, so the set is only
+-- given if every constant recorded has a name that was not given to
+-- another constant afterwards. It is not given either if the context
+-- backtracked during the record.
+-- 
+-- @tparam model model Model whose constraint set was recorded.
+-- 
+-- @treturn table The constraint set or `nil` if it can not be
+-- rebuilt. Field `constants` lists the name and the type expression
+-- of each constant, in order of creation, and field `formulas` the
+-- expressions of the formulas asserted.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * the solver is not yet initiated;
+--  * `model` type is not the exepcted one;
+--  * the constraint set of `model` is not being recorded;
+--  * an error occurs while converting the terms.
+function smt.dump(model)
+    assert(smt.INIT, 'You must initiate the solver first.')
+    assert(typeof(model) == 'model', 'Wrong type for argument model.')
+    assert(smt.RECORD and smt.RECORD.model == model, 'There is not a record for this model.')
+    
+    local record = smt.RECORD
+    smt.RECORD = nil
+    if record.backtracked then
+        return nil
+    end
+    
+    local constants = {}
+    local types = {}
+    for i, c in ipairs(record.constants) do
+        local term, type = c[1], c[2]
+        if not term.name or solver.get_term_by_name(term.name) ~= term.index then
+            return nil
+        end
+        
+        types[type] = types[type] or solver.type_to_string(type)
+        constants[i] = {term.name, types[type]}
+    end
+    
+    local formulas = {}
+    for i, term in ipairs(record.formulas) do
+        formulas[i] = solver.term_to_string(term.index)
+    end
+    
+    return {constants = constants, formulas = formulas}
+end
+
+
+---------------------------------------------------------------------
+-- Rebuilds a constraint set given by `smt.dump` in the context of a
+-- model. The constants are created again, with the same names, and
+-- the formulas are parsed and asserted all at once.
+-- 
+-- @tparam model model Model for which context the set is rebuilt.
+-- @tparam table set The constraint set.
+-- 
+-- @treturn table Objects representing the constants, indexed by name.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * the solver is not yet initiated;
+--  * `model` type is not the exepcted one;
+--  * there is not a context for the model;
+--  * `set` is not a constraint set;
+--  * an error occurs while parsing or asserting the formulas.
+function smt.restore(model, set)
+    assert(smt.INIT, 'You must initiate the solver first.')
+    assert(typeof(model) == 'model', 'Wrong type for argument model.')
+    assert(smt.CONTEXT[model], 'There is not a context for this model.')
+    assert(type(set) == 'table' and type(set.constants) == 'table' and type(set.formulas) == 'table',
+           'Wrong type for argument set.')
+    
+    local terms = {}
+    local types = {}
+    for _, c in ipairs(set.constants) do
+        local name, type = c[1], c[2]
+        types[type] = types[type] or solver.parse_type(type)
+        terms[name] = solver_term:new(solver.new_term(types[type], name), name)
+    end
+    
+    if #set.formulas > 0 then
+        local term = solver.parse_term('(and ' .. table.concat(set.formulas, ' ') .. ')')
+        smt.CONTEXT[model]:assert_formula(term)
+        smt.VERSION[model] = smt.VERSION[model] + 1
+    end
+    
+    return terms
 end
 
 
 ---------------------------------------------------------------------
 -- Checks whether a context is satisfiable.
 -- 
+-- The search may be configured by table `options`. Field `timeout_ms`
+-- gives a time limit for the search, after which it is interrupted.
+-- The other fields are set as solver search parameters. An
+-- interrupted context must be backtracked before being used again.
+-- 
+-- @tparam model model Model for which context will be checked.
+-- @tparam table options Options of the search. If `nil` the solver
+-- default parameters are used, with no time limit.
+-- 
+-- @treturn bool True if the context is satisfiable and false
+-- otherwise, returns `nil` for any other result.
+-- @treturn string If the result is `nil`, `'interrupted'` when the
+-- time limit passed and `'unknown'` otherwise.
+--
+-- @raise Error if one of the following occurs:
+--
+--  * the solver is not yet initiated;
+--  * `model` type is not the exepcted one;
+--  * `options` is not a table;
+--  * there is not a context for the model;
+--  * one of the search parameters is not valid;
+--  * an error occurs while checking the context.
+function smt.check(model, options)
+    assert(smt.INIT, 'You must initiate the solver first.')
+    assert(typeof(model) == 'model', 'Wrong type for argument model.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
+    assert(smt.CONTEXT[model], 'There is not a context for this model.')
+    
+    local sat, status = smt.CONTEXT[model]:check(options)
+    smt.SAT = sat
+    return sat, status
+end
+
+
+---------------------------------------------------------------------
+-- Checks whether a context is satisfiable assuming a list of Boolean
+-- literals. The literals hold only during this check, so there is no
+-- need to backtrack them and what the solver learned is kept for the
+-- next checks.
+-- 
 -- @tparam model model Model for which context will be checked.
+-- @tparam table literals List of terms assumed to be true.
+-- @tparam table options Options of the search (see `smt.check`).
 -- 
 -- @treturn bool True if the context is satisfiable and false
 -- otherwise, returns `nil` for any other result.
+-- @treturn string If the result is `nil`, `'interrupted'` when the
+-- time limit passed and `'unknown'` otherwise.
 --
 -- @raise Error if one of the following occurs:
 --
 --  * the solver is not yet initiated;
 --  * `model` type is not the exepcted one;
+--  * `literals` is not a list of terms;
+--  * `options` is not a table;
 --  * there is not a context for the model;
+--  * one of the search parameters is not valid;
 --  * an error occurs while checking the context.
-function smt.check(model)
+function smt.check_with_assumptions(model, literals, options)
     assert(smt.INIT, 'You must initiate the solver first.')
     assert(typeof(model) == 'model', 'Wrong type for argument model.')
+    assert(type(literals) == 'table', 'Wrong type for argument literals.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
     assert(smt.CONTEXT[model], 'There is not a context for this model.')
     
-    smt.SAT = solver.check_context(smt.CONTEXT[model])
-    return smt.SAT
+    local t = {}
+    for i,term in ipairs(literals) do
+        assert(typeof(term) == 'term', 'Wrong type for literal ' .. i .. '.')
+        t[i] = term.index
+    end
+    
+    local sat, status = smt.CONTEXT[model]:check_with_assumptions(t, options)
+    smt.SAT = sat
+    return sat, status
 end
 
 
@@ -916,9 +1316,7 @@ function smt.create_model(model)
     assert(smt.CONTEXT[model], 'There is not a context for this model.')
     assert(smt.SAT, 'Context is not sat, can not evaluate it.')
     
-    local mld_name = tostring(model):sub(7) .. '_mdl'
-    solver.get_model(smt.CONTEXT[model], mld_name)
-    smt.MODEL[model] = mld_name
+    smt.MODEL[model] = smt.CONTEXT[model]:get_model()
 end
 
 
@@ -937,7 +1335,7 @@ function smt.destroy_model(model)
     assert(typeof(model) == 'model', 'Wrong type for argument model.')
     assert(smt.MODEL[model], 'There is not a modeling for this context.')
     
-    solver.free_model(smt.MODEL[model])
+    smt.MODEL[model]:free()
     smt.MODEL[model] = nil
 end
 
@@ -968,13 +1366,14 @@ function smt.eval(model, term, type)
     assert(typeof(term) == 'term', 'Wrong type for argument term.')
     assert(typeof(type) == 'type', 'Wrong type for argument type.')
     
+    local mdl = smt.MODEL[model]
     local value
     if type == smt.REAL then
-        value = solver.get_real_value(smt.MODEL[model], term.index)
+        value = mdl:get_real_value(term.index)
     elseif type == smt.BOOL then
-        value = solver.get_bool_value(smt.MODEL[model], term.index)
+        value = mdl:get_bool_value(term.index)
     elseif type == smt.INT then
-        value = solver.get_int_value(smt.MODEL[model], term.index)
+        value = mdl:get_int_value(term.index)
     end
     term.value = value
     
@@ -982,6 +1381,79 @@ function smt.eval(model, term, type)
 end
 
 
+---------------------------------------------------------------------
+-- Get the values of a list of constants from a satisfiable context
+-- in a single solver call. As `smt.eval`, the function also stores
+-- each value in its term.
+-- 
+-- @tparam model model Model from which context the terms will be evaluated.
+-- @tparam table terms List of terms to be evaluated.
+-- @tparam table types List with the type of each term.
+-- 
+-- @treturn table List with the values of the terms.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * the solver is not yet initiated;
+--  * `model` type is not the exepcted one;
+--  * there is not a modeling for the context;
+--  * `terms` and `types` do not have the same length;
+--  * an error occur while evaluating the terms.
+function smt.eval_all(model, terms, types)
+    assert(smt.INIT, 'You must initiate the solver first.')
+    assert(typeof(model) == 'model', 'Wrong type for argument model.')
+    assert(smt.MODEL[model], 'There is not a modeling for this context.')
+    assert(#terms == #types, 'The lists of terms and types differ in size.')
+    
+    local t, k = {}, {}
+    for i = 1, #terms do
+        t[i] = terms[i].index
+        k[i] = types[i].index
+    end
+    
+    local values = smt.MODEL[model]:get_values(t, k)
+    for i = 1, #terms do
+        terms[i].value = values[i]
+    end
+    
+    return values
+end
+
+
+---------------------------------------------------------------------
+-- Samples piecewise polynomials at a list of times, without the
+-- solver. Each piece is the polynomial `coef[1] + coef[2]*x + ...`,
+-- where `x = t - ti`, between times `ti` and `te`, and values
+-- `before` and `after` outside of them (`value` if missing).
+-- 
+-- @tparam table pieces List of pieces, tables with fields `coef`,
+-- `ti`, `te`, `before`, `after` and `value`.
+-- @tparam table times List of times.
+-- 
+-- @treturn table List with the values of each piece at the times.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * `pieces` or `times` is not a table;
+--  * one of the pieces is not valid.
+function smt.sample(pieces, times)
+    assert(type(pieces) == 'table', 'Wrong type for argument pieces.')
+    assert(type(times) == 'table', 'Wrong type for argument times.')
+    
+    return solver.sample_polynomials(pieces, times)
+end
+
+
+---------------------------------------------------------------------
+-- Gets the time of a monotonic clock, to measure the time spent by
+-- the checks (the clock of `os.clock` is the processor time).
+-- 
+-- @treturn number The time in seconds, from an arbitrary origin.
+function smt.clock()
+    return solver.clock()
+end
+
+
 ---------------------------------------------------------------------
 -- Pretty print the entire model.
 -- 
@@ -1026,7 +1498,7 @@ function smt.print_model(model, width, height)
     assert(({typeof(width)})[2] == 'number', 'Wrong type for argument width.')
     assert(({typeof(height)})[2] == 'number', 'Wrong type for argument height.')
     
-    solver.pp_model(smt.MODEL[model], width, height)
+    smt.MODEL[model]:print(width, height)
 end
 
 
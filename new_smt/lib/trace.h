@@ -0,0 +1,70 @@
+/////////////////////////////////////////////////////////////////////
+// Format of the binding call traces.
+// Shared by the recording mode of the `yices` module and by the
+// replay driver.
+//
+// A trace starts with a header:
+//
+//    char magic[4]        "YLTR"
+//    uint32_t version     L_TRACE_VERSION
+//    uint16_t n_ops       number of functions of the binding
+//    n_ops times:
+//       uint8_t len       length of the function name
+//       char name[len]    name of the function (as in the module)
+//
+// followed by one record per call:
+//
+//    uint16_t op          index of the function in the header
+//    uint8_t n_args       number of arguments
+//    value args[n_args]
+//    uint8_t n_results    number of results (1 on error)
+//    value results[n_results]
+//    uint64_t elapsed     wall time of the call, in nanoseconds
+//
+// Each value starts with a tag byte. All numbers are stored in host
+// byte order.
+//
+// @module lib.trace
+// @author Joel dos Santos <joel@dossantos.cc>
+
+#ifndef L_TRACE_H
+#define L_TRACE_H
+
+#define L_TRACE_MAGIC "YLTR"
+#define L_TRACE_VERSION 2
+
+
+/////////////////////////////////////////////////////////////////////
+// Tags of the values.
+//
+// @field L_TRACE_NIL No payload.
+// @field L_TRACE_BOOL `uint8_t` value.
+// @field L_TRACE_NUMBER `double` value.
+// @field L_TRACE_STRING `uint32_t` length and the bytes of the string.
+// @field L_TRACE_ARRAY `uint32_t` length and the `int32_t` elements
+// of an array of terms or types.
+// @field L_TRACE_OPTIONS `uint32_t` number of fields and, for each
+// field, its name (as a string payload) and its tagged value.
+// @field L_TRACE_HANDLE `uint32_t` identifier of a context, model or
+// configuration, assigned in order of first appearance.
+// @field L_TRACE_TABLE `uint32_t` length of a table returned by a call.
+// @field L_TRACE_ERROR Error message of a failed call (as a string payload).
+// @field L_TRACE_EXPRESSION Expression of `compile_term`: `uint32_t`
+// number of elements, the operator (as a string payload) and the
+// tagged operands.
+// @field L_TRACE_TERM `int32_t` term object in an expression.
+enum {
+    L_TRACE_NIL = '0',
+    L_TRACE_BOOL = 'b',
+    L_TRACE_NUMBER = 'n',
+    L_TRACE_STRING = 's',
+    L_TRACE_ARRAY = 't',
+    L_TRACE_OPTIONS = 'm',
+    L_TRACE_HANDLE = 'u',
+    L_TRACE_TABLE = 'T',
+    L_TRACE_ERROR = 'e',
+    L_TRACE_EXPRESSION = 'x',
+    L_TRACE_TERM = 'r'
+};
+
+#endif
@@ -10,12 +10,23 @@
 // @author Joel dos Santos <joel@dossantos.cc>
 
 
+// clock_gettime and the POSIX clocks are not declared by strict C99
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
 #include <yices.h>
 #include <lua.h>
 #include <lauxlib.h>
+#include "trace.h"
+#include "rational.h"
+#include "operator.h"
 
 
 
@@ -198,6 +209,464 @@ static int l_throw_error(lua_State *L) {
 }
 
 
+/////////////////////////////////////////////////////////////////////
+// Names of the metatables used for contexts, models and
+// configurations userdata.
+#define L_CONTEXT_MT "yices.context"
+#define L_MODEL_MT "yices.model"
+#define L_CONFIG_MT "yices.config"
+
+
+/////////////////////////////////////////////////////////////////////
+// Whether Yices checks a context under assumptions (since 2.6).
+// Older versions are handled by asserting the assumptions in a
+// backtracking point that is left open until the next operation.
+#define L_NATIVE_ASSUMPTIONS (__YICES_VERSION > 2 || __YICES_VERSION_MAJOR >= 6)
+
+
+/////////////////////////////////////////////////////////////////////
+// Watchdog of a context, a thread stopping the searches whose time
+// limit passed. It is started by the first bounded check of the
+// context and kept until the context is deleted.
+// 
+// Yices ignores a stop while the context is not searching yet (e.g.
+// while the formulas are internalized), so the stop is sent again
+// every `L_WATCHDOG_RETRY_MS` until the check returns.
+// 
+// @field context Context being checked.
+// @field deadline Time of the monotonic clock when the search must be
+// stopped.
+// @field armed Whether a check is running under the watchdog.
+// @field quit Whether the thread must return.
+// @field mutex Lock protecting the fields.
+// @field cond Signaled when the watchdog is armed, disarmed or quit.
+// @field thread Thread running the watchdog.
+typedef struct l_watchdog_s {
+    context_t *context;
+    struct timespec deadline;
+    bool armed;
+    bool quit;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t thread;
+} l_watchdog_t;
+
+#define L_WATCHDOG_RETRY_MS 5
+
+
+/////////////////////////////////////////////////////////////////////
+// Sets a time to the monotonic clock plus some milliseconds.
+// 
+// @function l_watchdog_time
+// @local here
+// @tparam struct timespec* t Where to store the time.
+// @tparam double ms Milliseconds to be added.
+static void l_watchdog_time(struct timespec *t, double ms) {
+    clock_gettime(CLOCK_MONOTONIC, t);
+    long long nsec = t->tv_nsec + (long long) (ms * 1000000.0);
+    t->tv_sec += nsec / 1000000000LL;
+    t->tv_nsec = nsec % 1000000000LL;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Body of the watchdog thread. While armed, waits for the deadline
+// and then stops the search until the watchdog is disarmed.
+// 
+// @function l_watchdog_run
+// @local here
+// @tparam void* arg Pointer to the watchdog.
+static void * l_watchdog_run(void *arg) {
+    l_watchdog_t *watchdog = (l_watchdog_t *) arg;
+    struct timespec now;
+    
+    pthread_mutex_lock(&watchdog->mutex);
+    while(!watchdog->quit) {
+        if(!watchdog->armed) {
+            pthread_cond_wait(&watchdog->cond, &watchdog->mutex);
+            continue;
+        }
+        
+        pthread_cond_timedwait(&watchdog->cond, &watchdog->mutex, &watchdog->deadline);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        bool passed = now.tv_sec > watchdog->deadline.tv_sec
+                || (now.tv_sec == watchdog->deadline.tv_sec && now.tv_nsec >= watchdog->deadline.tv_nsec);
+        
+        // the search is stopped only while holding the lock, so it can
+        // not reach a check that has already returned
+        if(watchdog->armed && !watchdog->quit && passed) {
+            yices_stop_search(watchdog->context);
+            l_watchdog_time(&watchdog->deadline, L_WATCHDOG_RETRY_MS);
+        }
+    }
+    pthread_mutex_unlock(&watchdog->mutex);
+    
+    return NULL;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Creates the watchdog of a context and starts its thread.
+// 
+// @function l_watchdog_new
+// @local here
+// @tparam context_t* context The context.
+// 
+// @treturn l_watchdog_t* The watchdog or `NULL` if it could not be
+// started.
+static l_watchdog_t * l_watchdog_new(context_t *context) {
+    l_watchdog_t *watchdog = (l_watchdog_t *) malloc(sizeof(l_watchdog_t));
+    if(watchdog == NULL)
+        return NULL;
+    watchdog->context = context;
+    watchdog->armed = false;
+    watchdog->quit = false;
+    
+    // the deadlines are times of the monotonic clock
+    pthread_condattr_t attr;
+    if(pthread_condattr_init(&attr) != 0) {
+        free(watchdog);
+        return NULL;
+    }
+    if(pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0
+            || pthread_cond_init(&watchdog->cond, &attr) != 0) {
+        pthread_condattr_destroy(&attr);
+        free(watchdog);
+        return NULL;
+    }
+    pthread_condattr_destroy(&attr);
+    
+    pthread_mutex_init(&watchdog->mutex, NULL);
+    if(pthread_create(&watchdog->thread, NULL, l_watchdog_run, watchdog) != 0) {
+        pthread_cond_destroy(&watchdog->cond);
+        pthread_mutex_destroy(&watchdog->mutex);
+        free(watchdog);
+        return NULL;
+    }
+    
+    return watchdog;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Stops the thread of a watchdog and deletes it.
+// 
+// @function l_watchdog_free
+// @local here
+// @tparam l_watchdog_t* watchdog The watchdog.
+static void l_watchdog_free(l_watchdog_t *watchdog) {
+    pthread_mutex_lock(&watchdog->mutex);
+    watchdog->quit = true;
+    pthread_cond_signal(&watchdog->cond);
+    pthread_mutex_unlock(&watchdog->mutex);
+    
+    pthread_join(watchdog->thread, NULL);
+    pthread_cond_destroy(&watchdog->cond);
+    pthread_mutex_destroy(&watchdog->mutex);
+    free(watchdog);
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Arms a watchdog for a check, or disarms it after the check
+// returned.
+// 
+// @function l_watchdog_arm
+// @local here
+// @tparam l_watchdog_t* watchdog The watchdog.
+// @tparam double timeout Time limit in milliseconds, or 0 to disarm.
+static void l_watchdog_arm(l_watchdog_t *watchdog, double timeout) {
+    pthread_mutex_lock(&watchdog->mutex);
+    watchdog->armed = timeout > 0;
+    if(watchdog->armed)
+        l_watchdog_time(&watchdog->deadline, timeout);
+    pthread_cond_signal(&watchdog->cond);
+    pthread_mutex_unlock(&watchdog->mutex);
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Watchdog functions with C linkage for the FFI binding
+// (`lib.yices_ffi`), which can not run a thread of its own and loads
+// this module to bound its checks.
+// 
+// @function yices_lua_watchdog_new
+// @local here
+// @tparam context_t* context The context.
+// 
+// @treturn void* The watchdog or `NULL` if it could not be started.
+void * yices_lua_watchdog_new(context_t *context) {
+    return l_watchdog_new(context);
+}
+
+void yices_lua_watchdog_arm(void *watchdog, double timeout) {
+    l_watchdog_arm((l_watchdog_t *) watchdog, timeout);
+}
+
+void yices_lua_watchdog_free(void *watchdog) {
+    l_watchdog_free((l_watchdog_t *) watchdog);
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Userdata holding a context.
+// 
+// @field context Pointer to the context or `NULL` if it was freed.
+// @field generation Initialization in which the context was created.
+// @field assuming Whether there is an open backtracking point holding
+// the assumptions of the last check.
+// @field watchdog Watchdog of the bounded checks or `NULL` if there was
+// none yet.
+typedef struct l_context_s {
+    context_t *context;
+    unsigned int generation;
+    bool assuming;
+    l_watchdog_t *watchdog;
+} l_context_t;
+
+
+/////////////////////////////////////////////////////////////////////
+// Userdata holding a model.
+// 
+// @field model Pointer to the model or `NULL` if it was freed.
+// @field generation Initialization in which the model was created.
+typedef struct l_model_s {
+    model_t *model;
+    unsigned int generation;
+} l_model_t;
+
+
+/////////////////////////////////////////////////////////////////////
+// Userdata holding a context configuration.
+// 
+// @field config Pointer to the configuration or `NULL` if it was freed.
+// @field generation Initialization in which the configuration was created.
+typedef struct l_config_s {
+    ctx_config_t *config;
+    unsigned int generation;
+} l_config_t;
+
+/////////////////////////////////////////////////////////////////////
+// Current Yices initialization. Global cleanup deletes all contexts
+// and models, so handles created before it must not free them again.
+static unsigned int l_generation = 0;
+
+
+/////////////////////////////////////////////////////////////////////
+// Gets the context stored in a `yices.context` userdata.
+// 
+// @function l_check_context
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the userdata.
+// 
+// @treturn context_t* Pointer to the context.
+// 
+// @raise Error if the argument is not a context or it was freed.
+static context_t * l_check_context(lua_State *L, int idx) {
+    l_context_t *handle = (l_context_t *) luaL_checkudata(L, idx, L_CONTEXT_MT);
+    
+    if(handle->context == NULL || handle->generation != l_generation)
+        luaL_argerror(L, idx, "context was already freed");
+    
+    return handle->context;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Gets the context stored in a `yices.context` userdata, dropping
+// the assumptions of its last check. Must be used by the functions
+// changing or checking the context.
+// 
+// @function l_check_idle_context
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the userdata.
+// 
+// @treturn context_t* Pointer to the context.
+// 
+// @raise Error if the argument is not a context or it was freed.
+static context_t * l_check_idle_context(lua_State *L, int idx) {
+    context_t *context = l_check_context(L, idx);
+    l_context_t *handle = (l_context_t *) lua_touserdata(L, idx);
+    
+    if(handle->assuming) {
+        handle->assuming = false;
+        if(yices_pop(context) != 0)
+            l_throw_error(L);
+    }
+    
+    return context;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Gets the model stored in a `yices.model` userdata.
+// 
+// @function l_check_model
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the userdata.
+// 
+// @treturn model_t* Pointer to the model.
+// 
+// @raise Error if the argument is not a model or it was freed.
+static model_t * l_check_model(lua_State *L, int idx) {
+    l_model_t *handle = (l_model_t *) luaL_checkudata(L, idx, L_MODEL_MT);
+    
+    if(handle->model == NULL || handle->generation != l_generation)
+        luaL_argerror(L, idx, "model was already freed");
+    
+    return handle->model;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Gets the configuration stored in a `yices.config` userdata.
+// 
+// @function l_check_config
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the userdata.
+// 
+// @treturn ctx_config_t* Pointer to the configuration.
+// 
+// @raise Error if the argument is not a configuration or it was freed.
+static ctx_config_t * l_check_config(lua_State *L, int idx) {
+    l_config_t *handle = (l_config_t *) luaL_checkudata(L, idx, L_CONFIG_MT);
+    
+    if(handle->config == NULL || handle->generation != l_generation)
+        luaL_argerror(L, idx, "configuration was already freed");
+    
+    return handle->config;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Scratch arena used for passing arrays of terms and types to Yices.
+// There is one arena per Lua state, stored in the registry. It only
+// grows, so after a few calls no allocation is needed.
+// 
+// @field data Buffer for the array.
+// @field size Number of elements the buffer can hold.
+typedef struct l_scratch_s {
+    int32_t *data;
+    size_t size;
+} l_scratch_t;
+
+
+/////////////////////////////////////////////////////////////////////
+// Registry key of the scratch arena (its address is the key).
+static const char l_scratch_key = 0;
+
+
+/////////////////////////////////////////////////////////////////////
+// Finalizer of the scratch arena.
+// 
+// @function l_scratch_gc
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+static int l_scratch_gc(lua_State *L) {
+    l_scratch_t *scratch = (l_scratch_t *) lua_touserdata(L, 1);
+    
+    free(scratch->data);
+    scratch->data = NULL;
+    scratch->size = 0;
+    return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Gets the scratch arena of the Lua state, creating it on first use.
+// 
+// @function l_get_scratch
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// 
+// @treturn l_scratch_t* Pointer to the arena.
+static l_scratch_t * l_get_scratch(lua_State *L) {
+    lua_pushlightuserdata(L, (void *) &l_scratch_key);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    l_scratch_t *scratch = (l_scratch_t *) lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    
+    if(scratch == NULL) {
+        lua_pushlightuserdata(L, (void *) &l_scratch_key);
+        scratch = (l_scratch_t *) lua_newuserdata(L, sizeof(l_scratch_t));
+        scratch->data = NULL;
+        scratch->size = 0;
+        lua_newtable(L);
+        lua_pushcfunction(L, l_scratch_gc);
+        lua_setfield(L, -2, "__gc");
+        lua_setmetatable(L, -2);
+        lua_rawset(L, LUA_REGISTRYINDEX);
+    }
+    
+    return scratch;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Makes room for `size` elements in the scratch arena. The arena
+// grows geometrically and keeps its contents.
+// 
+// @function l_scratch_grow
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam l_scratch_t* scratch The scratch arena.
+// @tparam size_t size Number of elements needed.
+// 
+// @raise Error if there is not enough memory for the array.
+static void l_scratch_grow(lua_State *L, l_scratch_t *scratch, size_t size) {
+    if(size <= scratch->size)
+        return;
+    
+    size_t new_size = scratch->size < 64 ? 64 : scratch->size;
+    while(new_size < size)
+        new_size *= 2;
+    int32_t *data = (int32_t *) realloc(scratch->data, new_size * sizeof(int32_t));
+    if(data == NULL)
+        luaL_error(L, "not enough memory for %d terms", (int) size);
+    scratch->data = data;
+    scratch->size = new_size;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Copies the array part of a table into the scratch arena. The
+// elements t[1] ... t[n] are read in order.
+// 
+// The returned buffer is only valid until the next call, so it must
+// be passed to Yices before reading another table.
+// 
+// @function l_check_array
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the table.
+// @tparam uint32_t* n Where to store the number of elements.
+// 
+// @treturn int32_t* Pointer to the elements.
+// 
+// @raise Error if the argument is not a table or there is not
+// enough memory for the array.
+static int32_t * l_check_array(lua_State *L, int idx, uint32_t *n) {
+    luaL_checktype(L, idx, LUA_TTABLE);
+    size_t size = lua_objlen(L, idx);
+    l_scratch_t *scratch = l_get_scratch(L);
+    l_scratch_grow(L, scratch, size);
+    int32_t *data = scratch->data;
+    
+    size_t i;
+    for(i = 0; i < size; i++) {
+        lua_rawgeti(L, idx, i + 1);
+        data[i] = lua_tointeger(L, -1);
+        lua_pop(L, 1);
+    }
+    
+    *n = size;
+    return data;
+}
+
+
 /////////////////////////////////////////////////////////////////////
 // Global initialization.
 // 
@@ -209,6 +678,7 @@ static int l_throw_error(lua_State *L) {
 // @function init
 static int l_yices_init(lua_State *L) {
     yices_init();
+    l_generation++;
     l_throw_error(L);
     return 0;
 }
@@ -227,86 +697,177 @@ static int l_yices_init(lua_State *L) {
 // @function exit
 static int l_yices_exit(lua_State *L) {
     yices_exit();
+    l_generation++;
     return 0;
 }
 
 
 /////////////////////////////////////////////////////////////////////
-// Creates a new context.
+// Creates a new context configuration.
 // 
-// This function allocates and initializes a new context and stores
-// it in the registry, using the parameter as location.
+// The configuration is returned as a `yices.config` userdata and is
+// deleted when the userdata is collected, if it was not freed before.
+// It can be freed as soon as the contexts using it are created.
 // 
 // [Yices context creation and configuration](http://yices.csl.sri.com/doc/context-operations.html#creation-and-configuration)
 // 
-// @function new_context
-// @tparam string loc Location to be used as index for storing the
-// context in the registry.
+// @function new_config
 // 
-// @raise Error if an error occurs while creating the context.
-static int l_yices_new_context(lua_State *L) {
-    context_t *context = yices_new_context(NULL);
-    if(context == NULL) {
+// @treturn userdata Handle to the configuration.
+// 
+// @raise Error if an error occurs while creating the configuration.
+static int l_yices_new_config(lua_State *L) {
+    l_config_t *handle = (l_config_t *) lua_newuserdata(L, sizeof(l_config_t));
+    handle->config = NULL;
+    handle->generation = l_generation;
+    luaL_getmetatable(L, L_CONFIG_MT);
+    lua_setmetatable(L, -2);
+    
+    handle->config = yices_new_config();
+    if(handle->config == NULL) {
         l_throw_error(L);
         return 0;
     }
     
-    // get the location where to store the context
-    const char *loc = lua_tostring(L, 1);
+    return 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Deletes a context configuration.
+// 
+// [Yices context creation and configuration](http://yices.csl.sri.com/doc/context-operations.html#creation-and-configuration)
+// 
+// @function free_config
+// @tparam userdata cfg The configuration to be deleted.
+static int l_yices_free_config(lua_State *L) {
+    l_config_t *handle = (l_config_t *) luaL_checkudata(L, 1, L_CONFIG_MT);
     
-    // store the context in the registry
-    lua_pushstring(L, loc);
-    lua_pushlightuserdata(L, context);
-    lua_settable(L, LUA_REGISTRYINDEX);
+    // configurations from a previous initialization were already deleted
+    if(handle->config != NULL && handle->generation == l_generation)
+        yices_free_config(handle->config);
+    handle->config = NULL;
     
     return 0;
 }
 
 
 /////////////////////////////////////////////////////////////////////
-// Retrieves the context stored in the registry.
+// Sets a parameter of a context configuration.
 // 
-// @function l_retrieve_context
-// @local here
-// @tparam lua_State* L Pointer to lua state.
-// @tparam string loc Location where the context is stored.
+// The parameters are the ones listed in the Yices documentation,
+// e.g. `mode` (`one-shot`, `multi-checks`, `push-pop`, `interactive`),
+// `solver-type`, `uf-solver` or `arith-solver`.
 // 
-// @treturn context_t* Pointer to the context.
-static context_t * l_retrieve_context(lua_State *L, const char *loc) {
-    context_t *context;
+// [Yices context creation and configuration](http://yices.csl.sri.com/doc/context-operations.html#creation-and-configuration)
+// 
+// @function set_config
+// @tparam userdata cfg The configuration to be changed.
+// @tparam string name Name of the parameter.
+// @tparam string value Value of the parameter.
+// 
+// @raise Error if the parameter or its value is not valid.
+static int l_yices_set_config(lua_State *L) {
+    // get the parameters for the function
+    ctx_config_t *config = l_check_config(L, 1);
+    const char *name = luaL_checkstring(L, 2);
+    const char *value = luaL_checkstring(L, 3);
+    
+    if(yices_set_config(config, name, value) < 0)
+        l_throw_error(L);
+    
+    return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Prepares a context configuration for the given logic.
+// 
+// The logic is an SMT-LIB logic name such as `QF_LRA` or `QF_UFLIRA`.
+// The solver mode is not changed by this function.
+// 
+// [Yices context creation and configuration](http://yices.csl.sri.com/doc/context-operations.html#creation-and-configuration)
+// 
+// @function default_config_for_logic
+// @tparam userdata cfg The configuration to be changed.
+// @tparam string logic Name of the logic.
+// 
+// @raise Error if the logic is unknown or not supported.
+static int l_yices_default_config_for_logic(lua_State *L) {
+    // get the parameters for the function
+    ctx_config_t *config = l_check_config(L, 1);
+    const char *logic = luaL_checkstring(L, 2);
     
-    // get the context from the registry
-    lua_pushstring(L, loc);
-    lua_gettable(L, LUA_REGISTRYINDEX);
-    context = (context_t *) lua_topointer(L, -1);
+    if(yices_default_config_for_logic(config, logic) < 0)
+        l_throw_error(L);
     
-    return context;
+    return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Creates a new context.
+// 
+// This function allocates and initializes a new context and returns
+// it as a `yices.context` userdata. The context is deleted when the
+// userdata is collected, if it was not freed before.
+// 
+// [Yices context creation and configuration](http://yices.csl.sri.com/doc/context-operations.html#creation-and-configuration)
+// 
+// @function new_context
+// @tparam[opt] userdata cfg Configuration of the context. If `nil`
+// the default configuration is used.
+// 
+// @treturn userdata Handle to the context.
+// 
+// @raise Error if an error occurs while creating the context.
+static int l_yices_new_context(lua_State *L) {
+    // get the parameters for the function
+    ctx_config_t *config = NULL;
+    if(!lua_isnoneornil(L, 1))
+        config = l_check_config(L, 1);
+    
+    // allocate the handle before the context, so a memory error
+    // does not leak the context
+    l_context_t *handle = (l_context_t *) lua_newuserdata(L, sizeof(l_context_t));
+    handle->context = NULL;
+    handle->generation = l_generation;
+    handle->assuming = false;
+    handle->watchdog = NULL;
+    luaL_getmetatable(L, L_CONTEXT_MT);
+    lua_setmetatable(L, -2);
+    
+    handle->context = yices_new_context(config);
+    if(handle->context == NULL) {
+        l_throw_error(L);
+        return 0;
+    }
+    
+    return 1;
 }
 
 
 /////////////////////////////////////////////////////////////////////
 // Delete the context.
 // 
-// The context is also removed from the registry.
+// The handle is kept, but it can not be used anymore. Freeing a
+// context twice has no effect.
 // 
 // [Yices context creation and configuration](http://yices.csl.sri.com/doc/context-operations.html#creation-and-configuration)
 // 
 // @function free_context
-// @tparam string loc Location where the context is stored.
+// @tparam userdata ctx The context to be deleted.
 static int l_yices_free_context(lua_State *L) {
-    // get the location where the context is stored
-    const char *loc = lua_tostring(L, 1);
+    l_context_t *handle = (l_context_t *) luaL_checkudata(L, 1, L_CONTEXT_MT);
     
-    // get the context from the registry
-    context_t *context = l_retrieve_context(L, loc);
-    
-    // remove the context from the registry
-    lua_pushstring(L, loc);
-    lua_pushnil(L);
-    lua_settable(L, LUA_REGISTRYINDEX);
-    
-    // free the context
-    yices_free_context(context);
+    // contexts from a previous initialization were already deleted
+    // the watchdog is stopped before its context is deleted
+    if(handle->watchdog != NULL)
+        l_watchdog_free(handle->watchdog);
+    handle->watchdog = NULL;
+    if(handle->context != NULL && handle->generation == l_generation)
+        yices_free_context(handle->context);
+    handle->context = NULL;
     
     return 0;
 }
@@ -318,15 +879,12 @@ static int l_yices_free_context(lua_State *L) {
 // [Yices push and pop](http://yices.csl.sri.com/doc/context-operations.html#push-and-pop)
 // 
 // @function mark_backtrack
-// @tparam string ctx The context where to mark the backtracking point.
+// @tparam userdata ctx The context where to mark the backtracking point.
 // 
 // @raise Error if an error occurs while marking the backtracking point.
 static int l_yices_push(lua_State *L) {
-    // get the location where the context is stored
-    const char *ctx = lua_tostring(L, 1);
-    
-    // get the context from the registry
-    context_t *context = l_retrieve_context(L, ctx);
+    // get the context
+    context_t *context = l_check_idle_context(L, 1);
     
     // mark the backtracking point
     int32_t error = yices_push(context);
@@ -343,15 +901,12 @@ static int l_yices_push(lua_State *L) {
 // [Yices push and pop](http://yices.csl.sri.com/doc/context-operations.html#push-and-pop)
 // 
 // @function backtrack
-// @tparam string ctx The context where to backtrack.
+// @tparam userdata ctx The context where to backtrack.
 // 
 // @raise Error if an error occurs while backtracking.
 static int l_yices_pop(lua_State *L) {
-    // get the location where the context is stored
-    const char *ctx = lua_tostring(L, 1);
-    
-    // get the context from the registry
-    context_t *context = l_retrieve_context(L, ctx);
+    // get the context
+    context_t *context = l_check_idle_context(L, 1);
     
     // backtracks
     int32_t error = yices_pop(context);
@@ -446,15 +1001,8 @@ static int l_yices_bool_type(lua_State *L) {
 // @raise Error if an error occurs while creating the type.
 static int l_yices_function_type(lua_State *L) {
     // get the parameters for the function
-    int d_size = lua_objlen(L, 1);
-    int f_dom[d_size];
-    lua_pushnil(L);
-    int i = 0;
-    while (lua_next(L, 1) != 0) {
-        f_dom[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-        i++;
-    }
+    uint32_t d_size;
+    int32_t *f_dom = l_check_array(L, 1, &d_size);
     int f_typ = lua_tonumber(L, 2);
     
     // create the function type
@@ -525,7 +1073,7 @@ static int l_yices_new_uninterpreted_term(lua_State *L) {
          return 0;
     }
     
-    if (lua_isnil(L, 2) == 1) {
+    if (!lua_isnoneornil(L, 2)) {
         const char *name = lua_tostring(L, 2);
         yices_set_term_name(term, name);
     }
@@ -545,12 +1093,16 @@ static int l_yices_new_uninterpreted_term(lua_State *L) {
 // 
 // @treturn number Integer representing the term.
 // 
-// @raise Error if an error occurs while creating the term.
-static int l_yices_int32(lua_State *L) {
+// @raise Error if `val` is not an integer or an error occurs while
+// creating the term.
+static int l_yices_int64(lua_State *L) {
     // get the parameters for the function
-    int32_t val = lua_tonumber(L, 1);
+    lua_Number val = luaL_checknumber(L, 1);
+    
+    if (val != floor(val) || fabs(val) >= 9.2e18)
+        return luaL_argerror(L, 1, "integer expected");
     
-    term_t term = yices_int32(val);
+    term_t term = yices_int64((int64_t) val);
     
     if (term == NULL_TERM) {
          l_throw_error(L);
@@ -565,19 +1117,30 @@ static int l_yices_int32(lua_State *L) {
 /////////////////////////////////////////////////////////////////////
 // Converts `val` to a constant real term.
 // 
+// A number is converted to the rational with exactly its value,
+// without going through its decimal representation. A string is
+// parsed as a decimal float (e.g. `"1.5"` or `"-2e3"`).
+// 
 // [Yices arithmetic terms](http://yices.csl.sri.com/doc/term-operations.html#arithmetic-terms)
 // 
 // @function real_term
-// @tparam string val Float to be converted to a term.
+// @tparam number|string val Number to be converted to a term.
 // 
 // @treturn number Integer representing the term.
 // 
-// @raise Error if an error occurs while creating the term.
-static int l_yices_parse_float(lua_State *L) {
-    // get the parameters for the function
-    const char *val = lua_tostring(L, 1);
+// @raise Error if `val` is not a finite number or an error occurs
+// while creating the term.
+static int l_yices_real(lua_State *L) {
+    term_t term;
     
-    term_t term = yices_parse_float(val);
+    if (lua_type(L, 1) == LUA_TNUMBER) {
+        lua_Number val = lua_tonumber(L, 1);
+        if (isnan(val) || isinf(val))
+            return luaL_argerror(L, 1, "finite number expected");
+        term = l_double_term(val);
+    }
+    else
+        term = yices_parse_float(luaL_checkstring(L, 1));
     
     if (term == NULL_TERM) {
          l_throw_error(L);
@@ -630,15 +1193,8 @@ static int l_yices_neg(lua_State *L) {
 // @raise Error if an error occurs while creating the term.
 static int l_yices_sum(lua_State *L) {
     // get the parameters for the function
-    int t_size = lua_objlen(L, 1);
-    int t[t_size];
-    lua_pushnil(L);
-    int i = 0;
-    while (lua_next(L, 1) != 0) {
-        t[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-        i++;
-    }
+    uint32_t t_size;
+    int32_t *t = l_check_array(L, 1, &t_size);
     
     term_t term = yices_sum(t_size, t);
     
@@ -1030,15 +1586,8 @@ static int l_yices_not(lua_State *L) {
 // @raise Error if an error occurs while creating the term.
 static int l_yices_and(lua_State *L) {
     // get the parameters for the function
-    int t_size = lua_objlen(L, 1);
-    int t[t_size];
-    lua_pushnil(L);
-    int i = 0;
-    while (lua_next(L, 1) != 0) {
-        t[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-        i++;
-    }
+    uint32_t t_size;
+    int32_t *t = l_check_array(L, 1, &t_size);
     
     term_t term = yices_and(t_size, t);
     
@@ -1065,15 +1614,8 @@ static int l_yices_and(lua_State *L) {
 // @raise Error if an error occurs while creating the term.
 static int l_yices_or(lua_State *L) {
     // get the parameters for the function
-    int t_size = lua_objlen(L, 1);
-    int t[t_size];
-    lua_pushnil(L);
-    int i = 0;
-    while (lua_next(L, 1) != 0) {
-        t[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-        i++;
-    }
+    uint32_t t_size;
+    int32_t *t = l_check_array(L, 1, &t_size);
     
     term_t term = yices_or(t_size, t);
     
@@ -1194,15 +1736,8 @@ static int l_yices_ite(lua_State *L) {
 // @raise Error if an error occurs while creating the term.
 static int l_yices_distinct(lua_State *L) {
     // get the parameters for the function
-    int t_size = lua_objlen(L, 1);
-    int t[t_size];
-    lua_pushnil(L);
-    int i = 0;
-    while (lua_next(L, 1) != 0) {
-        t[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-        i++;
-    }
+    uint32_t t_size;
+    int32_t *t = l_check_array(L, 1, &t_size);
     
     term_t term = yices_distinct(t_size, t);
     
@@ -1234,15 +1769,8 @@ static int l_yices_distinct(lua_State *L) {
 static int l_yices_application(lua_State *L) {
     // get the parameters for the function
     int fun = lua_tonumber(L, 1);
-    int t_size = lua_objlen(L, 2);
-    int t[t_size];
-    lua_pushnil(L);
-    int i = 0;
-    while (lua_next(L, 2) != 0) {
-        t[i] = lua_tonumber(L, -1);
-        lua_pop(L, 1);
-        i++;
-    }
+    uint32_t t_size;
+    int32_t *t = l_check_array(L, 2, &t_size);
     
     term_t term = yices_application(fun, t_size, t);
     
@@ -1256,6 +1784,121 @@ static int l_yices_application(lua_State *L) {
 }
 
 
+/////////////////////////////////////////////////////////////////////
+// Builds the term of an expression bottom-up.
+// 
+// The terms of the operands of a node are kept in the scratch
+// arena, from position `base`, so nested nodes use the arena as a
+// stack.
+// 
+// @function l_compile
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the expression.
+// @tparam l_scratch_t* scratch The scratch arena.
+// @tparam size_t base First free position of the arena.
+// 
+// @treturn term_t The term.
+// 
+// @raise Error if the expression is not valid or an error occurs
+// while creating a term.
+static term_t l_compile(lua_State *L, int idx, l_scratch_t *scratch, size_t base) {
+    term_t term;
+    
+    switch(lua_type(L, idx)) {
+        case LUA_TNUMBER: {
+            lua_Number val = lua_tonumber(L, idx);
+            if(isnan(val) || isinf(val))
+                luaL_error(L, "invalid constant in expression");
+            term = l_double_term(val);
+            break;
+        }
+        
+        case LUA_TBOOLEAN:
+            term = lua_toboolean(L, idx) ? yices_true() : yices_false();
+            break;
+        
+        case LUA_TTABLE: {
+            luaL_checkstack(L, 2, "expression too deep");
+            lua_rawgeti(L, idx, 1);
+            const char *name = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            
+            // an existing term
+            if(name == NULL) {
+                lua_getfield(L, idx, "index");
+                if(lua_type(L, -1) != LUA_TNUMBER)
+                    luaL_error(L, "invalid operand in expression");
+                term = lua_tointeger(L, -1);
+                lua_pop(L, 1);
+                break;
+            }
+            
+            size_t n = lua_objlen(L, idx) - 1;
+            int op = l_find_operator(name, n);
+            if(op == -1)
+                luaL_error(L, "unknown operator '%s' in expression", name);
+            if(op == -2)
+                luaL_error(L, "wrong number of operands for '%s'", name);
+            
+            // build the operands
+            size_t i;
+            l_scratch_grow(L, scratch, base + n);
+            for(i = 0; i < n; i++) {
+                lua_rawgeti(L, idx, i + 2);
+                term_t t = l_compile(L, lua_gettop(L), scratch, base + n);
+                lua_pop(L, 1);
+                scratch->data[base + i] = t;
+            }
+            
+            term = l_apply_operator(op, n, scratch->data + base);
+            break;
+        }
+        
+        default:
+            luaL_error(L, "invalid operand in expression");
+            return NULL_TERM;
+    }
+    
+    if(term == NULL_TERM)
+        l_throw_error(L);
+    return term;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Builds the term of a whole expression in a single call.
+// 
+// The expression is a tree of Lua values:
+// 
+// * a table `{op, e1, ..., en}` applies operator `op` to the terms
+//   of the sub-expressions `e1` ... `en`;
+// * a table with an `index` field (a term object) is that term;
+// * a number is the real constant with exactly its value;
+// * a boolean is the constant `true` or `false`.
+// 
+// The operators are `and`, `or`, `not`, `iff`, `imp`, `ite`, `eq`,
+// `ne`, `ge`, `le`, `gt`, `lt`, `sum`, `sub`, `mul`, `div`, `neg`,
+// `distinct` and `apply` (whose first operand is the function). They
+// build the same terms as the function of the same name.
+// 
+// @function compile_term
+// @tparam table exp The expression.
+// 
+// @treturn number Integer representing the term.
+// 
+// @raise Error if the expression is not valid or an error occurs
+// while creating a term.
+// 
+// @usage compile_term({'ite', c, {'le', x, 0}, {'gt', {'sum', x, y}, 1.5}})
+static int l_yices_compile_term(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+    
+    lua_pushinteger(L, l_compile(L, 1, l_get_scratch(L), 0));
+    return 1;
+}
+
+
 /////////////////////////////////////////////////////////////////////
 // Creates a term from an expression.
 // 
@@ -1303,6 +1946,54 @@ static int l_yices_get_term_by_name(lua_State *L) {
 }
 
 
+/////////////////////////////////////////////////////////////////////
+// Converts a term to an expression in the Yices language, which can
+// be given back to `parse_term`. Constants are written by name, so
+// the term is parsed back to the same term only if its constants
+// are named and their names are not redefined.
+//
+// @function term_to_string
+// @tparam number term Integer representing the term.
+//
+// @treturn string The expression, in a single line.
+//
+// @raise Error if the term is not valid.
+static int l_yices_term_to_string(lua_State *L) {
+    term_t term = luaL_checkinteger(L, 1);
+    
+    char *str = yices_term_to_string(term, UINT32_MAX, UINT32_MAX, 0);
+    if(str == NULL)
+        l_throw_error(L);
+    
+    lua_pushstring(L, str);
+    yices_free_string(str);
+    return 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Converts a type to an expression in the Yices language, which can
+// be given back to `parse_type`.
+//
+// @function type_to_string
+// @tparam number type Integer representing the type.
+//
+// @treturn string The expression, in a single line.
+//
+// @raise Error if the type is not valid.
+static int l_yices_type_to_string(lua_State *L) {
+    type_t type = luaL_checkinteger(L, 1);
+    
+    char *str = yices_type_to_string(type, UINT32_MAX, UINT32_MAX, 0);
+    if(str == NULL)
+        l_throw_error(L);
+    
+    lua_pushstring(L, str);
+    yices_free_string(str);
+    return 1;
+}
+
+
 /////////////////////////////////////////////////////////////////////
 // Asserts a formula.
 // 
@@ -1312,18 +2003,15 @@ static int l_yices_get_term_by_name(lua_State *L) {
 // [Yices assertions](http://yices.csl.sri.com/doc/context-operations.html#assertions-and-satisfiability-checks)
 // 
 // @function assert_formula
-// @tparam string ctx The context where to assert the formula.
+// @tparam userdata ctx The context where to assert the formula.
 // @tparam number t Integer representing the term to be asserted.
 // 
 // @raise Error if an error occurs while asserting the formula.
 static int l_yices_assert_formula(lua_State *L) {
     // get the parameters for the function
-    const char *ctx = lua_tostring(L, 1);
+    context_t *context = l_check_idle_context(L, 1);
     int term = lua_tonumber(L, 2);
     
-    // get the context from the registry
-    context_t *context = l_retrieve_context(L, ctx);
-    
     // assert the expression
     int32_t error = yices_assert_formula(context, term);
     if(error)
@@ -1334,127 +2022,328 @@ static int l_yices_assert_formula(lua_State *L) {
 
 
 /////////////////////////////////////////////////////////////////////
-// Checks whether a context is satisfiable.
+// Asserts a list of formulas.
 // 
-// [Yices check](http://yices.csl.sri.com/doc/context-operations.html#assertions-and-satisfiability-checks)
+// This function asserts formulas t[0] ... t[n-1] in context ctx in a
+// single call. All terms must be Boolean.
 // 
-// @function check_context
-// @tparam string ctx The context to check.
+// [Yices assertions](http://yices.csl.sri.com/doc/context-operations.html#assertions-and-satisfiability-checks)
 // 
-// @treturn bool True if the context is satisfiable and false
-// otherwise, returns `nil` for any other result.
+// @function assert_formulas
+// @tparam userdata ctx The context where to assert the formulas.
+// @tparam table t Table with the terms to be asserted.
 // 
-// @raise Error if an error occurs while checking the context.
-static int l_yices_check_context(lua_State *L) {
+// @raise Error if an error occurs while asserting the formulas.
+static int l_yices_assert_formulas(lua_State *L) {
     // get the parameters for the function
-    const char *ctx = lua_tostring(L, 1);
+    context_t *context = l_check_idle_context(L, 1);
+    uint32_t t_size;
+    int32_t *t = l_check_array(L, 2, &t_size);
+    
+    // assert the expressions
+    int32_t error = yices_assert_formulas(context, t_size, t);
+    if(error)
+         l_throw_error(L);
+    
+    return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Reads the search options of a check. Field `timeout_ms` gives the
+// time limit of the search, the other fields are set as search
+// parameters in a new parameter record.
+// 
+// @function l_check_params
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the options table.
+// @tparam double* timeout Where to store the time limit (0 if none).
+// 
+// @treturn param_t* The parameter record or `NULL` if no parameter
+// was given. It must be freed by the caller.
+// 
+// @raise Error if a parameter or its value is not valid.
+static param_t * l_check_params(lua_State *L, int idx, double *timeout) {
+    param_t *params = NULL;
+    *timeout = 0;
+    
+    if(lua_isnoneornil(L, idx))
+        return NULL;
+    luaL_checktype(L, idx, LUA_TTABLE);
     
-    // get the context from the registry
-    context_t *context = l_retrieve_context(L, ctx);
+    lua_pushnil(L);
+    while(lua_next(L, idx) != 0) {
+        if(lua_type(L, -2) != LUA_TSTRING) {
+            if(params != NULL)
+                yices_free_param_record(params);
+            luaL_argerror(L, idx, "option names must be strings");
+        }
+        const char *name = lua_tostring(L, -2);
+        
+        if(strcmp(name, "timeout_ms") == 0)
+            *timeout = lua_tonumber(L, -1);
+        else {
+            const char *value;
+            if(lua_isboolean(L, -1))
+                value = lua_toboolean(L, -1) ? "true" : "false";
+            else
+                value = lua_tostring(L, -1);
+            
+            if(params == NULL)
+                params = yices_new_param_record();
+            if(value == NULL || yices_set_param(params, name, value) < 0) {
+                yices_free_param_record(params);
+                if(value == NULL)
+                    luaL_argerror(L, idx, "invalid value for a search parameter");
+                l_throw_error(L);
+            }
+        }
+        lua_pop(L, 1);
+    }
+    
+    return params;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Runs the search of a check, under the watchdog of the context if
+// there is a time limit. The parameter record is freed.
+// 
+// @function l_search
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam l_context_t* handle The context to check.
+// @tparam param_t* params Search parameters (may be `NULL`).
+// @tparam double timeout Time limit in milliseconds (0 if none).
+// @tparam uint32_t n Number of assumptions.
+// @tparam term_t* t The assumptions.
+// 
+// @treturn smt_status_t The result of the check.
+// 
+// @raise Error if the watchdog can not be started.
+static smt_status_t l_search(lua_State *L, l_context_t *handle, param_t *params, double timeout, uint32_t n, const term_t *t) {
+    context_t *context = handle->context;
+    
+    // arm the watchdog, started by the first bounded check
+    bool guarded = timeout > 0;
+    if(guarded && handle->watchdog == NULL)
+        handle->watchdog = l_watchdog_new(context);
+    if(guarded && handle->watchdog == NULL) {
+        if(params != NULL)
+            yices_free_param_record(params);
+        luaL_error(L, "could not start the watchdog for the check");
+    }
+    if(guarded)
+        l_watchdog_arm(handle->watchdog, timeout);
     
     // check the context
-    switch(yices_check_context(context, NULL)) {
+    smt_status_t status;
+#if L_NATIVE_ASSUMPTIONS
+    if(n > 0)
+        status = yices_check_context_with_assumptions(context, params, n, t);
+    else
+        status = yices_check_context(context, params);
+#else
+    (void) n;
+    (void) t;
+    status = yices_check_context(context, params);
+#endif
+    
+    if(guarded)
+        l_watchdog_arm(handle->watchdog, 0);
+    if(params != NULL)
+        yices_free_param_record(params);
+    
+    return status;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Pushes the result of a check.
+// 
+// @function l_push_status
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam smt_status_t status The result of the check.
+// 
+// @treturn int Number of values pushed.
+// 
+// @raise Error if the check failed.
+static int l_push_status(lua_State *L, smt_status_t status) {
+    switch(status) {
         case STATUS_SAT:
             lua_pushboolean(L, 1); // return true
-            break;
+            return 1;
         
         case STATUS_UNSAT:
             lua_pushboolean(L, 0); // return false
-            break;
+            return 1;
         
         case STATUS_ERROR:
             l_throw_error(L);
             return 0;
         
+        case STATUS_INTERRUPTED:
+            lua_pushnil(L);
+            lua_pushstring(L, "interrupted");
+            return 2;
+        
         default:
             lua_pushnil(L); // return nill
+            lua_pushstring(L, "unknown");
+            return 2;
     }
-    
-    return 1;
 }
 
 
 /////////////////////////////////////////////////////////////////////
-// Builds a model from a satisfiable context.
+// Checks whether a context is satisfiable.
 // 
-// The model created by this function is stored in the registry.
+// The search may be configured by table `options`. Field `timeout_ms`
+// bounds the time of the search: a watchdog thread stops the search
+// when the time limit passes. The other fields are set as search
+// parameters, e.g. `branching` or `randomness`.
 // 
-// [Yices model](http://yices.csl.sri.com/doc/model-operations.html)
+// An interrupted search leaves the context in a state where only
+// `backtrack` (or deleting the context) is allowed.
 // 
-// @function get_model
-// @tparam string ctx The context to check.
-// @tparam string loc Location to be used as index for storing the
-// model in the registry.
+// [Yices check](http://yices.csl.sri.com/doc/context-operations.html#assertions-and-satisfiability-checks)
 // 
-// @raise Error if an error occurs while building the model.
-static int l_yices_get_model(lua_State *L) {
-    // get the context from the registry
-    const char *ctx = lua_tostring(L, 1);
-    context_t *context = l_retrieve_context(L, ctx);
+// [Yices search parameters](http://yices.csl.sri.com/doc/parameters.html)
+// 
+// @function check_context
+// @tparam userdata ctx The context to check.
+// @tparam[opt] table options Options of the search.
+// 
+// @treturn bool True if the context is satisfiable and false
+// otherwise, returns `nil` for any other result.
+// @treturn string If the result is `nil`, `"interrupted"` when the
+// search was stopped and `"unknown"` otherwise.
+// 
+// @raise Error if an option is not valid or an error occurs while
+// checking the context.
+static int l_yices_check_context(lua_State *L) {
+    // get the parameters for the function
+    l_check_idle_context(L, 1);
+    l_context_t *handle = (l_context_t *) lua_touserdata(L, 1);
+    double timeout;
+    param_t *params = l_check_params(L, 2, &timeout);
     
-    // build a model for the context
-    model_t *model = yices_get_model(context, true);
-    if(model == NULL) {
+    return l_push_status(L, l_search(L, handle, params, timeout, 0, NULL));
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Checks whether a context is satisfiable under assumptions.
+// 
+// The Boolean literals t[1] ... t[n] are assumed to be true during
+// the check only, so they are dropped by the next operation on the
+// context, while what the solver learned is kept. The model of a
+// satisfiable check satisfies the assumptions.
+// 
+// Yices versions before 2.6 do not support assumptions. In that case
+// the literals are asserted in a backtracking point, which is kept
+// open until the next operation on the context. The context must
+// therefore support backtracking.
+// 
+// [Yices check](http://yices.csl.sri.com/doc/context-operations.html#assertions-and-satisfiability-checks)
+// 
+// @function check_with_assumptions
+// @tparam userdata ctx The context to check.
+// @tparam table t Table with the literals to be assumed.
+// @tparam[opt] table options Options of the search (see `check_context`).
+// 
+// @treturn bool True if the context is satisfiable and false
+// otherwise, returns `nil` for any other result.
+// @treturn string If the result is `nil`, `"interrupted"` when the
+// search was stopped and `"unknown"` otherwise.
+// 
+// @raise Error if an option or a literal is not valid or an error
+// occurs while checking the context.
+static int l_yices_check_with_assumptions(lua_State *L) {
+    // get the parameters for the function
+    context_t *context = l_check_idle_context(L, 1);
+    uint32_t t_size;
+    int32_t *t = l_check_array(L, 2, &t_size);
+    double timeout;
+    param_t *params = l_check_params(L, 3, &timeout);
+    
+    l_context_t *handle = (l_context_t *) lua_touserdata(L, 1);
+#if !L_NATIVE_ASSUMPTIONS
+    // assert the literals in a backtracking point left open
+    if(yices_push(context) != 0) {
+        if(params != NULL)
+            yices_free_param_record(params);
         l_throw_error(L);
-        return 0;
     }
+    handle->assuming = true;
+    if(yices_assert_formulas(context, t_size, t) != 0) {
+        if(params != NULL)
+            yices_free_param_record(params);
+        l_throw_error(L);
+    }
+    t_size = 0;
+#endif
     
-    // get the location where to store the context
-    const char *loc = lua_tostring(L, 2);
-    
-    // store the model in the registry
-    lua_pushstring(L, loc);
-    lua_pushlightuserdata(L, model);
-    lua_settable(L, LUA_REGISTRYINDEX);
-    
-    return 0;
+    return l_push_status(L, l_search(L, handle, params, timeout, t_size, t));
 }
 
 
 /////////////////////////////////////////////////////////////////////
-// Retrieves the model stored in the registry.
+// Builds a model from a satisfiable context.
 // 
-// @function l_retrieve_model
-// @local here
-// @tparam lua_State* L Pointer to lua state.
-// @tparam string loc Location where the model is stored.
+// The model is returned as a `yices.model` userdata. The model is
+// deleted when the userdata is collected, if it was not freed before.
 // 
-// @treturn model_t* Pointer to the model.
-static model_t * l_retrieve_model(lua_State *L, const char *loc) {
-    model_t *model;
+// [Yices model](http://yices.csl.sri.com/doc/model-operations.html)
+// 
+// @function get_model
+// @tparam userdata ctx The context to check.
+// 
+// @treturn userdata Handle to the model.
+// 
+// @raise Error if an error occurs while building the model.
+static int l_yices_get_model(lua_State *L) {
+    // get the context
+    context_t *context = l_check_context(L, 1);
     
-    // get the model from the registry
-    lua_pushstring(L, loc);
-    lua_gettable(L, LUA_REGISTRYINDEX);
-    model = (model_t *) lua_topointer(L, -1);
+    // allocate the handle before the model, so a memory error does
+    // not leak the model
+    l_model_t *handle = (l_model_t *) lua_newuserdata(L, sizeof(l_model_t));
+    handle->model = NULL;
+    handle->generation = l_generation;
+    luaL_getmetatable(L, L_MODEL_MT);
+    lua_setmetatable(L, -2);
     
-    return model;
+    // build a model for the context
+    handle->model = yices_get_model(context, true);
+    if(handle->model == NULL) {
+        l_throw_error(L);
+        return 0;
+    }
+    
+    return 1;
 }
 
 
 /////////////////////////////////////////////////////////////////////
 // Delete the model.
 // 
-// The model is also removed from the registry.
+// The handle is kept, but it can not be used anymore. Freeing a
+// model twice has no effect.
 // 
 // [Yices model](http://yices.csl.sri.com/doc/model-operations.html)
 // 
 // @function free_model
-// @tparam string loc The model to be deleted.
+// @tparam userdata mdl The model to be deleted.
 static int l_yices_free_model(lua_State *L) {
-    // get the location where the context is stored
-    const char *loc = lua_tostring(L, 1);
-    
-    // get the model from the registry
-    model_t *model = l_retrieve_model(L, loc);
-    
-    // remove the model from the registry
-    lua_pushstring(L, loc);
-    lua_pushnil(L);
-    lua_settable(L, LUA_REGISTRYINDEX);
+    l_model_t *handle = (l_model_t *) luaL_checkudata(L, 1, L_MODEL_MT);
     
-    // free the model
-    yices_free_model(model);
+    // models from a previous initialization were already deleted
+    if(handle->model != NULL && handle->generation == l_generation)
+        yices_free_model(handle->model);
+    handle->model = NULL;
     
     return 0;
 }
@@ -1466,7 +2355,7 @@ static int l_yices_free_model(lua_State *L) {
 // [Yices value of term](http://yices.csl.sri.com/doc/model-operations.html#value-of-a-term-in-a-model)
 // 
 // @function get_bool_value
-// @tparam string mdl The model where to evaluate the term.
+// @tparam userdata mdl The model where to evaluate the term.
 // @tparam number term Integer representing the term to be evaluated.
 // 
 // @return The value of the term.
@@ -1474,12 +2363,9 @@ static int l_yices_free_model(lua_State *L) {
 // @raise Error if there is a problem evaluating the term.
 static int l_yices_get_bool_value(lua_State *L) {
     // get the parameters for the function
-    const char *mdl = lua_tostring(L, 1);
+    model_t *model = l_check_model(L, 1);
     int term = lua_tonumber(L, 2);
     
-    // get the model from the registry
-    model_t *model = l_retrieve_model(L, mdl);
-    
     // get the value
     int32_t ival;
     if(yices_get_bool_value(model, term, &ival) == 0) {
@@ -1499,7 +2385,7 @@ static int l_yices_get_bool_value(lua_State *L) {
 // [Yices value of term](http://yices.csl.sri.com/doc/model-operations.html#value-of-a-term-in-a-model)
 // 
 // @function get_int_value
-// @tparam string mdl The model where to evaluate the term.
+// @tparam userdata mdl The model where to evaluate the term.
 // @tparam number term Integer representing the term to be evaluated.
 // 
 // @return The value of the term.
@@ -1507,12 +2393,9 @@ static int l_yices_get_bool_value(lua_State *L) {
 // @raise Error if there is a problem evaluating the term.
 static int l_yices_get_int_value(lua_State *L) {
     // get the parameters for the function
-    const char *mdl = lua_tostring(L, 1);
+    model_t *model = l_check_model(L, 1);
     int term = lua_tonumber(L, 2);
     
-    // get the model from the registry
-    model_t *model = l_retrieve_model(L, mdl);
-    
     // get the value
     int32_t ival;
     if(yices_get_int32_value(model, term, &ival) == 0) {
@@ -1532,7 +2415,7 @@ static int l_yices_get_int_value(lua_State *L) {
 // [Yices value of term](http://yices.csl.sri.com/doc/model-operations.html#value-of-a-term-in-a-model)
 // 
 // @function get_real_value
-// @tparam string mdl The model where to evaluate the term.
+// @tparam userdata mdl The model where to evaluate the term.
 // @tparam number term Integer representing the term to be evaluated.
 // 
 // @return The value of the term.
@@ -1540,12 +2423,9 @@ static int l_yices_get_int_value(lua_State *L) {
 // @raise Error if there is a problem evaluating the term.
 static int l_yices_get_real_value(lua_State *L) {
     // get the parameters for the function
-    const char *mdl = lua_tostring(L, 1);
+    model_t *model = l_check_model(L, 1);
     int term = lua_tonumber(L, 2);
     
-    // get the model from the registry
-    model_t *model = l_retrieve_model(L, mdl);
-    
     // get the value
     double dval;
     if(yices_get_double_value(model, term, &dval) == 0) {
@@ -1559,6 +2439,230 @@ static int l_yices_get_real_value(lua_State *L) {
 }
 
 
+/////////////////////////////////////////////////////////////////////
+// Get the values of a list of terms for a satisfiable context.
+// 
+// Terms t[1] ... t[n] are evaluated in `mdl` in a single call. The
+// kind of each term is given by the type k[i], which may be the
+// `Bool`, `Int` or `Real` primitive type. The values are stored in
+// table `v` at the same positions as the terms, so a table may be
+// reused across calls.
+// 
+// [Yices value of term](http://yices.csl.sri.com/doc/model-operations.html#value-of-a-term-in-a-model)
+// 
+// @function get_values
+// @tparam userdata mdl The model where to evaluate the terms.
+// @tparam table t Table with the terms to be evaluated.
+// @tparam table k Table with the type of each term.
+// @tparam[opt] table v Table where to store the values.
+// 
+// @treturn table The table with the values of the terms.
+// 
+// @raise Error if there is a problem evaluating one of the terms.
+static int l_yices_get_values(lua_State *L) {
+    // get the parameters for the function
+    model_t *model = l_check_model(L, 1);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    luaL_checktype(L, 3, LUA_TTABLE);
+    int t_size = lua_objlen(L, 2);
+    if(lua_istable(L, 4))
+        lua_settop(L, 4);
+    else {
+        lua_settop(L, 3);
+        lua_createtable(L, t_size, 0);
+    }
+    
+    type_t bool_type = yices_bool_type();
+    type_t int_type = yices_int_type();
+    
+    // get the values
+    int i;
+    for(i = 1; i <= t_size; i++) {
+        lua_rawgeti(L, 2, i);
+        term_t term = lua_tointeger(L, -1);
+        lua_rawgeti(L, 3, i);
+        type_t kind = lua_tointeger(L, -1);
+        lua_pop(L, 2);
+        
+        int32_t ival;
+        double dval;
+        if(kind == bool_type) {
+            if(yices_get_bool_value(model, term, &ival) != 0)
+                l_throw_error(L);
+            lua_pushboolean(L, ival);
+        }
+        else if(kind == int_type) {
+            if(yices_get_int32_value(model, term, &ival) != 0)
+                l_throw_error(L);
+            lua_pushinteger(L, ival);
+        }
+        else {
+            if(yices_get_double_value(model, term, &dval) != 0)
+                l_throw_error(L);
+            lua_pushnumber(L, dval);
+        }
+        lua_rawseti(L, 4, i);
+    }
+    
+    return 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Evaluates a piecewise polynomial at a list of times. The loops run
+// over the times, without branches or calls, so the compiler can
+// vectorize them.
+// 
+// @function l_sample_kernel
+// @local here
+// @tparam size_t n Number of times.
+// @tparam double* t The times.
+// @tparam double* c The coefficients (c[0] + c[1]*x + ...).
+// @tparam size_t m Number of coefficients.
+// @tparam double ti Time at which the polynomial begins (x = t - ti).
+// @tparam double te Time at which the polynomial ends.
+// @tparam double before Value before `ti`.
+// @tparam double after Value after `te`.
+// @tparam double* x Scratch space for `n` values.
+// @tparam double* v Where to store the `n` values.
+static void l_sample_kernel(size_t n, const double *restrict t, const double *restrict c, size_t m,
+                            double ti, double te, double before, double after,
+                            double *restrict x, double *restrict v) {
+    size_t j, k;
+    double top = m > 0 ? c[m - 1] : 0.0;
+    for(j = 0; j < n; j++) {
+        x[j] = t[j] - ti;
+        v[j] = top;
+    }
+    
+    // Horner's rule, one coefficient for all the times at a time
+    for(k = m > 0 ? m - 1 : 0; k-- > 0;) {
+        double ck = c[k];
+        for(j = 0; j < n; j++)
+            v[j] = v[j] * x[j] + ck;
+    }
+    
+    for(j = 0; j < n; j++)
+        v[j] = t[j] < ti ? before : (t[j] > te ? after : v[j]);
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Gets a number field of a table.
+// 
+// @function l_number_field
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the table.
+// @tparam char* name Name of the field.
+// @tparam double def Value if the field is `nil`.
+// 
+// @treturn double The value of the field.
+static double l_number_field(lua_State *L, int idx, const char *name, double def) {
+    lua_getfield(L, idx, name);
+    double val = lua_isnil(L, -1) ? def : luaL_checknumber(L, -1);
+    lua_pop(L, 1);
+    return val;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Samples piecewise polynomials (as the solved animations of
+// `model.animation.polynomial`) at a list of times, without the
+// solver.
+// 
+// Each piece is a table with the polynomial coefficients `coef`
+// (`coef[1] + coef[2]*x + ...`, where `x = t - ti`), the times `ti`
+// and `te` at which the polynomial begins and ends, the values
+// `before` and `after` outside of it and `value`, used instead of a
+// missing `before` or `after`.
+// 
+// @function sample_polynomials
+// @tparam table pieces List of pieces.
+// @tparam table times List of times.
+// 
+// @treturn table List with the values of each piece at the times.
+// 
+// @raise Error if one of the pieces is not valid.
+static int l_yices_sample_polynomials(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    size_t n_pieces = lua_objlen(L, 1);
+    size_t n = lua_objlen(L, 2);
+    
+    // room for the times, the scratch, the values and the coefficients
+    size_t i, j, m_max = 0;
+    for(i = 1; i <= n_pieces; i++) {
+        lua_rawgeti(L, 1, i);
+        luaL_checktype(L, -1, LUA_TTABLE);
+        lua_getfield(L, -1, "coef");
+        luaL_checktype(L, -1, LUA_TTABLE);
+        if(lua_objlen(L, -1) > m_max)
+            m_max = lua_objlen(L, -1);
+        lua_pop(L, 2);
+    }
+    double *t = (double *) lua_newuserdata(L, (3 * n + m_max + 1) * sizeof(double));
+    double *x = t + n;
+    double *v = x + n;
+    double *c = v + n;
+    
+    for(j = 0; j < n; j++) {
+        lua_rawgeti(L, 2, j + 1);
+        t[j] = luaL_checknumber(L, -1);
+        lua_pop(L, 1);
+    }
+    
+    lua_createtable(L, n_pieces, 0);
+    int result = lua_gettop(L);
+    for(i = 1; i <= n_pieces; i++) {
+        lua_rawgeti(L, 1, i);
+        int piece = lua_gettop(L);
+        
+        lua_getfield(L, piece, "coef");
+        size_t k, m = lua_objlen(L, -1);
+        for(k = 0; k < m; k++) {
+            lua_rawgeti(L, -1, k + 1);
+            c[k] = luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+        
+        double value = l_number_field(L, piece, "value", 0.0);
+        l_sample_kernel(n, t, c, m,
+                        l_number_field(L, piece, "ti", 0.0),
+                        l_number_field(L, piece, "te", 0.0),
+                        l_number_field(L, piece, "before", value),
+                        l_number_field(L, piece, "after", value),
+                        x, v);
+        lua_pop(L, 1);
+        
+        lua_createtable(L, n, 0);
+        for(j = 0; j < n; j++) {
+            lua_pushnumber(L, v[j]);
+            lua_rawseti(L, -2, j + 1);
+        }
+        lua_rawseti(L, result, i);
+    }
+    
+    return 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Gets the time of a monotonic clock, which is not changed with the
+// time of the system, to measure the time spent by the searches.
+// 
+// @function clock
+// 
+// @treturn number The time in seconds, from an arbitrary origin.
+static int l_clock(lua_State *L) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    lua_pushnumber(L, (lua_Number) now.tv_sec + now.tv_nsec / 1e9);
+    return 1;
+}
+
+
 /////////////////////////////////////////////////////////////////////
 // Pretty print a term.
 // 
@@ -1581,26 +2685,77 @@ static int l_yices_pp_term(lua_State *L) {
 // Pretty print the entire model.
 // 
 // @function pp_model
-// @tparam string mdl The model to be printed.
+// @tparam userdata mdl The model to be printed.
 // @tparam number width Number of columns for presenting the model.
 // @tparam number height Number of lines for presenting the model.
 static int l_yices_pp_model(lua_State *L) {
     // get the parameters for the function
-    const char *mdl = lua_tostring(L, 1);
+    model_t *model = l_check_model(L, 1);
     double width = lua_tonumber(L, 2);
     double height = lua_tonumber(L, 3);
     
-    // get the model from the registry
-    model_t *model = l_retrieve_model(L, mdl);
-    
     yices_pp_model(stdout, model, width, height, 0);
     return 0;
 }
 
 
+/////////////////////////////////////////////////////////////////////
+// Gets a string representing a context.
+// 
+// @function l_context_tostring
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+static int l_context_tostring(lua_State *L) {
+    l_context_t *handle = (l_context_t *) luaL_checkudata(L, 1, L_CONTEXT_MT);
+    
+    if(handle->context == NULL || handle->generation != l_generation)
+        lua_pushstring(L, "yices.context (freed)");
+    else
+        lua_pushfstring(L, "yices.context: %p", handle->context);
+    return 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Gets a string representing a configuration.
+// 
+// @function l_config_tostring
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+static int l_config_tostring(lua_State *L) {
+    l_config_t *handle = (l_config_t *) luaL_checkudata(L, 1, L_CONFIG_MT);
+    
+    if(handle->config == NULL || handle->generation != l_generation)
+        lua_pushstring(L, "yices.config (freed)");
+    else
+        lua_pushfstring(L, "yices.config: %p", handle->config);
+    return 1;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Gets a string representing a model.
+// 
+// @function l_model_tostring
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+static int l_model_tostring(lua_State *L) {
+    l_model_t *handle = (l_model_t *) luaL_checkudata(L, 1, L_MODEL_MT);
+    
+    if(handle->model == NULL || handle->generation != l_generation)
+        lua_pushstring(L, "yices.model (freed)");
+    else
+        lua_pushfstring(L, "yices.model: %p", handle->model);
+    return 1;
+}
+
+
 static const struct luaL_Reg l_yices_functions[] = {
         {"init", l_yices_init},
         {"exit", l_yices_exit},
+        {"new_config", l_yices_new_config},
+        {"free_config", l_yices_free_config},
+        {"set_config", l_yices_set_config},
+        {"default_config_for_logic", l_yices_default_config_for_logic},
         {"new_context", l_yices_new_context},
         {"free_context", l_yices_free_context},
         {"mark_backtrack", l_yices_push},
@@ -1611,8 +2766,8 @@ static const struct luaL_Reg l_yices_functions[] = {
         {"function_type", l_yices_function_type},
         {"parse_type", l_yices_parse_type},
         {"new_term", l_yices_new_uninterpreted_term},
-        {"int_term", l_yices_int32},
-        {"real_term", l_yices_parse_float},
+        {"int_term", l_yices_int64},
+        {"real_term", l_yices_real},
         {"neg_term", l_yices_neg},
         {"sum_terms", l_yices_sum},
         {"sub_term", l_yices_sub},
@@ -1635,21 +2790,542 @@ static const struct luaL_Reg l_yices_functions[] = {
         {"ite_term", l_yices_ite},
         {"distinct_terms", l_yices_distinct},
         {"apply_function", l_yices_application},
+        {"compile_term", l_yices_compile_term},
         {"parse_term", l_yices_parse_term},
         {"get_term_by_name", l_yices_get_term_by_name},
+        {"term_to_string", l_yices_term_to_string},
+        {"type_to_string", l_yices_type_to_string},
         {"assert_formula", l_yices_assert_formula},
+        {"assert_formulas", l_yices_assert_formulas},
         {"check_context", l_yices_check_context},
+        {"check_with_assumptions", l_yices_check_with_assumptions},
         {"get_model", l_yices_get_model},
         {"free_model", l_yices_free_model},
         {"get_bool_value", l_yices_get_bool_value},
         {"get_int_value", l_yices_get_int_value},
         {"get_real_value", l_yices_get_real_value},
+        {"get_values", l_yices_get_values},
+        {"sample_polynomials", l_yices_sample_polynomials},
+        {"clock", l_clock},
         {"pp_term", l_yices_pp_term},
         {"pp_model", l_yices_pp_model},
         {NULL, NULL}
 };
 
 
+// methods of a `yices.context`, called as `ctx:method(...)`
+static const struct luaL_Reg l_context_methods[] = {
+        {"free", l_yices_free_context},
+        {"mark_backtrack", l_yices_push},
+        {"backtrack", l_yices_pop},
+        {"assert_formula", l_yices_assert_formula},
+        {"assert_formulas", l_yices_assert_formulas},
+        {"check", l_yices_check_context},
+        {"check_with_assumptions", l_yices_check_with_assumptions},
+        {"get_model", l_yices_get_model},
+        {NULL, NULL}
+};
+
+
+// methods of a `yices.model`, called as `mdl:method(...)`
+static const struct luaL_Reg l_model_methods[] = {
+        {"free", l_yices_free_model},
+        {"get_bool_value", l_yices_get_bool_value},
+        {"get_int_value", l_yices_get_int_value},
+        {"get_real_value", l_yices_get_real_value},
+        {"get_values", l_yices_get_values},
+        {"print", l_yices_pp_model},
+        {NULL, NULL}
+};
+
+
+// methods of a `yices.config`, called as `cfg:method(...)`
+static const struct luaL_Reg l_config_methods[] = {
+        {"free", l_yices_free_config},
+        {"set", l_yices_set_config},
+        {"default_for_logic", l_yices_default_config_for_logic},
+        {NULL, NULL}
+};
+
+
+/////////////////////////////////////////////////////////////////////
+// State of the call tracer. There is a single trace per process.
+// 
+// @field file Trace being written or `NULL` if not tracing.
+// @field next_id Identifier of the next handle seen in the trace.
+static struct {
+    FILE *file;
+    uint32_t next_id;
+} l_trace = {NULL, 0};
+
+
+/////////////////////////////////////////////////////////////////////
+// Registry keys of the module table and of the table mapping
+// handles to their identifiers in the trace (their addresses are
+// the keys).
+static const char l_module_key = 0;
+static const char l_trace_ids_key = 0;
+
+
+/////////////////////////////////////////////////////////////////////
+// Writes raw data in the trace.
+// 
+// @function l_trace_write
+// @local here
+// @tparam void* data Data to be written.
+// @tparam size_t size Size of the data.
+static void l_trace_write(const void *data, size_t size) {
+    fwrite(data, size, 1, l_trace.file);
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Writes a string payload (length and bytes) in the trace.
+// 
+// @function l_trace_string
+// @local here
+// @tparam char* str The string.
+// @tparam size_t len Length of the string.
+static void l_trace_string(const char *str, size_t len) {
+    uint32_t size = len;
+    l_trace_write(&size, sizeof(size));
+    l_trace_write(str, len);
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Writes the identifier of a handle in the trace. Handles get an
+// identifier the first time they are seen.
+// 
+// @function l_trace_handle
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index (absolute) of the userdata.
+static void l_trace_handle(lua_State *L, int idx) {
+    lua_pushlightuserdata(L, (void *) &l_trace_ids_key);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    lua_pushvalue(L, idx);
+    lua_rawget(L, -2);
+    
+    uint32_t id;
+    if(lua_isnumber(L, -1))
+        id = lua_tointeger(L, -1);
+    else {
+        id = l_trace.next_id++;
+        lua_pushvalue(L, idx);
+        lua_pushinteger(L, id);
+        lua_rawset(L, -4);
+    }
+    lua_pop(L, 2);
+    
+    uint8_t tag = L_TRACE_HANDLE;
+    l_trace_write(&tag, 1);
+    l_trace_write(&id, sizeof(id));
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Writes a scalar value (nil, boolean, number or string) in the
+// trace. Other values are written as nil.
+// 
+// @function l_trace_scalar
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the value.
+static void l_trace_scalar(lua_State *L, int idx) {
+    uint8_t tag;
+    
+    switch(lua_type(L, idx)) {
+        case LUA_TBOOLEAN: {
+            uint8_t b = lua_toboolean(L, idx);
+            tag = L_TRACE_BOOL;
+            l_trace_write(&tag, 1);
+            l_trace_write(&b, 1);
+            break;
+        }
+        
+        case LUA_TNUMBER: {
+            double d = lua_tonumber(L, idx);
+            tag = L_TRACE_NUMBER;
+            l_trace_write(&tag, 1);
+            l_trace_write(&d, sizeof(d));
+            break;
+        }
+        
+        case LUA_TSTRING: {
+            size_t len;
+            const char *str = lua_tolstring(L, idx, &len);
+            tag = L_TRACE_STRING;
+            l_trace_write(&tag, 1);
+            l_trace_string(str, len);
+            break;
+        }
+        
+        default:
+            tag = L_TRACE_NIL;
+            l_trace_write(&tag, 1);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Writes an expression of `compile_term` in the trace.
+// 
+// @function l_trace_expression
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index of the expression.
+static void l_trace_expression(lua_State *L, int idx) {
+    uint8_t tag;
+    
+    if(lua_type(L, idx) != LUA_TTABLE) {
+        l_trace_scalar(L, idx);
+        return;
+    }
+    
+    lua_rawgeti(L, idx, 1);
+    int is_node = lua_type(L, -1) == LUA_TSTRING;
+    lua_pop(L, 1);
+    
+    // a term object
+    if(!is_node) {
+        lua_getfield(L, idx, "index");
+        int32_t t = lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        tag = L_TRACE_TERM;
+        l_trace_write(&tag, 1);
+        l_trace_write(&t, sizeof(t));
+        return;
+    }
+    
+    uint32_t size = lua_objlen(L, idx);
+    tag = L_TRACE_EXPRESSION;
+    l_trace_write(&tag, 1);
+    l_trace_write(&size, sizeof(size));
+    uint32_t i;
+    for(i = 1; i <= size; i++) {
+        lua_rawgeti(L, idx, i);
+        if(i == 1) {
+            size_t len;
+            const char *name = lua_tolstring(L, -1, &len);
+            l_trace_string(name, len);
+        }
+        else
+            l_trace_expression(L, lua_gettop(L));
+        lua_pop(L, 1);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Writes a value in the trace. Tables of arguments are written as
+// expressions when they start with a string, as arrays of terms, or
+// as options when they only have named fields.
+// Tables returned by a call only have their length written.
+// 
+// @function l_trace_value
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam int idx Stack index (absolute) of the value.
+// @tparam bool result Whether the value is a result of the call.
+static void l_trace_value(lua_State *L, int idx, bool result) {
+    uint8_t tag;
+    
+    if(lua_type(L, idx) == LUA_TUSERDATA) {
+        l_trace_handle(L, idx);
+        return;
+    }
+    if(lua_type(L, idx) != LUA_TTABLE) {
+        l_trace_scalar(L, idx);
+        return;
+    }
+    
+    uint32_t size = lua_objlen(L, idx);
+    if(result) {
+        tag = L_TRACE_TABLE;
+        l_trace_write(&tag, 1);
+        l_trace_write(&size, sizeof(size));
+        return;
+    }
+    
+    // expressions start with the name of an operator
+    lua_rawgeti(L, idx, 1);
+    int is_expression = lua_type(L, -1) == LUA_TSTRING;
+    lua_pop(L, 1);
+    if(is_expression) {
+        l_trace_expression(L, idx);
+        return;
+    }
+    
+    // count the named fields of the table
+    uint32_t fields = 0;
+    if(size == 0) {
+        lua_pushnil(L);
+        while(lua_next(L, idx) != 0) {
+            if(lua_type(L, -2) == LUA_TSTRING)
+                fields++;
+            lua_pop(L, 1);
+        }
+    }
+    
+    if(fields == 0) {
+        tag = L_TRACE_ARRAY;
+        l_trace_write(&tag, 1);
+        l_trace_write(&size, sizeof(size));
+        uint32_t i;
+        for(i = 1; i <= size; i++) {
+            lua_rawgeti(L, idx, i);
+            int32_t t = lua_tointeger(L, -1);
+            lua_pop(L, 1);
+            l_trace_write(&t, sizeof(t));
+        }
+    }
+    else {
+        tag = L_TRACE_OPTIONS;
+        l_trace_write(&tag, 1);
+        l_trace_write(&fields, sizeof(fields));
+        lua_pushnil(L);
+        while(lua_next(L, idx) != 0) {
+            if(lua_type(L, -2) == LUA_TSTRING) {
+                size_t len;
+                const char *name = lua_tolstring(L, -2, &len);
+                l_trace_string(name, len);
+                l_trace_scalar(L, lua_gettop(L));
+            }
+            lua_pop(L, 1);
+        }
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Calls a function of the binding and writes the call in the trace.
+// The function and its index in the trace header are the upvalues
+// of the closure.
+// 
+// @function l_trace_call
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+static int l_trace_call(lua_State *L) {
+    int n_args = lua_gettop(L);
+    uint16_t op = lua_tointeger(L, lua_upvalueindex(2));
+    
+    // the call may be made after the trace was stopped
+    if(l_trace.file == NULL) {
+        lua_pushvalue(L, lua_upvalueindex(1));
+        lua_insert(L, 1);
+        lua_call(L, n_args, LUA_MULTRET);
+        return lua_gettop(L);
+    }
+    
+    // write the call before running it, since it may change the tables
+    uint8_t count = n_args;
+    l_trace_write(&op, sizeof(op));
+    l_trace_write(&count, 1);
+    int i;
+    for(i = 1; i <= n_args; i++)
+        l_trace_value(L, i, false);
+    
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_insert(L, 1);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int error = lua_pcall(L, n_args, LUA_MULTRET, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t elapsed = (uint64_t) (end.tv_sec - start.tv_sec) * 1000000000ULL + (end.tv_nsec - start.tv_nsec);
+    
+    // write the results
+    int n_results = lua_gettop(L);
+    if(error) {
+        size_t len;
+        const char *msg = lua_tolstring(L, -1, &len);
+        uint8_t tag = L_TRACE_ERROR;
+        count = 1;
+        l_trace_write(&count, 1);
+        l_trace_write(&tag, 1);
+        l_trace_string(msg ? msg : "", msg ? len : 0);
+    }
+    else {
+        count = n_results;
+        l_trace_write(&count, 1);
+        for(i = 1; i <= n_results; i++)
+            l_trace_value(L, i, true);
+    }
+    l_trace_write(&elapsed, sizeof(elapsed));
+    
+    if(error)
+        return lua_error(L);
+    return n_results;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Gets the index of a function of the binding in the trace header.
+// 
+// @function l_trace_op
+// @local here
+// @tparam lua_CFunction func The function.
+// 
+// @treturn int The index or -1 if the function is not exported.
+static int l_trace_op(lua_CFunction func) {
+    int op;
+    for(op = 0; l_yices_functions[op].name != NULL; op++)
+        if(l_yices_functions[op].func == func)
+            return op;
+    return -1;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Replaces the functions of a table by tracing closures, or restores
+// the original functions.
+// 
+// @function l_trace_install
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam luaL_Reg* funcs The functions in the table at the top of the stack.
+// @tparam bool on Whether to install or remove the closures.
+static void l_trace_install(lua_State *L, const luaL_Reg *funcs, bool on) {
+    for(; funcs->name != NULL; funcs++) {
+        lua_pushcfunction(L, funcs->func);
+        if(on) {
+            lua_pushinteger(L, l_trace_op(funcs->func));
+            lua_pushcclosure(L, l_trace_call, 2);
+        }
+        lua_setfield(L, -2, funcs->name);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Installs or removes the tracing closures in the module and in the
+// methods of the classes.
+// 
+// @function l_trace_install_all
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam bool on Whether to install or remove the closures.
+static void l_trace_install_all(lua_State *L, bool on) {
+    lua_pushlightuserdata(L, (void *) &l_module_key);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    l_trace_install(L, l_yices_functions, on);
+    lua_pop(L, 1);
+    
+    const char *classes[] = {L_CONTEXT_MT, L_MODEL_MT, L_CONFIG_MT};
+    const luaL_Reg *methods[] = {l_context_methods, l_model_methods, l_config_methods};
+    int i;
+    for(i = 0; i < 3; i++) {
+        luaL_getmetatable(L, classes[i]);
+        lua_getfield(L, -1, "__index");
+        l_trace_install(L, methods[i], on);
+        lua_pop(L, 2);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Starts recording the calls to the binding in a trace file. Every
+// exported function (and method) is recorded with its arguments,
+// results and wall time. The trace may be replayed without Lua by
+// the `replay` driver.
+// 
+// Tracing may also be started when the module is loaded, by setting
+// the environment variable `YICES_LUA_TRACE` to the trace path.
+// 
+// @function trace_start
+// @tparam string path Path of the trace file.
+// 
+// @raise Error if already tracing or the file can not be created.
+static int l_trace_start(lua_State *L) {
+    const char *path = luaL_checkstring(L, 1);
+    
+    if(l_trace.file != NULL)
+        luaL_error(L, "already tracing");
+    l_trace.file = fopen(path, "wb");
+    if(l_trace.file == NULL)
+        luaL_error(L, "can not create trace %s", path);
+    l_trace.next_id = 0;
+    
+    // write the header
+    uint32_t version = L_TRACE_VERSION;
+    uint16_t n_ops = 0;
+    while(l_yices_functions[n_ops].name != NULL)
+        n_ops++;
+    l_trace_write(L_TRACE_MAGIC, 4);
+    l_trace_write(&version, sizeof(version));
+    l_trace_write(&n_ops, sizeof(n_ops));
+    int op;
+    for(op = 0; op < n_ops; op++) {
+        uint8_t len = strlen(l_yices_functions[op].name);
+        l_trace_write(&len, 1);
+        l_trace_write(l_yices_functions[op].name, len);
+    }
+    
+    // handles are identified in order of first appearance
+    lua_pushlightuserdata(L, (void *) &l_trace_ids_key);
+    lua_newtable(L);
+    lua_newtable(L);
+    lua_pushstring(L, "k");
+    lua_setfield(L, -2, "__mode");
+    lua_setmetatable(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+    
+    l_trace_install_all(L, true);
+    return 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// Stops recording the calls to the binding and closes the trace.
+// 
+// @function trace_stop
+static int l_trace_stop(lua_State *L) {
+    if(l_trace.file == NULL)
+        return 0;
+    
+    l_trace_install_all(L, false);
+    fclose(l_trace.file);
+    l_trace.file = NULL;
+    return 0;
+}
+
+
+// functions controlling the tracer, which are not traced
+static const struct luaL_Reg l_trace_functions[] = {
+        {"trace_start", l_trace_start},
+        {"trace_stop", l_trace_stop},
+        {NULL, NULL}
+};
+
+
+/////////////////////////////////////////////////////////////////////
+// Creates the metatable for a userdata type. The metatable is stored
+// in the registry under `name`.
+// 
+// @function l_new_class
+// @local here
+// @tparam lua_State* L Pointer to lua state.
+// @tparam string name Name of the metatable.
+// @tparam luaL_Reg* methods Methods of the userdata.
+// @tparam lua_CFunction gc Finalizer of the userdata.
+// @tparam lua_CFunction tostring String conversion of the userdata.
+static void l_new_class(lua_State *L, const char *name, const luaL_Reg *methods, lua_CFunction gc, lua_CFunction tostring) {
+    luaL_newmetatable(L, name);
+    
+    lua_newtable(L);
+    luaL_register(L, NULL, methods);
+    lua_setfield(L, -2, "__index");
+    
+    lua_pushcfunction(L, gc);
+    lua_setfield(L, -2, "__gc");
+    
+    lua_pushcfunction(L, tostring);
+    lua_setfield(L, -2, "__tostring");
+    
+    lua_pop(L, 1);
+}
+
+
 /////////////////////////////////////////////////////////////////////
 // Creates module yices for lua with the functions above.
 // 
@@ -1659,8 +3335,25 @@ static const struct luaL_Reg l_yices_functions[] = {
 // 
 // @return Table `yices` representing the module.
 int luaopen_yices(lua_State *L) {
+    // create the classes for contexts, models and configurations
+    l_new_class(L, L_CONTEXT_MT, l_context_methods, l_yices_free_context, l_context_tostring);
+    l_new_class(L, L_MODEL_MT, l_model_methods, l_yices_free_model, l_model_tostring);
+    l_new_class(L, L_CONFIG_MT, l_config_methods, l_yices_free_config, l_config_tostring);
+    
     // create the module
     luaL_register(L, "solver", l_yices_functions);
+    luaL_register(L, NULL, l_trace_functions);
+    lua_pushlightuserdata(L, (void *) &l_module_key);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+    
+    // record the calls if requested by the environment
+    const char *trace = getenv("YICES_LUA_TRACE");
+    if(trace != NULL && l_trace.file == NULL) {
+        lua_pushcfunction(L, l_trace_start);
+        lua_pushstring(L, trace);
+        lua_call(L, 1, 0);
+    }
     
     return 1;
 }
\ No newline at end of file
@@ -0,0 +1,1068 @@
+---------------------------------------------------------------------
+-- LuaJIT FFI binding to Yices.
+-- Declares the Yices C API and exports the same functions as the
+-- `yices` C module, so `lib.smt` may use either one. Terms and types
+-- are plain numbers, contexts, models and configurations are cdata
+-- handles with the same methods as the userdata of the C module.
+--
+-- Under LuaJIT the calls are compiled with the code building the
+-- constraints, without the conversions of the Lua C API.
+--
+-- Time limits of the checks (option `timeout_ms`) are kept by the
+-- watchdogs of the C module, so they require it to be found in
+-- `package.cpath` and linked to the same Yices library. Calls are
+-- not recorded by `trace_start`.
+--
+-- @module lib.yices_ffi
+-- @usage
+--    local solver = require('lib.yices_ffi')
+-- @author Joel dos Santos <joel@dossantos.cc>
+
+local ffi = require('ffi')
+
+ffi.cdef[[
+typedef int32_t term_t;
+typedef int32_t type_t;
+typedef struct context_s context_t;
+typedef struct model_s model_t;
+typedef struct ctx_config_s ctx_config_t;
+typedef struct param_s param_t;
+typedef struct FILE FILE;
+
+typedef struct error_report_s {
+    int32_t code;
+    uint32_t line;
+    uint32_t column;
+    term_t term1;
+    type_t type1;
+    term_t term2;
+    type_t type2;
+    int64_t badval;
+} error_report_t;
+
+void yices_init(void);
+void yices_exit(void);
+error_report_t *yices_error_report(void);
+void yices_clear_error(void);
+
+ctx_config_t *yices_new_config(void);
+void yices_free_config(ctx_config_t *config);
+int32_t yices_set_config(ctx_config_t *config, const char *name, const char *value);
+int32_t yices_default_config_for_logic(ctx_config_t *config, const char *logic);
+context_t *yices_new_context(const ctx_config_t *config);
+void yices_free_context(context_t *ctx);
+int32_t yices_push(context_t *ctx);
+int32_t yices_pop(context_t *ctx);
+param_t *yices_new_param_record(void);
+int32_t yices_set_param(param_t *p, const char *name, const char *value);
+void yices_free_param_record(param_t *param);
+
+type_t yices_int_type(void);
+type_t yices_real_type(void);
+type_t yices_bool_type(void);
+type_t yices_function_type(uint32_t n, const type_t dom[], type_t range);
+type_t yices_parse_type(const char *s);
+
+term_t yices_new_uninterpreted_term(type_t tau);
+int32_t yices_set_term_name(term_t t, const char *name);
+term_t yices_get_term_by_name(const char *name);
+char *yices_term_to_string(term_t t, uint32_t width, uint32_t height, uint32_t offset);
+char *yices_type_to_string(type_t tau, uint32_t width, uint32_t height, uint32_t offset);
+void yices_free_string(char *s);
+term_t yices_int64(int64_t val);
+term_t yices_rational64(int64_t num, uint64_t den);
+term_t yices_parse_float(const char *s);
+term_t yices_parse_term(const char *s);
+term_t yices_neg(term_t t1);
+term_t yices_sum(uint32_t n, const term_t t[]);
+term_t yices_sub(term_t t1, term_t t2);
+term_t yices_mul(term_t t1, term_t t2);
+term_t yices_division(term_t t1, term_t t2);
+term_t yices_power(term_t t1, uint32_t d);
+term_t yices_arith_eq_atom(term_t t1, term_t t2);
+term_t yices_arith_neq_atom(term_t t1, term_t t2);
+term_t yices_arith_geq_atom(term_t t1, term_t t2);
+term_t yices_arith_leq_atom(term_t t1, term_t t2);
+term_t yices_arith_gt_atom(term_t t1, term_t t2);
+term_t yices_arith_lt_atom(term_t t1, term_t t2);
+term_t yices_true(void);
+term_t yices_false(void);
+term_t yices_not(term_t arg);
+term_t yices_and(uint32_t n, term_t arg[]);
+term_t yices_or(uint32_t n, term_t arg[]);
+term_t yices_iff(term_t t1, term_t t2);
+term_t yices_implies(term_t t1, term_t t2);
+term_t yices_ite(term_t cond, term_t then_term, term_t else_term);
+term_t yices_distinct(uint32_t n, term_t arg[]);
+term_t yices_application(term_t fun, uint32_t n, const term_t arg[]);
+
+int32_t yices_assert_formula(context_t *ctx, term_t t);
+int32_t yices_assert_formulas(context_t *ctx, uint32_t n, const term_t t[]);
+int32_t yices_check_context(context_t *ctx, const param_t *params);
+int32_t yices_check_context_with_assumptions(context_t *ctx, const param_t *params, uint32_t n, const term_t t[]);
+model_t *yices_get_model(context_t *ctx, int32_t keep_subst);
+void yices_free_model(model_t *mdl);
+int32_t yices_get_bool_value(model_t *mdl, term_t t, int32_t *val);
+int32_t yices_get_int32_value(model_t *mdl, term_t t, int32_t *val);
+int32_t yices_get_double_value(model_t *mdl, term_t t, double *val);
+int32_t yices_pp_term(FILE *f, term_t t, uint32_t width, uint32_t height, uint32_t offset);
+void yices_pp_model(FILE *f, model_t *mdl, uint32_t width, uint32_t height, uint32_t offset);
+
+int snprintf(char *s, size_t n, const char *format, ...);
+int fflush(FILE *f);
+extern FILE *stdout;
+
+typedef struct yices_lua_context_s {
+    context_t *context;
+    uint32_t generation;
+    bool assuming;
+    void *watchdog;
+} yices_lua_context_t;
+
+typedef struct yices_lua_model_s {
+    model_t *model;
+    uint32_t generation;
+} yices_lua_model_t;
+
+typedef struct yices_lua_config_s {
+    ctx_config_t *config;
+    uint32_t generation;
+} yices_lua_config_t;
+]]
+
+
+-- Load the library from the system or from the directories used by
+-- the C module
+local C
+for _, name in ipairs{'yices', './lib/libyices.so', './libyices.so.2.3'} do
+    local ok, lib = pcall(ffi.load, name)
+    if ok then
+        C = lib
+        break
+    end
+end
+assert(C, 'Could not load the Yices library.')
+
+-- Whether Yices checks a context under assumptions (since 2.6)
+local NATIVE_ASSUMPTIONS = pcall(function ()
+    return C.yices_check_context_with_assumptions
+end)
+
+-- Monotonic clock of `yices.clock` and watchdogs of the bounded
+-- checks. The FFI can not run a thread stopping the search, so the
+-- watchdogs are the ones of the `yices` C module, exported for this
+-- binding (`nil` if the module is not found).
+ffi.cdef[[
+typedef struct yices_lua_timespec_s {
+    long sec;
+    long nsec;
+} yices_lua_timespec_t;
+int clock_gettime(int clockid, yices_lua_timespec_t *tp);
+
+void *yices_lua_watchdog_new(context_t *context);
+void yices_lua_watchdog_arm(void *watchdog, double timeout);
+void yices_lua_watchdog_free(void *watchdog);
+]]
+
+local CLOCK_MONOTONIC = 1
+local WATCHDOG
+local module = package.searchpath and package.searchpath('yices', package.cpath)
+if module then
+    local ok, lib = pcall(ffi.load, module)
+    if ok and pcall(function () return lib.yices_lua_watchdog_new end) then
+        WATCHDOG = lib
+    end
+end
+
+-- Results of a check
+local STATUS_SAT = 3
+local STATUS_UNSAT = 4
+local STATUS_INTERRUPTED = 5
+local STATUS_ERROR = 6
+
+-- Messages of the error codes, as given by the C module
+local ERRORS = {
+    [1] = 'Invalid type argument',
+    [2] = 'Invalid term argument',
+    [7] = 'The input float does not have the right format',
+    [13] = 'Attempt to create a type or term of arity larger accepted',
+    [17] = 'Zero divider in a rational constant',
+    [18] = 'Bad integer argument: the function expects a positive argument',
+    [19] = 'Bad integer argument: the function expects a non-negative argument',
+    [21] = 'Bad term argument: a term of function type is expected',
+    [24] = 'Bad term argument: an arithmetic term (of type Int or Real) is expected',
+    [27] = 'Wrong number of arguments in a function application or function update',
+    [28] = 'Type error in various term constructor',
+    [29] = 'Error in functions that require terms of compatible types',
+    [33] = 'Invalid term: an arithmetic constant is expected',
+    [101] = 'Syntax error',
+    [102] = 'A name is not defined in the symbol table for types',
+    [103] = 'A name is not defined in the symbol table for terms',
+    [104] = 'Attempt to redefine an existing type name',
+    [105] = 'Attempt to redefine an existing term name',
+    [108] = 'Integer constant can’t be converted to a signed 32bit integer',
+    [109] = 'Rational constant provided when an integer is expected',
+    [110] = 'Invalid argument: a rational constant is expected',
+    [112] = 'Error in a definition or declaration: a type is expected',
+    [113] = 'Attempt to divide by a non-constant arithmetic term',
+    [117] = 'Error in an arithmetic operation: an argument is not an arithmetic term',
+    [400] = 'Invalid operation on a context: the context is in a state that does not allow the operation to be performed',
+    [401] = 'Invalid operation on a context: the context is not configured to support this operation',
+    [600] = 'The model does not assign a value to the specified term',
+    [9000] = 'Error when attempting to write to a stream',
+    [9999] = 'Catch-all code for any other error'
+}
+
+local NULL_TERM = -1
+local floor, abs = math.floor, math.abs
+local context_ct = ffi.typeof('yices_lua_context_t')
+local model_ct = ffi.typeof('yices_lua_model_t')
+local config_ct = ffi.typeof('yices_lua_config_t')
+local int_box = ffi.new('int32_t[1]')
+local double_box = ffi.new('double[1]')
+local number_buf = ffi.new('char[1200]')
+
+
+--- Module table
+local yices = {}
+
+-- Current Yices initialization. Global cleanup deletes all contexts
+-- and models, so handles created before it must not free them again.
+local generation = 0
+
+
+---------------------------------------------------------------------
+-- Throws the error reported by Yices, with the message of the C
+-- module.
+--
+-- @raise Error with the reported message.
+local function throw_error()
+    local report = C.yices_error_report()
+    if report.code == 0 then
+        return
+    end
+
+    local msg = {ERRORS[report.code] or 'Error'}
+    if report.line ~= 0 and report.column ~= 0 then
+        msg[#msg + 1] = ' (line ' .. report.line .. ', column ' .. report.column .. ')'
+    end
+    if report.term1 ~= 0 and report.type1 ~= 0 then
+        msg[#msg + 1] = ' [term ' .. report.type1 .. '] ' .. report.term1 .. ' '
+    end
+    if report.term2 ~= 0 and report.type2 ~= 0 then
+        msg[#msg + 1] = ' [term ' .. report.type2 .. '] ' .. report.term2 .. ' '
+    end
+    if report.badval ~= 0 then
+        msg[#msg + 1] = ' [bad value ' .. tonumber(report.badval) .. ']'
+    end
+
+    C.yices_clear_error()
+    error(table.concat(msg), 0)
+end
+
+
+-- Returns a term, throwing the error of Yices if it is not valid.
+local function check_term(term)
+    if term == NULL_TERM then
+        throw_error()
+    end
+    return term
+end
+
+
+---------------------------------------------------------------------
+-- Scratch buffer used for passing arrays of terms and types to
+-- Yices. It only grows, so after a few calls no allocation is needed.
+local scratch = ffi.new('int32_t[?]', 64)
+local scratch_size = 64
+
+
+-- Makes room for `size` elements in the scratch buffer, keeping its
+-- contents.
+local function scratch_grow(size)
+    if size <= scratch_size then
+        return
+    end
+
+    local new_size = scratch_size
+    while new_size < size do
+        new_size = new_size * 2
+    end
+    local data = ffi.new('int32_t[?]', new_size)
+    ffi.copy(data, scratch, scratch_size * 4)
+    scratch, scratch_size = data, new_size
+end
+
+
+-- Copies the array part of a table into the scratch buffer. The
+-- buffer is only valid until the next call.
+local function check_array(t, name)
+    if type(t) ~= 'table' then
+        error('bad argument to \'' .. name .. '\' (table expected, got ' .. type(t) .. ')', 3)
+    end
+
+    local n = #t
+    scratch_grow(n)
+    for i = 1, n do
+        scratch[i - 1] = t[i]
+    end
+    return scratch, n
+end
+
+
+---------------------------------------------------------------------
+-- Gets the object of a handle, checking it was not freed.
+local function check_handle(h, ct, field, what, name)
+    if not ffi.istype(ct, h) then
+        error('bad argument #1 to \'' .. name .. '\' (yices.' .. what .. ' expected)', 3)
+    end
+    if h[field] == nil or h.generation ~= generation then
+        error('bad argument #1 to \'' .. name .. '\' (' .. what .. ' was already freed)', 3)
+    end
+    return h[field]
+end
+
+
+-- Gets the context of a handle, dropping the assumptions of its last
+-- check. Must be used by the functions changing or checking the
+-- context.
+local function check_idle_context(h, name)
+    local context = check_handle(h, context_ct, 'context', 'context', name)
+
+    if h.assuming then
+        h.assuming = false
+        if C.yices_pop(context) ~= 0 then
+            throw_error()
+        end
+    end
+    return context
+end
+
+
+---------------------------------------------------------------------
+-- Global initialization.
+function yices.init()
+    C.yices_init()
+    generation = generation + 1
+    throw_error()
+end
+
+
+---------------------------------------------------------------------
+-- Global cleanup.
+function yices.exit()
+    C.yices_exit()
+    generation = generation + 1
+end
+
+
+---------------------------------------------------------------------
+-- Creates a new context configuration, deleted when the handle is
+-- collected if it was not freed before.
+function yices.new_config()
+    local config = C.yices_new_config()
+    if config == nil then
+        throw_error()
+    end
+    return config_ct(config, generation)
+end
+
+
+-- Deletes a context configuration.
+function yices.free_config(cfg)
+    if not ffi.istype(config_ct, cfg) then
+        error('bad argument #1 to \'free_config\' (yices.config expected)', 2)
+    end
+    if cfg.config ~= nil and cfg.generation == generation then
+        C.yices_free_config(cfg.config)
+    end
+    cfg.config = nil
+end
+
+
+-- Sets a parameter of a context configuration.
+function yices.set_config(cfg, name, value)
+    local config = check_handle(cfg, config_ct, 'config', 'configuration', 'set_config')
+    if C.yices_set_config(config, tostring(name), tostring(value)) < 0 then
+        throw_error()
+    end
+end
+
+
+-- Prepares a context configuration for the given logic.
+function yices.default_config_for_logic(cfg, logic)
+    local config = check_handle(cfg, config_ct, 'config', 'configuration', 'default_config_for_logic')
+    if C.yices_default_config_for_logic(config, tostring(logic)) < 0 then
+        throw_error()
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Creates a new context, deleted when the handle is collected if it
+-- was not freed before.
+function yices.new_context(cfg)
+    local config = nil
+    if cfg ~= nil then
+        config = check_handle(cfg, config_ct, 'config', 'configuration', 'new_context')
+    end
+
+    local context = C.yices_new_context(config)
+    if context == nil then
+        throw_error()
+    end
+    return context_ct(context, generation, false, nil)
+end
+
+
+-- Deletes a context. Freeing a context twice has no effect.
+function yices.free_context(ctx)
+    if not ffi.istype(context_ct, ctx) then
+        error('bad argument #1 to \'free_context\' (yices.context expected)', 2)
+    end
+    -- the watchdog is stopped before its context is deleted
+    if ctx.watchdog ~= nil then
+        WATCHDOG.yices_lua_watchdog_free(ctx.watchdog)
+    end
+    ctx.watchdog = nil
+    if ctx.context ~= nil and ctx.generation == generation then
+        C.yices_free_context(ctx.context)
+    end
+    ctx.context = nil
+end
+
+
+-- Marks a backtracking point.
+function yices.mark_backtrack(ctx)
+    if C.yices_push(check_idle_context(ctx, 'mark_backtrack')) ~= 0 then
+        throw_error()
+    end
+end
+
+
+-- Backtraks to a previous backtracking point.
+function yices.backtrack(ctx)
+    if C.yices_pop(check_idle_context(ctx, 'backtrack')) ~= 0 then
+        throw_error()
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Types.
+
+function yices.int_type()
+    return check_term(C.yices_int_type())
+end
+
+function yices.real_type()
+    return check_term(C.yices_real_type())
+end
+
+function yices.bool_type()
+    return check_term(C.yices_bool_type())
+end
+
+function yices.function_type(dom, range)
+    local t, n = check_array(dom, 'function_type')
+    return check_term(C.yices_function_type(n, t, range))
+end
+
+function yices.parse_type(s)
+    return check_term(C.yices_parse_type(s))
+end
+
+
+---------------------------------------------------------------------
+-- Constants.
+
+function yices.new_term(type, name)
+    local term = check_term(C.yices_new_uninterpreted_term(type))
+    if name ~= nil then
+        C.yices_set_term_name(term, tostring(name))
+    end
+    return term
+end
+
+
+function yices.int_term(val)
+    if type(val) ~= 'number' or val ~= floor(val) or abs(val) >= 9.2e18 then
+        error('bad argument #1 to \'int_term\' (integer expected)', 2)
+    end
+    return check_term(C.yices_int64(val))
+end
+
+
+-- Converts a double to the rational constant with exactly the same
+-- value, as lib/rational.h does for the C module.
+local function double_term(val)
+    if val == floor(val) then
+        if abs(val) < 9.2e18 then
+            return C.yices_int64(val)
+        end
+        C.snprintf(number_buf, 1200, '%.0f', val)
+        return C.yices_parse_float(number_buf)
+    end
+
+    -- val = num / 2^k, with num holding the 53 bits of the mantissa
+    local m, exp = math.frexp(val)
+    local num, k = m * 2^53, 53 - exp
+    while num % 2 == 0 do
+        num, k = num / 2, k - 1
+    end
+
+    if k < 64 then
+        return C.yices_rational64(num, ffi.cast('uint64_t', 2^k))
+    end
+
+    -- k fractional digits represent num / 2^k exactly
+    C.snprintf(number_buf, 1200, '%.*f', ffi.cast('int', k), val)
+    return C.yices_parse_float(number_buf)
+end
+
+
+function yices.real_term(val)
+    if type(val) == 'number' then
+        if val ~= val or val == math.huge or val == -math.huge then
+            error('bad argument #1 to \'real_term\' (finite number expected)', 2)
+        end
+        return check_term(double_term(val))
+    end
+    return check_term(C.yices_parse_float(tostring(val)))
+end
+
+
+---------------------------------------------------------------------
+-- Arithmetic terms.
+
+function yices.neg_term(t)
+    return check_term(C.yices_neg(t))
+end
+
+function yices.sum_terms(t)
+    local a, n = check_array(t, 'sum_terms')
+    return check_term(C.yices_sum(n, a))
+end
+
+function yices.sub_term(t1, t2)
+    return check_term(C.yices_sub(t1, t2))
+end
+
+function yices.mul_term(t1, t2)
+    return check_term(C.yices_mul(t1, t2))
+end
+
+function yices.div_term(t1, t2)
+    return check_term(C.yices_division(t1, t2))
+end
+
+function yices.pow_term(t1, d)
+    return check_term(C.yices_power(t1, d))
+end
+
+function yices.eq_term(t1, t2)
+    return check_term(C.yices_arith_eq_atom(t1, t2))
+end
+
+function yices.ne_term(t1, t2)
+    return check_term(C.yices_arith_neq_atom(t1, t2))
+end
+
+function yices.ge_term(t1, t2)
+    return check_term(C.yices_arith_geq_atom(t1, t2))
+end
+
+function yices.le_term(t1, t2)
+    return check_term(C.yices_arith_leq_atom(t1, t2))
+end
+
+function yices.gt_term(t1, t2)
+    return check_term(C.yices_arith_gt_atom(t1, t2))
+end
+
+function yices.lt_term(t1, t2)
+    return check_term(C.yices_arith_lt_atom(t1, t2))
+end
+
+
+---------------------------------------------------------------------
+-- Boolean and general terms.
+
+function yices.const_true()
+    return check_term(C.yices_true())
+end
+
+function yices.const_false()
+    return check_term(C.yices_false())
+end
+
+function yices.not_term(t)
+    return check_term(C.yices_not(t))
+end
+
+function yices.and_terms(t)
+    local a, n = check_array(t, 'and_terms')
+    return check_term(C.yices_and(n, a))
+end
+
+function yices.or_terms(t)
+    local a, n = check_array(t, 'or_terms')
+    return check_term(C.yices_or(n, a))
+end
+
+function yices.iff_term(t1, t2)
+    return check_term(C.yices_iff(t1, t2))
+end
+
+function yices.imp_term(t1, t2)
+    return check_term(C.yices_implies(t1, t2))
+end
+
+function yices.ite_term(c, t1, t2)
+    return check_term(C.yices_ite(c, t1, t2))
+end
+
+function yices.distinct_terms(t)
+    local a, n = check_array(t, 'distinct_terms')
+    return check_term(C.yices_distinct(n, a))
+end
+
+function yices.apply_function(fun, t)
+    local a, n = check_array(t, 'apply_function')
+    return check_term(C.yices_application(fun, n, a))
+end
+
+
+---------------------------------------------------------------------
+-- Builders of the operators of `compile_term`, as in lib/operator.h.
+-- Each one takes the number of operands and a pointer to them.
+local OPERATORS = {
+    ['and'] = {-1, function (n, t) return C.yices_and(n, t) end},
+    ['or'] = {-1, function (n, t) return C.yices_or(n, t) end},
+    ['not'] = {1, function (n, t) return C.yices_not(t[0]) end},
+    ['iff'] = {2, function (n, t) return C.yices_iff(t[0], t[1]) end},
+    ['imp'] = {2, function (n, t) return C.yices_implies(t[0], t[1]) end},
+    ['ite'] = {3, function (n, t) return C.yices_ite(t[0], t[1], t[2]) end},
+    ['eq'] = {2, function (n, t) return C.yices_arith_eq_atom(t[0], t[1]) end},
+    ['ne'] = {2, function (n, t) return C.yices_arith_neq_atom(t[0], t[1]) end},
+    ['ge'] = {2, function (n, t) return C.yices_arith_geq_atom(t[0], t[1]) end},
+    ['le'] = {2, function (n, t) return C.yices_arith_leq_atom(t[0], t[1]) end},
+    ['gt'] = {2, function (n, t) return C.yices_arith_gt_atom(t[0], t[1]) end},
+    ['lt'] = {2, function (n, t) return C.yices_arith_lt_atom(t[0], t[1]) end},
+    ['sum'] = {-1, function (n, t) return C.yices_sum(n, t) end},
+    ['sub'] = {2, function (n, t) return C.yices_sub(t[0], t[1]) end},
+    ['mul'] = {2, function (n, t) return C.yices_mul(t[0], t[1]) end},
+    ['div'] = {2, function (n, t) return C.yices_division(t[0], t[1]) end},
+    ['neg'] = {1, function (n, t) return C.yices_neg(t[0]) end},
+    ['distinct'] = {-1, function (n, t) return C.yices_distinct(n, t) end},
+    ['apply'] = {-1, function (n, t) return C.yices_application(t[0], n - 1, t + 1) end}
+}
+
+
+-- Builds the term of an expression bottom-up. The terms of the
+-- operands of a node are kept in the scratch buffer, from position
+-- `base`, so nested nodes use the buffer as a stack.
+local function compile(exp, base)
+    local kind = type(exp)
+
+    if kind == 'number' then
+        if exp ~= exp or exp == math.huge or exp == -math.huge then
+            error('invalid constant in expression', 0)
+        end
+        return check_term(double_term(exp))
+    elseif kind == 'boolean' then
+        return exp and C.yices_true() or C.yices_false()
+    elseif kind ~= 'table' then
+        error('invalid operand in expression', 0)
+    end
+
+    -- an existing term
+    local name = exp[1]
+    if type(name) ~= 'string' then
+        if type(exp.index) ~= 'number' then
+            error('invalid operand in expression', 0)
+        end
+        return exp.index
+    end
+
+    local op = OPERATORS[name]
+    local n = #exp - 1
+    if not op then
+        error('unknown operator \'' .. name .. '\' in expression', 0)
+    end
+    if n == 0 or (op[1] >= 0 and n ~= op[1]) then
+        error('wrong number of operands for \'' .. name .. '\'', 0)
+    end
+
+    -- build the operands
+    scratch_grow(base + n)
+    for i = 1, n do
+        local t = compile(exp[i + 1], base + n)
+        scratch[base + i - 1] = t
+    end
+
+    return check_term(op[2](n, scratch + base))
+end
+
+
+-- Builds the term of a whole expression (see `compile_term` in the
+-- C module).
+function yices.compile_term(exp)
+    if type(exp) ~= 'table' then
+        error('bad argument #1 to \'compile_term\' (table expected, got ' .. type(exp) .. ')', 2)
+    end
+    return compile(exp, 0)
+end
+
+
+function yices.parse_term(expr)
+    return check_term(C.yices_parse_term(expr))
+end
+
+
+function yices.get_term_by_name(name)
+    local term = C.yices_get_term_by_name(name)
+    if term ~= NULL_TERM then
+        return term
+    end
+    return nil
+end
+
+
+-- Converts a term to an expression in the Yices language.
+function yices.term_to_string(term)
+    local str = C.yices_term_to_string(term, 0xffffffff, 0xffffffff, 0)
+    if str == nil then
+        throw_error()
+    end
+    local exp = ffi.string(str)
+    C.yices_free_string(str)
+    return exp
+end
+
+
+-- Converts a type to an expression in the Yices language.
+function yices.type_to_string(type)
+    local str = C.yices_type_to_string(type, 0xffffffff, 0xffffffff, 0)
+    if str == nil then
+        throw_error()
+    end
+    local exp = ffi.string(str)
+    C.yices_free_string(str)
+    return exp
+end
+
+
+---------------------------------------------------------------------
+-- Assertions and checks.
+
+function yices.assert_formula(ctx, t)
+    if C.yices_assert_formula(check_idle_context(ctx, 'assert_formula'), t) ~= 0 then
+        throw_error()
+    end
+end
+
+
+function yices.assert_formulas(ctx, t)
+    local context = check_idle_context(ctx, 'assert_formulas')
+    local a, n = check_array(t, 'assert_formulas')
+    if C.yices_assert_formulas(context, n, a) ~= 0 then
+        throw_error()
+    end
+end
+
+
+-- Creates the parameter record of the search options of a check.
+-- Returns `nil` if there is no search parameter, and the time limit
+-- in milliseconds if there is one.
+local function check_params(options, name)
+    if options == nil then
+        return nil
+    end
+    if type(options) ~= 'table' then
+        error('bad argument to \'' .. name .. '\' (table expected, got ' .. type(options) .. ')', 3)
+    end
+
+    local params, timeout
+    for k, v in pairs(options) do
+        if type(k) ~= 'string' then
+            error('bad argument to \'' .. name .. '\' (option names must be strings)', 3)
+        end
+        if k == 'timeout_ms' then
+            if v and v > 0 then
+                if not WATCHDOG then
+                    error('bad argument to \'' .. name .. '\' (timeouts require the yices C module)', 3)
+                end
+                timeout = v
+            end
+        else
+            if type(v) == 'boolean' then
+                v = v and 'true' or 'false'
+            end
+            params = params or ffi.gc(C.yices_new_param_record(), C.yices_free_param_record)
+            if C.yices_set_param(params, k, tostring(v)) < 0 then
+                throw_error()
+            end
+        end
+    end
+
+    return params, timeout
+end
+
+
+-- Runs the search of a check, under the watchdog of the context if
+-- there is a time limit, as in the C module. The watchdog stops the
+-- search only while it is armed, so a check that returned can not
+-- be reached by a late stop.
+local function run_check(ctx, timeout, check, ...)
+    if not timeout then
+        return check(...)
+    end
+
+    if ctx.watchdog == nil then
+        ctx.watchdog = WATCHDOG.yices_lua_watchdog_new(ctx.context)
+        if ctx.watchdog == nil then
+            error('could not start the watchdog for the check', 3)
+        end
+    end
+    WATCHDOG.yices_lua_watchdog_arm(ctx.watchdog, timeout)
+    local status = check(...)
+    WATCHDOG.yices_lua_watchdog_arm(ctx.watchdog, 0)
+    return status
+end
+
+
+-- Returns the result of a check.
+local function push_status(status)
+    if status == STATUS_SAT then
+        return true
+    elseif status == STATUS_UNSAT then
+        return false
+    elseif status == STATUS_ERROR then
+        throw_error()
+    elseif status == STATUS_INTERRUPTED then
+        return nil, 'interrupted'
+    end
+    return nil, 'unknown'
+end
+
+
+-- Checks whether a context is satisfiable.
+function yices.check_context(ctx, options)
+    local context = check_idle_context(ctx, 'check_context')
+    local params, timeout = check_params(options, 'check_context')
+    return push_status(run_check(ctx, timeout, C.yices_check_context, context, params))
+end
+
+
+-- Checks whether a context is satisfiable under assumptions. As in
+-- the C module, older Yices versions assert the literals in a
+-- backtracking point that is dropped by the next operation.
+function yices.check_with_assumptions(ctx, t, options)
+    local context = check_idle_context(ctx, 'check_with_assumptions')
+    local a, n = check_array(t, 'check_with_assumptions')
+    local params, timeout = check_params(options, 'check_with_assumptions')
+
+    if NATIVE_ASSUMPTIONS then
+        return push_status(run_check(ctx, timeout, C.yices_check_context_with_assumptions,
+                                     context, params, n, a))
+    end
+
+    if C.yices_push(context) ~= 0 then
+        throw_error()
+    end
+    ctx.assuming = true
+    if C.yices_assert_formulas(context, n, a) ~= 0 then
+        throw_error()
+    end
+    return push_status(run_check(ctx, timeout, C.yices_check_context, context, params))
+end
+
+
+---------------------------------------------------------------------
+-- Models.
+
+-- Builds a model from a satisfiable context, deleted when the handle
+-- is collected if it was not freed before.
+function yices.get_model(ctx)
+    local model = C.yices_get_model(check_handle(ctx, context_ct, 'context', 'context', 'get_model'), 1)
+    if model == nil then
+        throw_error()
+    end
+    return model_ct(model, generation)
+end
+
+
+-- Deletes a model. Freeing a model twice has no effect.
+function yices.free_model(mdl)
+    if not ffi.istype(model_ct, mdl) then
+        error('bad argument #1 to \'free_model\' (yices.model expected)', 2)
+    end
+    if mdl.model ~= nil and mdl.generation == generation then
+        C.yices_free_model(mdl.model)
+    end
+    mdl.model = nil
+end
+
+
+function yices.get_bool_value(mdl, term)
+    local model = check_handle(mdl, model_ct, 'model', 'model', 'get_bool_value')
+    if C.yices_get_bool_value(model, term, int_box) ~= 0 then
+        throw_error()
+    end
+    return int_box[0] ~= 0
+end
+
+
+function yices.get_int_value(mdl, term)
+    local model = check_handle(mdl, model_ct, 'model', 'model', 'get_int_value')
+    if C.yices_get_int32_value(model, term, int_box) ~= 0 then
+        throw_error()
+    end
+    return int_box[0]
+end
+
+
+function yices.get_real_value(mdl, term)
+    local model = check_handle(mdl, model_ct, 'model', 'model', 'get_real_value')
+    if C.yices_get_double_value(model, term, double_box) ~= 0 then
+        throw_error()
+    end
+    return double_box[0]
+end
+
+
+-- Gets the values of a list of terms, given the type of each one.
+function yices.get_values(mdl, t, k, v)
+    local model = check_handle(mdl, model_ct, 'model', 'model', 'get_values')
+    local bool_type = C.yices_bool_type()
+    local int_type = C.yices_int_type()
+    v = type(v) == 'table' and v or {}
+
+    for i = 1, #t do
+        local kind = k[i]
+        if kind == bool_type then
+            if C.yices_get_bool_value(model, t[i], int_box) ~= 0 then
+                throw_error()
+            end
+            v[i] = int_box[0] ~= 0
+        elseif kind == int_type then
+            if C.yices_get_int32_value(model, t[i], int_box) ~= 0 then
+                throw_error()
+            end
+            v[i] = int_box[0]
+        else
+            if C.yices_get_double_value(model, t[i], double_box) ~= 0 then
+                throw_error()
+            end
+            v[i] = double_box[0]
+        end
+    end
+
+    return v
+end
+
+
+-- Samples piecewise polynomials at a list of times (see the C module).
+function yices.sample_polynomials(pieces, times)
+    local result = {}
+    for i, piece in ipairs(pieces) do
+        local c, ti, te = piece.coef, piece.ti or 0, piece.te or 0
+        local before = piece.before or piece.value or 0
+        local after = piece.after or piece.value or 0
+        local v = {}
+        for j, t in ipairs(times) do
+            if t < ti then
+                v[j] = before
+            elseif t > te then
+                v[j] = after
+            else
+                local x, y = t - ti, c[#c] or 0
+                for k = #c - 1, 1, -1 do
+                    y = y * x + c[k]
+                end
+                v[j] = y
+            end
+        end
+        result[i] = v
+    end
+    return result
+end
+
+
+-- Gets the time of a monotonic clock in seconds (see the C module).
+local now = ffi.new('yices_lua_timespec_t')
+function yices.clock()
+    ffi.C.clock_gettime(CLOCK_MONOTONIC, now)
+    return tonumber(now.sec) + tonumber(now.nsec) / 1e9
+end
+
+
+---------------------------------------------------------------------
+-- Printing.
+
+function yices.pp_term(term, width, height)
+    io.stdout:flush()
+    C.yices_pp_term(C.stdout, term, width, height, 0)
+    C.fflush(C.stdout)
+end
+
+
+function yices.pp_model(mdl, width, height)
+    local model = check_handle(mdl, model_ct, 'model', 'model', 'pp_model')
+    io.stdout:flush()
+    C.yices_pp_model(C.stdout, model, width, height, 0)
+    C.fflush(C.stdout)
+end
+
+
+---------------------------------------------------------------------
+-- Classes of the handles, with the methods of the C module.
+
+local function tostring_handle(what, ptr, gen)
+    if ptr == nil or gen ~= generation then
+        return 'yices.' .. what .. ' (freed)'
+    end
+    return 'yices.' .. what .. ': ' .. tostring(ffi.cast('void *', ptr)):match('0x%x+')
+end
+
+ffi.metatype(context_ct, {
+    __index = {
+        free = yices.free_context,
+        mark_backtrack = yices.mark_backtrack,
+        backtrack = yices.backtrack,
+        assert_formula = yices.assert_formula,
+        assert_formulas = yices.assert_formulas,
+        check = yices.check_context,
+        check_with_assumptions = yices.check_with_assumptions,
+        get_model = yices.get_model
+    },
+    __gc = yices.free_context,
+    __tostring = function (h) return tostring_handle('context', h.context, h.generation) end
+})
+
+ffi.metatype(model_ct, {
+    __index = {
+        free = yices.free_model,
+        get_bool_value = yices.get_bool_value,
+        get_int_value = yices.get_int_value,
+        get_real_value = yices.get_real_value,
+        get_values = yices.get_values,
+        print = yices.pp_model
+    },
+    __gc = yices.free_model,
+    __tostring = function (h) return tostring_handle('model', h.model, h.generation) end
+})
+
+ffi.metatype(config_ct, {
+    __index = {
+        free = yices.free_config,
+        set = yices.set_config,
+        default_for_logic = yices.default_config_for_logic
+    },
+    __gc = yices.free_config,
+    __tostring = function (h) return tostring_handle('config', h.config, h.generation) end
+})
+
+
+return yices
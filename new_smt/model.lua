@@ -14,6 +14,12 @@ local rcc = require('model.rcc')
 local animation = require('model.animation')
 local spatial = require('model.spatial')
 
+-- animations that `model:sample` evaluates without the solver
+local polynomial = animation.polynomial
+
+-- source of this module, skipped when locating the calls of builders
+local here = debug.getinfo(1, 'S').source
+
 
 --- Class table
 -- @field INF Constant to represents an infinite value in time.
@@ -25,6 +31,45 @@ local spatial = require('model.spatial')
 -- @field num_pause Default number of pause intervals to be created for each item (`2`).
 -- @field num_item Item name counter. This value is used for creating item
 -- names in case it is not provided.
+-- @field features Features used by the document (`nil`). It is used for
+-- choosing the solver configuration. Fields `flow`, `animation` and
+-- `incremental` (several checks and backtracking) are considered and
+-- a feature not set is not used. If `nil` any feature may be used.
+-- @field cache_dir Directory of the constraint cache (`nil`). If set,
+-- `build` saves the documents built there and reloads them instead
+-- of building them again.
+-- @field CACHE_VERSION Version of the constraints built by the model,
+-- part of the cache keys. It must change when the constraints built
+-- for a document change. The options of the model changing them
+-- (`scenario`, `derived`, `eliminate`, `tracked` and `features`) are
+-- part of the keys too (see `model:build`).
+-- @field animations Polynomial animations of the document (see
+-- `model:sample`).
+-- @field boundaries Times at which the animations and the values set
+-- begin or end (see `model:timeline`).
+-- @field layout_cache_size Number of layouts kept by the checks
+-- (`64`). The layout of a check with the same assumed literals as a
+-- previous one is reused while no formula is asserted or removed.
+-- If `0`, the layouts are not cached.
+-- @field derived Whether the centers and ends of the intervals are
+-- built as linear terms over their init and size, instead of
+-- constants bound to them by formulas (`false`).
+-- @field eliminate Whether the linear equalities of the items (their
+-- sizes and positions, `spatial.align`, `spatial.same_size` and
+-- `distribute`) are solved by the model before being sent to the
+-- solver (`false`). See `model:equate`. The solved forms are kept
+-- when a formula is removed, so the items must not be built between
+-- `smt.mark_backtrack` and `smt.backtrack`.
+-- @field tracked Whether the formulas of each call of the builders are
+-- asserted as implied by a selector literal, assumed by the checks,
+-- so `model:explain` can find the calls in conflict (`false`). The
+-- equalities are not eliminated and the flows are always encoded
+-- for the solver. The document `features` must include
+-- `incremental`.
+-- @field selectors Selectors of the tracked calls (see
+-- `model:assert_group`).
+-- @field num_model Model counter, giving the `id` of each new model.
+-- @field id Number of the model, part of the names of its selectors.
 local model = {}
 model.INF = -1
 model.FLOW_ALIGN = enum{"TOP", "LEFT", "CENTER", "RIGHT", "BOTTOM"}
@@ -36,6 +81,12 @@ model.num_selec = 2
 model.num_pause = 2
 model.num_item = 0
 model.num_flow = 0
+model.num_model = 0
+model.CACHE_VERSION = 3
+model.layout_cache_size = 64
+model.derived = false
+model.eliminate = false
+model.tracked = false
 
 
 ---------------------------------------------------------------------
@@ -47,188 +98,1760 @@ model.num_flow = 0
 -- 
 -- @treturn model Object representing a model.
 -- 
--- @raise Error if *obj* is not a table.
-function model:new(obj)
-    assert(not obj or typeof(obj) == 'table', 'Wrong type for argument obj.')
+-- @raise Error if *obj* is not a table.
+function model:new(obj)
+    assert(not obj or typeof(obj) == 'table', 'Wrong type for argument obj.')
+    
+    if not smt.INIT then
+        smt.init()
+    end
+    
+    local obj = obj or {}
+    model.num_model = model.num_model + 1
+    obj.id = obj.id or model.num_model
+    return setmetatable(obj, self)
+end
+
+
+---------------------------------------------------------------------
+-- Stop the solver, destroying all contexts and models.
+-- 
+-- @raise Error if the solver is not running.
+function model:destroy()
+    assert(smt.INIT, 'There is nothing to destroy.')
+    
+    smt.exit();
+end
+
+
+---------------------------------------------------------------------
+-- Asserts the formulas stated by a call of a builder (e.g.
+-- `model:relate` or `model:new_item`). If the model is `tracked`, the
+-- formulas are implied by a new selector literal, recorded in
+-- `selectors` with the name of the builder and the place (file and
+-- line) it was called from, outside of the model modules.
+-- 
+-- @tparam table forms List of formulas.
+-- 
+-- @raise Error if an error occurs while asserting the formulas.
+function model:assert_group(forms)
+    assert(type(forms) == 'table', 'Wrong type for argument forms.')
+    
+    if not self.tracked then
+        smt.assert_all(self, forms)
+        return
+    elseif #forms == 0 then
+        return
+    end
+    
+    -- the outermost call inside the model modules is the builder
+    local builder, where
+    local level = 2
+    local info = debug.getinfo(level, 'Sln')
+    while info do
+        if info.what ~= 'C' and info.source ~= here and not info.source:find('model[/\\][%w_]+%.lua$') then
+            where = info.short_src .. ':' .. info.currentline
+            break
+        end
+        builder = info.name or builder
+        level = level + 1
+        info = debug.getinfo(level, 'Sln')
+    end
+    
+    self.selectors = self.selectors or {}
+    local n = #self.selectors + 1
+    local literal = smt.constant(smt.BOOL, 'model' .. self.id .. '.selector' .. n)
+    self.selectors[n] = {literal = literal, builder = builder, where = where}
+    smt.assert(self, smt.imp(literal, #forms == 1 and forms[1] or smt.land(forms)))
+end
+
+
+---------------------------------------------------------------------
+-- Creates assertions to configure the variables representing an
+-- interval. The following formulas are asserted.
+--    (= c (/ (+ i e) 2))
+--    (= e (+ i s))
+-- 
+-- @tparam term i Constant representing the interval init.
+-- @tparam term c Constant representing the interval center.
+-- @tparam term e Constant representing the interval end.
+-- @tparam term s Constant representing the interval size.
+-- @tparam boolean r Determines if the interval end is related to the
+-- interval size.
+-- @tparam table forms List where to add the formulas. If `nil` the
+-- formulas are asserted right away.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * one of the arguments does not have the correct type;
+--  * an error occurs while creating the term;
+--  * an error occurs while asserting.
+function model:config_interval(i, c, e, s, r, forms)
+    assert(typeof(i) == 'term', 'Wrong type for argument i.')
+    assert(typeof(c) == 'term', 'Wrong type for argument c.')
+    assert(typeof(e) == 'term', 'Wrong type for argument e.')
+    assert(typeof(s) == 'term', 'Wrong type for argument s.')
+    assert(not forms or type(forms) == 'table', 'Wrong type for argument forms.')
+    
+    local f = forms or {}
+    f[#f + 1] = smt.compile{'eq', c, {'div', {'sum', i, e}, 2}}
+    if r then
+        f[#f + 1] = smt.lt(i, e)
+    else
+        f[#f + 1] = smt.eq(e, smt.sum{i, s})
+    end
+    
+    if not forms then
+        self:assert_group(f)
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Creates the terms of an interval, named after a prefix (e.g.
+-- `item.t` gives `item.ti`, `item.tc`, `item.te` and `item.ts`), and
+-- relates them as in `config_interval`.
+-- 
+-- If the model is `derived`, only the init and the size are
+-- constants. The end is the term `i + s` and the center `i + s/2`,
+-- so no formula is needed to relate them. If the end is not related
+-- to the size, the end is also a constant and the center `(i + e)/2`.
+-- 
+-- @tparam string prefix Prefix of the names of the constants.
+-- @tparam boolean r Determines if the interval end is related to the
+-- interval size.
+-- @tparam table forms List where to add the formulas.
+-- 
+-- @treturn term Term representing the interval init.
+-- @treturn term Term representing the interval center.
+-- @treturn term Term representing the interval end.
+-- @treturn term Term representing the interval size.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * one of the arguments does not have the correct type;
+--  * an error occurs while creating the terms.
+function model:interval(prefix, r, forms)
+    assert(typeof(prefix) == 'string', 'Wrong type for argument prefix.')
+    assert(type(forms) == 'table', 'Wrong type for argument forms.')
+    
+    local i = smt.constant(smt.REAL, prefix .. 'i')
+    if not self.derived then
+        local c = smt.constant(smt.REAL, prefix .. 'c')
+        local e = smt.constant(smt.REAL, prefix .. 'e')
+        local s = smt.constant(smt.REAL, prefix .. 's')
+        self:config_interval(i, c, e, s, r, forms)
+        return i, c, e, s
+    end
+    
+    local s = smt.constant(smt.REAL, prefix .. 's')
+    -- the terms keep their linear form for equate
+    if r then
+        local e = smt.constant(smt.REAL, prefix .. 'e')
+        forms[#forms + 1] = smt.lt(i, e)
+        local c = smt.compile{'div', {'sum', i, e}, 2}
+        c.linear = {{i, 0.5}, {e, 0.5}}
+        return i, c, e, s
+    end
+    local c = smt.compile{'sum', i, {'div', s, 2}}
+    local e = smt.sum{i, s}
+    c.linear = {{i, 1}, {s, 0.5}}
+    e.linear = {{i, 1}, {s, 1}}
+    return i, c, e, s
+end
+
+
+---------------------------------------------------------------------
+-- Error raised by the exact arithmetic of the linear forms when a
+-- result cannot be represented by the numbers of Lua.
+local inexact = {}
+
+
+---------------------------------------------------------------------
+-- Multiplies or adds two integers, raising `inexact` unless the result
+-- is exact (Dekker's product and Knuth's sum).
+-- 
+-- @tparam number a The first integer.
+-- @tparam number b The second integer.
+-- 
+-- @treturn number The result.
+local function exact_mul(a, b)
+    if math.abs(a) >= 2^996 or math.abs(b) >= 2^996 then
+        error(inexact)
+    end
+    local p = a * b
+    if math.abs(p) == math.huge then
+        error(inexact)
+    end
+    local t = a * (2^27 + 1)
+    local ah = t - (t - a)
+    local al = a - ah
+    t = b * (2^27 + 1)
+    local bh = t - (t - b)
+    local bl = b - bh
+    if ((ah * bh - p) + ah * bl + al * bh) + al * bl ~= 0 then
+        error(inexact)
+    end
+    return p
+end
+
+local function exact_add(a, b)
+    local s = a + b
+    local v = s - a
+    if math.abs(s) == math.huge or (a - (s - v)) + (b - v) ~= 0 then
+        error(inexact)
+    end
+    return s
+end
+
+
+---------------------------------------------------------------------
+-- Builds the rational `n / d` of two integers, as a pair `{n, d}` with
+-- `d > 0` and no common factor.
+-- 
+-- @tparam number n The numerator.
+-- @tparam number d The denominator, not `0`.
+-- 
+-- @treturn table The rational.
+local function gcd(a, b)
+    a, b = math.abs(a), math.abs(b)
+    while b ~= 0 do
+        a, b = b, math.fmod(a, b)
+    end
+    return a
+end
+
+local function reduce(n, d)
+    if d < 0 then
+        n, d = -n, -d
+    end
+    local g = gcd(n, d)
+    return {n / g, d / g}
+end
+
+
+---------------------------------------------------------------------
+-- Gets the exact rational value of a number.
+-- 
+-- @tparam number v The number.
+-- 
+-- @treturn table The rational (see `reduce`).
+local function rational(v)
+    if v ~= v or math.abs(v) == math.huge then
+        error(inexact)
+    end
+    local d = 1
+    while v ~= math.floor(v) do
+        v, d = v * 2, d * 2
+    end
+    if d == math.huge then
+        error(inexact)
+    end
+    return reduce(v, d)
+end
+
+
+---------------------------------------------------------------------
+-- Adds or multiplies two rationals (see `reduce`).
+-- 
+-- @tparam table a The first rational.
+-- @tparam table b The second rational.
+-- 
+-- @treturn table The result.
+local function radd(a, b)
+    local g = gcd(a[2], b[2])
+    local n = exact_add(exact_mul(a[1], b[2] / g), exact_mul(b[1], a[2] / g))
+    return reduce(n, exact_mul(a[2] / g, b[2]))
+end
+
+local function rmul(a, b)
+    local g, h = gcd(a[1], b[2]), gcd(b[1], a[2])
+    return {exact_mul(a[1] / g, b[1] / h), exact_mul(a[2] / h, b[2] / g)}
+end
+
+
+---------------------------------------------------------------------
+-- Gets the linear form of a number or a term, as a table with the
+-- constant part (`const`) and the coefficient of each constant,
+-- indexed by name (`terms`), all rationals (see `reduce`). The
+-- constants are kept in `names`.
+-- 
+-- @param v A number, a named constant or a derived term (see
+-- `model:interval`).
+-- @tparam table names Constants indexed by name.
+-- 
+-- @treturn table The linear form or `nil` if `v` is another term.
+local function linear(v, names)
+    if type(v) == 'number' then
+        return {const = rational(v), terms = {}}
+    elseif v.linear then
+        local l = {const = {0, 1}, terms = {}}
+        for _, t in ipairs(v.linear) do
+            names[t[1].name] = t[1]
+            l.terms[t[1].name] = radd(l.terms[t[1].name] or {0, 1}, rational(t[2]))
+        end
+        return l
+    elseif v.name then
+        names[v.name] = v
+        return {const = {0, 1}, terms = {[v.name] = {1, 1}}}
+    end
+    return nil
+end
+
+
+---------------------------------------------------------------------
+-- Adds a multiple of a linear form to a copy of another one.
+-- 
+-- @tparam table l The linear form.
+-- @tparam table m The linear form to be added.
+-- @tparam table k The multiple of `m`, a rational.
+-- 
+-- @treturn table The new linear form.
+local function add_linear(l, m, k)
+    local r = {const = radd(l.const, rmul(k, m.const)), terms = {}}
+    for name, c in pairs(l.terms) do
+        r.terms[name] = c
+    end
+    for name, c in pairs(m.terms) do
+        local v = radd(r.terms[name] or {0, 1}, rmul(k, c))
+        r.terms[name] = v[1] ~= 0 and v or nil
+    end
+    return r
+end
+
+
+---------------------------------------------------------------------
+-- Builds the number of a rational for `smt.compile`.
+-- 
+-- @tparam table r The rational.
+-- 
+-- @return The number or the expression of the division.
+local function ratio(r)
+    return r[2] == 1 and r[1] or {'div', r[1], r[2]}
+end
+
+
+---------------------------------------------------------------------
+-- Solves `a = b + d` in the system of equalities of a model (see
+-- `model:equate`), without changing it until the new solved form is
+-- known.
+-- 
+-- @tparam table system The system.
+-- @tparam term a The left side.
+-- @param b The right side, a term or a number.
+-- @param d A term or a number to be added to `b`.
+-- 
+-- @return The formula to be asserted, `true` if the equality is
+-- implied by the system or `nil` if one of its sides is not linear.
+-- 
+-- @raise `inexact` if a coefficient cannot be represented exactly.
+local function eliminate(system, a, b, d)
+    local names = {}
+    local la, lb, ld = linear(a, names), linear(b, names), linear(d or 0, names)
+    if not (la and lb and ld) then
+        return nil
+    end
+    local e = add_linear(add_linear(la, lb, {-1, 1}), ld, {-1, 1})
+    
+    -- replace the constants already solved
+    local solved = {}
+    for name in pairs(e.terms) do
+        if system.solved[name] then
+            solved[#solved + 1] = name
+        end
+    end
+    for _, name in ipairs(solved) do
+        local c = e.terms[name]
+        e.terms[name] = nil
+        e = add_linear(e, system.solved[name], c)
+    end
+    
+    -- solve the greatest name, so the solved form does not depend
+    -- on the order of the table
+    local var
+    for name in pairs(e.terms) do
+        if not var or name > var then
+            var = name
+        end
+    end
+    if not var then
+        return e.const[1] == 0 or smt.FALSE
+    end
+    
+    local k = e.terms[var]
+    e.terms[var] = nil
+    local l = add_linear({const = {0, 1}, terms = {}}, e, {-k[2], k[1]})
+    
+    -- replace var in the equalities where it appears
+    solved = {}
+    for name in pairs(system.uses[var] or {}) do
+        local f = system.solved[name]
+        if f.terms[var] then
+            local g = add_linear(f, l, f.terms[var])
+            g.terms[var] = nil
+            solved[name] = g
+        end
+    end
+    
+    for name, t in pairs(names) do
+        system.names[name] = t
+    end
+    for name, f in pairs(solved) do
+        system.solved[name] = f
+        for n in pairs(l.terms) do
+            system.uses[n] = system.uses[n] or {}
+            system.uses[n][name] = true
+        end
+    end
+    system.uses[var] = nil
+    for n in pairs(l.terms) do
+        system.uses[n] = system.uses[n] or {}
+        system.uses[n][var] = true
+    end
+    system.solved[var] = l
+    
+    local sum = {'sum'}
+    for name, c in pairs(l.terms) do
+        sum[#sum + 1] = (c[1] == 1 and c[2] == 1) and system.names[name]
+                        or {'mul', ratio(c), system.names[name]}
+    end
+    if #sum == 1 then
+        return smt.compile{'eq', system.names[var], ratio(l.const)}
+    end
+    if l.const[1] ~= 0 then
+        sum[#sum + 1] = ratio(l.const)
+    end
+    return smt.compile{'eq', system.names[var], sum}
+end
+
+
+---------------------------------------------------------------------
+-- States that `a = b + d`. If the model `eliminate`s, the equality is
+-- added to a system kept in solved form by Gaussian elimination over
+-- exact rationals: each equality solves one constant in terms of the
+-- constants not solved yet, which is replaced in the other equalities.
+-- The solver receives a single equality per solved constant, in its
+-- solved form when it is stated, or a bound if the constant has a
+-- fixed value. Equalities implied by the previous ones are not sent.
+-- 
+-- Equalities over other terms, whose coefficients cannot be kept
+-- exactly, or if the model does not `eliminate`, are built as
+-- `smt.eq(a, b + d)`.
+-- 
+-- @tparam term a The left side.
+-- @param b The right side, a term or a number.
+-- @param d A term or a number to be added to `b` or `nil`.
+-- @tparam table forms List where to add the formulas. If `nil` the
+-- formulas are asserted right away.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * one of the arguments does not have the correct type;
+--  * an error occurs while creating the terms;
+--  * an error occurs while asserting.
+function model:equate(a, b, d, forms)
+    assert(typeof(a) == 'term', 'Wrong type for argument a.')
+    assert(typeof(b) == 'term' or type(b) == 'number', 'Wrong type for argument b.')
+    assert(not d or typeof(d) == 'term' or type(d) == 'number', 'Wrong type for argument d.')
+    assert(not forms or type(forms) == 'table', 'Wrong type for argument forms.')
+    
+    local f
+    if self.eliminate and not self.tracked then
+        local system = self.equations
+        if not system then
+            system = {solved = {}, names = {}, uses = {}}
+            self.equations = system
+        end
+        local ok, res = pcall(eliminate, system, a, b, d)
+        if ok then
+            f = res
+        elseif res ~= inexact then
+            error(res, 0)
+        end
+    end
+    
+    if f == true then
+        return
+    elseif not f then
+        local rhs = type(b) == 'number' and smt.real(b) or b
+        if type(d) == 'number' and d ~= 0 then
+            rhs = smt.sum{rhs, smt.real(d)}
+        elseif d and type(d) ~= 'number' then
+            rhs = smt.sum{rhs, d}
+        end
+        f = smt.eq(a, rhs)
+    end
+    if forms then
+        forms[#forms + 1] = f
+    else
+        self:assert_group{f}
+    end
+end
+
+
+---------------------------------------------------------------------
+-- States to the temporal network of the model that `a >= b + d`, or
+-- `a > b + d` if `strict`, where `a` and `b` are times of the items.
+-- The formula itself is not asserted.
+-- 
+-- While all the temporal formulas given to the network form a Simple
+-- Temporal Network, it keeps the earliest times satisfying them,
+-- updated by a label-correcting search (Bellman-Ford) from the
+-- constraint added. A strict difference adds an infinitesimal to the
+-- bound, which gets a value only when the times are used. The checks
+-- assume those times (see `network_literals`), so the solver does not
+-- search for them.
+-- 
+-- @tparam term a Named constant or `nil` for the time `0`.
+-- @tparam term b Named constant or `nil` for the time `0`.
+-- @tparam number d The difference.
+-- @tparam boolean strict Whether the difference is strict.
+-- 
+-- @raise Error if one of the arguments does not have the correct
+-- type.
+function model:difference(a, b, d, strict)
+    assert(not a or typeof(a) == 'term', 'Wrong type for argument a.')
+    assert(not b or typeof(b) == 'term', 'Wrong type for argument b.')
+    assert(type(d) == 'number', 'Wrong type for argument d.')
+    
+    local network = self.network
+    if not network then
+        network = {names = {}, value = {['']={0, 0}}, edges = {}, count = 1}
+        self.network = network
+    end
+    if network.general or (a and not a.name) or (b and not b.name) then
+        network.general = true
+        return
+    end
+    
+    local x, y = a and a.name or '', b and b.name or ''
+    for _, n in ipairs{x, y} do
+        if not network.value[n] then
+            network.names[n] = n == x and a or b
+            network.value[n] = {0, 0}
+            network.edges[n] = {}
+            network.count = network.count + 1
+        end
+    end
+    network.edges[y] = network.edges[y] or {}
+    table.insert(network.edges[y], {x, d, strict and 1 or 0})
+    network.times = nil
+    
+    -- raise the times reached from y, a time raised more than once
+    -- per time in the network means a positive cycle (inconsistent)
+    local queue, raised = {y}, {}
+    while #queue > 0 do
+        local u = table.remove(queue, 1)
+        local vu = network.value[u]
+        for _, e in ipairs(network.edges[u] or {}) do
+            local v, vv = e[1], network.value[e[1]]
+            local c, k = vu[1] + e[2], vu[2] + e[3]
+            if c > vv[1] or (c == vv[1] and k > vv[2]) then
+                raised[v] = (raised[v] or 0) + 1
+                if v == '' or raised[v] > network.count then
+                    network.general = true
+                    return
+                end
+                network.value[v] = {c, k}
+                queue[#queue + 1] = v
+            end
+        end
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Tells whether the document may use a feature.
+-- 
+-- @tparam model self The model.
+-- @tparam string feature Name of the feature.
+-- 
+-- @treturn bool True if the feature may be used.
+local function uses(self, feature)
+    return not self.features or self.features[feature] == true
+end
+
+
+---------------------------------------------------------------------
+-- Chooses the cheapest solver configuration for the document. Only
+-- linear real arithmetic is needed, unless the document has a flow
+-- (uninterpreted functions over integers) or animations (polynomials
+-- of `T`, which require the generic solver). A document that is
+-- checked only once uses the one-shot mode.
+-- 
+-- @tparam model self The model.
+-- 
+-- @treturn table Configuration for `smt.create_context`.
+local function context_options(self)
+    local options = {}
+    
+    if self.scenario ~= SCENARIO.ST or not uses(self, 'animation') then
+        if self.scenario ~= SCENARIO.T and uses(self, 'flow') then
+            options.logic = 'QF_UFLIRA'
+        else
+            options.logic = 'QF_LRA'
+        end
+    end
+    
+    if uses(self, 'incremental') then
+        options.mode = 'push-pop'
+    else
+        options.mode = 'one-shot'
+    end
+    
+    return options
+end
+
+
+---------------------------------------------------------------------
+-- Create a context for the document validation and create the
+-- constants for representing the document *canvas* and time
+-- constants.
+-- 
+-- The constants to be created will depend on the model `scenario`.
+-- The context configuration depends on the `scenario` and on the
+-- document `features`.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is already a context for the document;
+--  * the model is `tracked` and the document `features` do not
+--  include `incremental`;
+--  * an error occurs while creating the context;
+--  * an error occurs while creating the basic document info.
+function model:init_document()
+    assert(not self.context, 'You must end the previous document first.')
+    assert(not self.tracked or uses(self, 'incremental'), 'A tracked model requires the incremental feature.')
+    
+    if not smt.CONTEXT[self] then
+        smt.create_context(self, context_options(self))
+    end
+    
+    local forms = {}
+    if self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST then
+        self.I = smt.constant(smt.REAL, 'I')
+        forms[#forms + 1] = smt.gt(self.I, smt.real(0))
+    end
+    
+    if self.scenario == SCENARIO.ST then
+        self.T = smt.constant(smt.REAL, 'T')
+        forms[#forms + 1] = smt.ge(self.T, smt.real(0))
+    end
+    
+    
+    local _t = {
+        ['t_size'] = self.t_size,
+        ['x_size'] = self.x_size,
+        ['x_init'] = 0,
+        ['x_end'] = self.x_size,
+        ['y_size'] = self.y_size,
+        ['y_init'] = 0,
+        ['y_end'] = self.y_size
+    }
+    self.canvas = item:new(self, 'canvas', _t)
+    
+    if self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST then
+        self.canvas.ti, self.canvas.tc, self.canvas.te, self.canvas.ts = self:interval('canvas.t', nil, forms)
+        self.canvas.pl = smt.constant(smt.BOOL, 'canvas.pl')
+        
+        forms[#forms + 1] = smt.eq(self.canvas.ti, smt.real(0))
+        if self.t_size ~= model.INF then
+            forms[#forms + 1] = smt.eq(self.canvas.ts, smt.real(self.t_size))
+        else
+            forms[#forms + 1] = smt.gt(self.canvas.ts, smt.real(0))
+        end
+        forms[#forms + 1] = smt.le(self.canvas.te, self.I)
+        forms[#forms + 1] = self.canvas.pl
+        
+        self:difference(self.canvas.ti, nil, 0)
+        self:difference(nil, self.canvas.ti, 0)
+        if self.t_size ~= model.INF then
+            self:difference(self.canvas.te, self.canvas.ti, self.t_size)
+            self:difference(self.canvas.ti, self.canvas.te, -self.t_size)
+        else
+            self:difference(self.canvas.te, self.canvas.ti, 0, true)
+        end
+        self:difference(self.I, self.canvas.te, 0)
+        self:difference(self.I, nil, 0, true)
+    end
+    
+    if self.scenario == SCENARIO.ST then
+        self.canvas.oc = smt.constant(smt.BOOL, 'canvas.oc')
+        
+        forms[#forms + 1] = self.canvas.oc
+    end
+    
+    if self.scenario == SCENARIO.S or self.scenario == SCENARIO.ST then
+        self.canvas.xi, self.canvas.xc, self.canvas.xe, self.canvas.xs = self:interval('canvas.x', nil, forms)
+        self.canvas.yi, self.canvas.yc, self.canvas.ye, self.canvas.ys = self:interval('canvas.y', nil, forms)
+        
+        self:equate(self.canvas.xi, 0, nil, forms)
+        self:equate(self.canvas.yi, 0, nil, forms)
+        self:equate(self.canvas.xs, self.x_size, nil, forms)
+        self:equate(self.canvas.ys, self.y_size, nil, forms)
+    end
+    
+    self:assert_group(forms)
+    self.context = true
+end
+
+
+---------------------------------------------------------------------
+-- Destroys a context and a model (if existent) after document
+-- validation is performed.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is not a context for the model;
+--  * an error occurs while destroying the context and/or the model.
+function model:end_document()
+    assert(self.context, 'You must initiate the document first.')
+    
+    if self.model then
+        smt.destroy_model(self);
+    end
+    smt.destroy_context(self);
+    self.layouts = nil
+    self.layout = nil
+    self.solved = nil
+    self.speculation = nil
+    self.flows = nil
+    self.equations = nil
+    self.network = nil
+    self.boundaries = nil
+    self.animations = nil
+end
+
+
+---------------------------------------------------------------------
+-- Computes the key of a document in the constraint cache, from the
+-- contents describing the document (e.g. the document and its style).
+-- The key changes with `CACHE_VERSION`.
+-- 
+-- @param ... Strings with the contents describing the document.
+-- 
+-- @treturn string The key, with 16 hexadecimal digits.
+function model.cache_key(...)
+    local h1, h2 = 5381, 0
+    local function add(s)
+        for i = 1, #s do
+            local b = s:byte(i)
+            h1 = (h1 * 33 + b) % 4294967296
+            h2 = (h2 * 65599 + b) % 4294967291
+        end
+    end
+    
+    -- the length of each part is added so parts can not be shifted
+    add(tostring(model.CACHE_VERSION))
+    for i = 1, select('#', ...) do
+        local s = tostring(select(i, ...))
+        add('\0' .. #s .. '\0')
+        add(s)
+    end
+    
+    return string.format('%04x%04x%04x%04x', math.floor(h1 / 65536), h1 % 65536,
+                         math.floor(h2 / 65536), h2 % 65536)
+end
+
+
+---------------------------------------------------------------------
+-- Packs a list of values in a table, with field `n` holding their
+-- number.
+-- 
+-- @param ... The values.
+-- 
+-- @treturn table The values.
+local function pack(...)
+    return {n = select('#', ...), ...}
+end
+
+
+---------------------------------------------------------------------
+-- Writes a value as a Lua expression for the constraint cache.
+-- Constants are written as `T'name'`, other terms as `E'expression'`
+-- and items as `I(n)`, the fields of the items being written apart,
+-- in `items`.
+-- 
+-- @tparam table out List where to add the pieces of the expression.
+-- @param v The value.
+-- @tparam table names Names of the constants of the constraint set.
+-- @tparam table items Items found so far, with their number.
+-- @tparam table seen Tables being written, to detect cycles.
+-- 
+-- @raise Error if the value can not be written.
+local function encode(out, v, names, items, seen)
+    local kind = typeof(v)
+    
+    if kind == 'integer' or kind == 'double' then
+        assert(v == v and v ~= math.huge and v ~= -math.huge, 'number not finite')
+        out[#out + 1] = string.format('%.17g', v)
+    elseif kind == 'string' then
+        out[#out + 1] = string.format('%q', v)
+    elseif kind == 'boolean' then
+        out[#out + 1] = tostring(v)
+    elseif kind == 'term' and v.name then
+        assert(names[v.name], 'term is not a constant of the document')
+        out[#out + 1] = 'T' .. string.format('%q', v.name)
+    elseif kind == 'term' then
+        -- e.g. the ends and centers of a derived interval
+        out[#out + 1] = 'E' .. string.format('%q', smt.to_string(v))
+    elseif kind == 'item' then
+        if not items[v] then
+            items[#items + 1] = v
+            items[v] = #items
+        end
+        out[#out + 1] = 'I(' .. items[v] .. ')'
+    elseif type(v) == 'table' and getmetatable(v) == nil then
+        assert(not seen[v], 'cycle in table')
+        seen[v] = true
+        out[#out + 1] = '{'
+        local n = #v
+        for i = 1, n do
+            encode(out, v[i], names, items, seen)
+            out[#out + 1] = ', '
+        end
+        for k, e in pairs(v) do
+            if type(k) ~= 'number' or k < 1 or k > n or k % 1 ~= 0 then
+                out[#out + 1] = '['
+                encode(out, k, names, items, seen)
+                out[#out + 1] = '] = '
+                encode(out, e, names, items, seen)
+                out[#out + 1] = ', '
+            end
+        end
+        out[#out + 1] = '}'
+        seen[v] = nil
+    else
+        error('value of type ' .. kind .. ' not supported')
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Writes a document to the constraint cache: its constraint set, the
+-- fields of the model set by its building function and the results
+-- of the function, with the items they refer to. The fields the
+-- model had before (its options, e.g. `cache_dir`, `id` or
+-- `layout_cache_size`) are not written, so a model reloading the
+-- document keeps its own.
+-- 
+-- @tparam model self The model.
+-- @tparam string path Path of the cache file.
+-- @tparam string key Key of the document.
+-- @tparam table set Constraint set of the document (see `smt.dump`).
+-- @tparam table results Results of the building function, with field
+-- `n` holding their number.
+-- @tparam table before Fields of the model before the building
+-- function.
+-- 
+-- @raise Error if the document can not be written.
+local function write_cache(self, path, key, set, results, before)
+    local names = {}
+    for _, c in ipairs(set.constants) do
+        names[c[1]] = true
+    end
+    
+    local fields = {}
+    for k, v in pairs(self) do
+        if k ~= 'context' and k ~= 'model' and before[k] ~= v then
+            fields[k] = v
+        end
+    end
+    
+    local out = {}
+    local items = {}
+    encode(out, fields, names, items, {})
+    out[#out + 1] = ', '
+    encode(out, results, names, items, {})
+    local state = table.concat(out)
+    
+    -- the fields of the items may refer to other items
+    out = {}
+    local i = 1
+    while items[i] do
+        local f = {}
+        for k, v in pairs(items[i]) do
+            if k ~= 'model' then
+                f[k] = v
+            end
+        end
+        out[#out + 1] = '    F(' .. i .. ', '
+        encode(out, f, names, items, {})
+        out[#out + 1] = ')\n'
+        i = i + 1
+    end
+    
+    local head = {'return {\nkey = ', string.format('%q', key), ',\nconstants = '}
+    encode(head, set.constants, names, {}, {})
+    head[#head + 1] = ',\nformulas = '
+    encode(head, set.formulas, names, {}, {})
+    head[#head + 1] = ',\nstate = function (T, I, F, E)\n'
+    
+    -- the file is replaced at once, so a partial file is never read
+    local tmp = path .. '.tmp'
+    local file = assert(io.open(tmp, 'wb'))
+    file:write(table.concat(head), table.concat(out), '    return ', state, '\nend\n}\n')
+    file:close()
+    os.remove(path)
+    assert(os.rename(tmp, path))
+end
+
+
+---------------------------------------------------------------------
+-- Reads a document from the constraint cache.
+-- 
+-- @tparam string path Path of the cache file.
+-- @tparam string key Key of the document.
+-- 
+-- @treturn table The cached document or `nil` if there is not a
+-- valid one for the key.
+local function read_cache(path, key)
+    local chunk = loadfile(path)
+    if not chunk then
+        return nil
+    end
+    
+    setfenv(chunk, {})
+    local ok, cache = pcall(chunk)
+    if ok and type(cache) == 'table' and cache.key == key then
+        return cache
+    end
+    return nil
+end
+
+
+---------------------------------------------------------------------
+-- Rebuilds a document from the constraint cache, creating the
+-- context and restoring the constraint set, the model fields and the
+-- items.
+-- 
+-- @tparam model self The model.
+-- @tparam table cache The cached document.
+-- 
+-- @treturn table Results of the building function, with field `n`
+-- holding their number.
+-- 
+-- @raise Error if the cached document is not valid.
+local function restore(self, cache)
+    smt.create_context(self, context_options(self))
+    local terms = smt.restore(self, cache)
+    
+    local items = {}
+    local function T(name)
+        return assert(terms[name], 'unknown constant in cache')
+    end
+    local function I(i)
+        items[i] = items[i] or item:new(self, '', {})
+        return items[i]
+    end
+    local function F(i, fields)
+        for k, v in pairs(fields) do
+            I(i)[k] = v
+        end
+    end
+    
+    local fields, results = cache.state(T, I, F, smt.parse_term)
+    for k, v in pairs(fields) do
+        self[k] = v
+    end
+    self.context = true
+    
+    return results
+end
+
+
+---------------------------------------------------------------------
+-- Builds the document by calling `build`, or reloads it from the
+-- constraint cache in `cache_dir`, if the document was already built
+-- with the same key.
+-- 
+-- The whole constraint set built by `build` is saved in the cache,
+-- together with the model fields and the values returned by `build`.
+-- When reloaded, the constants are created again and the formulas
+-- are parsed and asserted at once, so the terms are not built one by
+-- one again. The items are restored with the same fields, so the
+-- items returned by `build` can be used as the ones built. The
+-- document is saved under `key` combined with the options of the
+-- model changing the constraints built.
+-- 
+-- `build` must initiate the document. It may return numbers,
+-- strings, booleans, items, terms and tables of those. A
+-- document using other values or whose constraint set can not be
+-- rebuilt (see `smt.dump`) is not saved. A cached document that can
+-- not be reloaded is built again.
+-- 
+-- @tparam string key Key of the document (see `model.cache_key`).
+-- @tparam function build Function building the document, which
+-- receives the model.
+-- 
+-- @return The values returned by `build`.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is already a context for the document;
+--  * one of the argument's type is not correct;
+--  * an error occurs while building the document.
+-- 
+-- @usage
+-- local f1, f2 = m:build(model.cache_key(document, style), function (m)
+--     m:init_document()
+--     local f1 = m:new_item{x_size = 240, y_size = 135}
+--     local f2 = m:new_item{x_size = 160, y_size = 90}
+--     m:flow(p, {f1, f2}, 10, 10)
+--     return f1, f2
+-- end)
+function model:build(key, build)
+    assert(not self.context, 'You must end the previous document first.')
+    assert(type(key) == 'string', 'Wrong type for argument key.')
+    assert(type(build) == 'function', 'Wrong type for argument build.')
+    
+    if not self.cache_dir then
+        return build(self)
+    end
+    
+    local features = {}
+    for _, feature in ipairs{'flow', 'animation', 'incremental'} do
+        features[#features + 1] = tostring(uses(self, feature))
+    end
+    key = model.cache_key(key, self.scenario, tostring(self.derived), tostring(self.eliminate),
+                          tostring(self.tracked), table.concat(features, ','))
+    local path = self.cache_dir .. '/' .. key .. '.cache'
+    local cache = read_cache(path, key)
+    if cache then
+        local ok, results = pcall(restore, self, cache)
+        if ok then
+            return unpack(results, 1, results.n)
+        end
+        
+        -- the constants restored are not used by the new build
+        if smt.CONTEXT[self] then
+            smt.destroy_context(self)
+        end
+        self.context = nil
+    end
+    
+    local before = {}
+    for k, v in pairs(self) do
+        before[k] = v
+    end
+    smt.record(self)
+    local results = pack(pcall(build, self))
+    local set = smt.dump(self)
+    if not results[1] then
+        error(results[2], 0)
+    end
+    
+    results = pack(unpack(results, 2, results.n))
+    if set then
+        pcall(write_cache, self, path, key, set, results, before)
+    end
+    
+    return unpack(results, 1, results.n)
+end
+
+
+---------------------------------------------------------------------
+-- Creates the formulas placing the items of a flow (see
+-- `model:flow`). The lines are represented by uninterpreted
+-- functions over the number of the flow and the position of the
+-- items, so the solver breaks the lines.
+-- 
+-- @tparam model self The model.
+-- @tparam table flow The flow.
+-- 
+-- @treturn table List of formulas.
+local function encode_flow(self, flow)
+    local flow_canvas, items = flow.canvas, flow.items
+    local hspace, vspace = flow.hspace, flow.vspace
+    local l_align, h_align, v_align = flow.l_align, flow.h_align, flow.v_align
+    local forms = {}
+    
+    -- create flow auxiliary functions if they do not exist
+    if not self.flow_funcs then
+        self.flow_funcs = {
+            lin = smt.create_function({smt.INT, smt.INT}, smt.INT, 'lin'),
+            top = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'top'),
+            bot = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'bot'),
+            first = smt.create_function({smt.INT, smt.INT}, smt.BOOL, 'first'),
+            lxi = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.xi'),
+            lxc = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.xc'),
+            lxe = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.xe'),
+            lxs = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.xs'),
+            lyi = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.yi'),
+            lyc = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.yc'),
+            lye = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.ye'),
+            lys = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.ys')
+        }
+    end
+    
+    -- flow info
+    self.num_flow = self.num_flow + 1
+    local nf = smt.int(self.num_flow)
+    local lin = self.flow_funcs.lin
+    local top = self.flow_funcs.top
+    local bot = self.flow_funcs.bot
+    local first = self.flow_funcs.first
+    local lxi = self.flow_funcs.lxi
+    local lxc = self.flow_funcs.lxc
+    local lxe = self.flow_funcs.lxe
+    local lxs = self.flow_funcs.lxs
+    local lyi = self.flow_funcs.lyi
+    local lyc = self.flow_funcs.lyc
+    local lye = self.flow_funcs.lye
+    local lys = self.flow_funcs.lys
+    
+    -- create hspace and vspace constants, named after the flow
+    local vs = smt.constant(smt.REAL, flow_canvas.name .. '.vspace')
+    local hs = smt.constant(smt.REAL, flow_canvas.name .. '.hspace')
+    forms[#forms + 1] = smt.eq(hs, smt.real(hspace))
+    forms[#forms + 1] = smt.eq(vs, smt.real(vspace))
+    
+    -- flow relation among items, each formula is built by the solver
+    -- in a single call (see smt.compile)
+    local function at(f, pos)
+        return {'apply', f, nf, pos}
+    end
+    local function on_line(f, pos)
+        return {'apply', f, nf, at(lin, pos)}
+    end
+    local function line_bounds(pos)
+        return {
+            {'eq', on_line(lxc, pos), {'sum', on_line(lxi, pos), {'div', on_line(lxs, pos), 2}}},
+            {'eq', on_line(lxe, pos), {'sum', on_line(lxi, pos), on_line(lxs, pos)}},
+            {'eq', on_line(lyc, pos), {'sum', on_line(lyi, pos), {'div', on_line(lys, pos), 2}}},
+            {'eq', on_line(lye, pos), {'sum', on_line(lyi, pos), on_line(lys, pos)}}
+        }
+    end
+    local function h_align_exp(pos)
+        if h_align == model.FLOW_ALIGN.LEFT then
+            return {'eq', on_line(lxi, pos), flow_canvas.xi}
+        elseif h_align == model.FLOW_ALIGN.CENTER then
+            return {'eq', on_line(lxc, pos), flow_canvas.xc}
+        elseif h_align == model.FLOW_ALIGN.RIGHT then
+            return {'eq', on_line(lxe, pos), flow_canvas.xe}
+        end
+    end
+    
+    for i = 1, #items - 1 do
+        local item_a = items[i]
+        local item_b = items[i+1]
+        local pos_a = i
+        local pos_b = i+1
+        
+        local l_align_exp
+        if l_align == model.FLOW_ALIGN.TOP then
+            l_align_exp = {'eq', item_b.yi, item_a.yi}
+        elseif l_align == model.FLOW_ALIGN.CENTER then
+            l_align_exp = {'eq', item_b.yc, item_a.yc}
+        elseif l_align == model.FLOW_ALIGN.BOTTOM then
+            l_align_exp = {'eq', item_b.ye, item_a.ye}
+        end
+        
+        -- item_b follows item_a, whose right border is x, if it fits
+        -- in the current line, otherwise it starts a new line
+        local function place(x)
+            local bounds = line_bounds(pos_b)
+            return {'ite', {'le', {'sum', {'sub', x, on_line(lxi, pos_a)}, hs, item_b.xs}, flow_canvas.xs},
+                    {'and',
+                        {'eq', at(lin, pos_b), at(lin, pos_a)},
+                        {'ite', {'lt', item_b.yi, at(top, pos_a)},
+                                {'eq', at(top, pos_b), item_b.yi},
+                                {'eq', at(top, pos_b), at(top, pos_a)}},
+                        {'ite', {'gt', item_b.ye, at(bot, pos_a)},
+                                {'eq', at(bot, pos_b), item_b.ye},
+                                {'eq', at(bot, pos_b), at(bot, pos_a)}},
+                        {'not', at(first, pos_b)},
+                        {'eq', item_b.xi, {'sum', x, hs}},
+                        l_align_exp
+                    },
+                    {'and',
+                        {'eq', at(lin, pos_b), {'sum', at(lin, pos_a), 1}},
+                        {'eq', at(top, pos_b), item_b.yi},
+                        {'eq', at(bot, pos_b), item_b.ye},
+                        at(first, pos_b),
+                        {'eq', on_line(lxe, pos_a), x},
+                        {'eq', on_line(lyi, pos_a), at(top, pos_a)},
+                        {'eq', on_line(lye, pos_a), at(bot, pos_a)},
+                        bounds[1], bounds[2], bounds[3], bounds[4],
+                        h_align_exp(pos_b),
+                        {'eq', on_line(lxi, pos_b), item_b.xi},
+                        {'eq', on_line(lyi, pos_b), {'sum', on_line(lye, pos_a), vs}}
+                    }}
+        end
+        
+        forms[#forms + 1] = smt.compile{'ite', {'not', item_b.oc},
+                {'and',
+                    {'eq', at(lin, pos_b), at(lin, pos_a)},
+                    {'eq', at(top, pos_b), at(top, pos_a)},
+                    {'eq', at(bot, pos_b), at(bot, pos_a)},
+                    l_align_exp,
+                    {'ite', item_a.oc,
+                            {'and',
+                                {'eq', item_b.xi, item_a.xe},
+                                {'not', at(first, pos_b)}},
+                            {'and',
+                                {'eq', item_b.xi, item_a.xi},
+                                {'iff', at(first, pos_b), at(first, pos_a)}}}
+                },
+                {'ite', item_a.oc,
+                        place(item_a.xe),
+                        {'ite', at(first, pos_a),
+                                {'and',
+                                    {'eq', at(lin, pos_b), at(lin, pos_a)},
+                                    {'eq', at(top, pos_b), item_b.yi},
+                                    {'eq', at(bot, pos_b), item_b.ye},
+                                    {'eq', item_b.xi, item_a.xi}},
+                                place(item_a.xi)}}}
+    end
+    
+    local n = #items
+    local bounds = line_bounds(1)
+    forms[#forms + 1] = smt.compile{'eq', at(lin, 1), 1}
+    forms[#forms + 1] = smt.compile{'eq', at(top, 1), items[1].yi}
+    forms[#forms + 1] = smt.compile{'eq', at(bot, 1), items[1].ye}
+    forms[#forms + 1] = smt.compile(at(first, 1))
+    for _,b in ipairs(bounds) do
+        forms[#forms + 1] = smt.compile(b)
+    end
+    forms[#forms + 1] = smt.compile(h_align_exp(1))
+    forms[#forms + 1] = smt.compile{'eq', on_line(lxi, 1), items[1].xi}
+    
+    forms[#forms + 1] = smt.compile{'ite', items[n].oc,
+                            {'eq', on_line(lxe, n), items[n].xe},
+                            {'eq', on_line(lxe, n), items[n].xi}}
+    forms[#forms + 1] = smt.compile{'eq', on_line(lyi, n), at(top, n)}
+    forms[#forms + 1] = smt.compile{'eq', on_line(lye, n), at(bot, n)}
+    
+    forms[#forms + 1] = smt.compile{'eq', at(lyc, 0), {'sum', at(lyi, 0), {'div', at(lys, 0), 2}}}
+    forms[#forms + 1] = smt.compile{'eq', at(lye, 0), {'sum', at(lyi, 0), at(lys, 0)}}
+    if v_align == model.FLOW_ALIGN.TOP then
+        forms[#forms + 1] = smt.compile{'eq', at(lyi, 0), flow_canvas.yi}
+    elseif v_align == model.FLOW_ALIGN.CENTER then
+        forms[#forms + 1] = smt.compile{'eq', at(lyc, 0), flow_canvas.yc}
+    elseif v_align == model.FLOW_ALIGN.BOTTOM then
+        forms[#forms + 1] = smt.compile{'eq', at(lye, 0), flow_canvas.ye}
+    end
+    forms[#forms + 1] = smt.compile{'eq', at(lyi, 0), on_line(lyi, 1)}
+    forms[#forms + 1] = smt.compile{'eq', at(lye, 0), on_line(lye, n)}
+    
+    return forms
+end
+
+
+---------------------------------------------------------------------
+-- Places the visible items of a flow whose items have fixed sizes,
+-- breaking the lines as the formulas of `encode_flow` do: an item
+-- follows the previous visible one if it fits in the width of the
+-- flow, otherwise it starts a new line. The lines are aligned in the
+-- flow and the items in their line by the flow options.
+-- 
+-- @tparam table flow The flow.
+-- @tparam table visible Tells, for each item position, whether the
+-- item is visible.
+-- 
+-- @treturn table List with the init `{x, y}` of each item, `nil` for
+-- the items not visible.
+local function layout_flow(flow, visible)
+    local canvas = flow.canvas
+    local hspace, vspace = flow.hspace, flow.vspace
+    
+    -- break the lines
+    local lines = {}
+    local line
+    for i, it in ipairs(flow.items) do
+        if visible[i] then
+            if line and line.width + hspace + it.x_size <= canvas.x_size then
+                line.width = line.width + hspace + it.x_size
+                line.height = math.max(line.height, it.y_size)
+            else
+                line = {width = it.x_size, height = it.y_size}
+                lines[#lines + 1] = line
+            end
+            line[#line + 1] = i
+        end
+    end
+    
+    -- place the lines in the flow
+    local height = vspace * math.max(#lines - 1, 0)
+    for _, l in ipairs(lines) do
+        height = height + l.height
+    end
+    local y
+    if flow.v_align == model.FLOW_ALIGN.TOP then
+        y = flow.y
+    elseif flow.v_align == model.FLOW_ALIGN.CENTER then
+        y = flow.y + (canvas.y_size - height) / 2
+    elseif flow.v_align == model.FLOW_ALIGN.BOTTOM then
+        y = flow.y + canvas.y_size - height
+    end
+    
+    -- place the items in their line
+    local places = {}
+    for _, l in ipairs(lines) do
+        local x
+        if flow.h_align == model.FLOW_ALIGN.LEFT then
+            x = flow.x
+        elseif flow.h_align == model.FLOW_ALIGN.CENTER then
+            x = flow.x + (canvas.x_size - l.width) / 2
+        elseif flow.h_align == model.FLOW_ALIGN.RIGHT then
+            x = flow.x + canvas.x_size - l.width
+        end
+        
+        for _, i in ipairs(l) do
+            local it = flow.items[i]
+            local yi
+            if flow.l_align == model.FLOW_ALIGN.TOP then
+                yi = y
+            elseif flow.l_align == model.FLOW_ALIGN.CENTER then
+                yi = y + (l.height - it.y_size) / 2
+            elseif flow.l_align == model.FLOW_ALIGN.BOTTOM then
+                yi = y + l.height - it.y_size
+            end
+            places[i] = {x, yi}
+            x = x + it.x_size + hspace
+        end
+        y = y + l.height + vspace
+    end
+    
+    return places
+end
+
+
+---------------------------------------------------------------------
+-- Gets the literals placing the items of the flows laid out by
+-- `layout_flow`, for the visibility of their items assumed by a
+-- check. A flow whose visibility is not given by the literals is
+-- encoded by formulas (see `encode_flow`) the first time, or again if
+-- the formulas were removed by backtracking.
+-- 
+-- @tparam model self The model.
+-- @tparam table literals Terms assumed to be true or `nil`.
+-- 
+-- @treturn table The literals and the ones placing the items.
+local function flow_literals(self, literals)
+    if not self.flows then
+        return literals
+    end
+    
+    local assumed = {}
+    for _, term in ipairs(literals or {}) do
+        assumed[term.index] = true
+    end
+    
+    local result
+    for _, flow in ipairs(self.flows) do
+        if flow.point and flow.point.removed then
+            flow.encoded = nil
+            flow.point = nil
+        end
+        if not flow.encoded then
+            local visible = {}
+            for i, it in ipairs(flow.items) do
+                if assumed[it.oc.index] then
+                    visible[i] = true
+                elseif assumed[flow.hidden[i].index] then
+                    visible[i] = false
+                else
+                    visible = nil
+                    break
+                end
+            end
+            
+            if visible then
+                result = result or {unpack(literals or {})}
+                for i, place in pairs(layout_flow(flow, visible)) do
+                    local it = flow.items[i]
+                    result[#result + 1] = smt.eq(it.xi, smt.real(place[1]))
+                    result[#result + 1] = smt.eq(it.yi, smt.real(place[2]))
+                end
+            else
+                flow.encoded = true
+                flow.point = smt.backtrack_point(self)
+                smt.assert_all(self, encode_flow(self, flow))
+            end
+        end
+    end
+    
+    return result or literals
+end
+
+
+---------------------------------------------------------------------
+-- Tells the temporal network that a temporal formula it can not
+-- represent was asserted, so the times are left to the solver.
+-- 
+-- @tparam model self The model.
+local function leave_network(self)
+    self.network = self.network or {}
+    self.network.general = true
+end
+
+
+---------------------------------------------------------------------
+-- Gets the literals fixing the times of the temporal network to the
+-- earliest ones (see `model:difference`). The infinitesimal of the
+-- strict differences takes a value small enough to satisfy all of
+-- them.
+-- 
+-- @tparam model self The model.
+-- @tparam table literals Terms assumed to be true or `nil`.
+-- 
+-- @treturn table The literals and the ones fixing the times, or `nil`
+-- if the times are left to the solver.
+local function network_literals(self, literals)
+    local network = self.network
+    if not network or network.general or not uses(self, 'incremental') then
+        return nil
+    end
+    
+    if not network.times then
+        local delta = 1
+        for u, edges in pairs(network.edges) do
+            for _, e in ipairs(edges) do
+                local vu, vv = network.value[u], network.value[e[1]]
+                local a, b = vv[1] - vu[1] - e[2], vv[2] - vu[2] - e[3]
+                if b < 0 then
+                    delta = math.min(delta, a / -b / 2)
+                end
+            end
+        end
+        
+        network.times = {}
+        for n, t in pairs(network.names) do
+            local v = network.value[n]
+            network.times[#network.times + 1] = smt.eq(t, smt.real(v[1] + v[2] * delta))
+        end
+    end
+    
+    local result = {unpack(literals or {})}
+    for _, l in ipairs(network.times) do
+        result[#result + 1] = l
+    end
+    return result
+end
+
+
+---------------------------------------------------------------------
+-- Checks the context, possibly under assumptions, and creates the
+-- model if the context is sat. If the check is interrupted, the
+-- previous model is kept.
+-- 
+-- Literals are added to the assumptions: the ones placing the items
+-- of the flows (see `flow_literals`), the selectors of a `tracked`
+-- model and the earliest times of the temporal network (see
+-- `network_literals`). The times are tried first and dropped if the
+-- context is sat only without them.
+-- 
+-- @tparam model self The model.
+-- @tparam table literals Terms assumed to be true or `nil`.
+-- @tparam table options Options of the search.
+-- 
+-- @treturn bool True if the context is sat and a model was created.
+-- @treturn string Status when the result is unknown.
+local function solve(self, literals, options)
+    literals = flow_literals(self, literals)
+    if self.tracked and self.selectors then
+        local l = {}
+        for _, term in ipairs(literals or {}) do
+            l[#l + 1] = term
+        end
+        for _, s in ipairs(self.selectors) do
+            l[#l + 1] = s.literal
+        end
+        literals = l
+    end
+    local bounded = options and options.timeout_ms and uses(self, 'incremental')
+    if bounded then
+        smt.mark_backtrack(self)
+    end
     
-    if not smt.INIT then
-        smt.init()
+    -- the earliest times of the temporal network are tried first
+    local sat, status
+    local timed = network_literals(self, literals)
+    if timed then
+        sat, status = smt.check_with_assumptions(self, timed, options)
+    end
+    if not timed or sat == false then
+        if literals then
+            sat, status = smt.check_with_assumptions(self, literals, options)
+        else
+            sat, status = smt.check(self, options)
+        end
+        
+        -- the times are not used again once they made a sat context
+        -- unsat
+        if timed and sat then
+            self.network.general = true
+        end
+    end
+    if status ~= 'interrupted' then
+        self.model = sat
+        if self.model then
+            smt.create_model(self)
+        end
     end
     
-    local obj = obj or {}
-    return setmetatable(obj, self)
+    if bounded then
+        smt.backtrack(self)
+    end
+    
+    if status then
+        return nil, status
+    end
+    return self.model
 end
 
 
 ---------------------------------------------------------------------
--- Stop the solver, destroying all contexts and models.
--- 
--- @raise Error if the solver is not running.
-function model:destroy()
-    assert(smt.INIT, 'There is nothing to destroy.')
-    
-    smt.exit();
+-- Gets the layout cache of the model, emptied if formulas were
+-- asserted or removed since its layouts were solved.
+-- 
+-- The cache keeps the result of the last checks, indexed by the key
+-- of their literals, and the values evaluated after each one. The
+-- layouts least recently used are dropped when there are more than
+-- `layout_cache_size`.
+-- 
+-- @tparam model self The model.
+-- 
+-- @treturn table The cache.
+local function layout_cache(self)
+    local cache = self.layouts
+    if not cache or cache.version ~= smt.VERSION[self] then
+        cache = {version = smt.VERSION[self], entries = {}, count = 0, tick = 0}
+        self.layouts = cache
+        self.layout = nil
+        self.solved = nil
+    end
+    return cache
 end
 
 
 ---------------------------------------------------------------------
--- Creates assertions to configure the variables representing an
--- interval. The following formulas are asserted.
---    (= c (/ (+ i e) 2))
---    (= e (+ i s))
+-- Computes the key of a list of literals in the layout cache. The
+-- key does not depend on the order of the literals, so the same set
+-- of visibility literals (and value of `T`) gives the same key.
 -- 
--- @tparam term i Constant representing the interval init.
--- @tparam term c Constant representing the interval center.
--- @tparam term e Constant representing the interval end.
--- @tparam term s Constant representing the interval size.
--- @tparam boolean r Determines if the interval end is related to the
--- interval size.
+-- @tparam table literals Terms assumed to be true or `nil`.
 -- 
--- @raise Error if one of the following occurs:
---
---  * one of the arguments does not have the correct type;
---  * an error occurs while creating the term;
---  * an error occurs while asserting.
-function model:config_interval(i, c, e, s, r)
-    assert(typeof(i) == 'term', 'Wrong type for argument i.')
-    assert(typeof(c) == 'term', 'Wrong type for argument c.')
-    assert(typeof(e) == 'term', 'Wrong type for argument e.')
-    assert(typeof(s) == 'term', 'Wrong type for argument s.')
-    
-    smt.assert(self, smt.eq(c, smt.div(smt.sum{i, e}, smt.real(2))))
-    if r then
-        smt.assert(self, smt.lt(i, e))
-    else
-        smt.assert(self, smt.eq(e, smt.sum{i, s}))
+-- @treturn string The key.
+local function layout_key(literals)
+    local t = {}
+    for i, term in ipairs(literals or {}) do
+        t[i] = term.index
     end
+    table.sort(t)
+    return table.concat(t, ',')
 end
 
 
 ---------------------------------------------------------------------
--- Create a context for the document validation and create the
--- constants for representing the document *canvas* and time
--- constants.
+-- Checks the context, possibly under assumptions, reusing the layout
+-- of a previous check with the same literals if the formulas of the
+-- context did not change. A reused layout does not call the solver:
+-- its values are given by `model:eval` from the cache.
 -- 
--- The constants to be created will depend on the model `scenario`.
+-- Only complete results are cached. The layout is solved again if a
+-- value not yet evaluated for it is needed.
 -- 
--- @raise Error if one of the following occurs:
---
---  * there is already a context for the document;
---  * an error occurs while creating the context;
---  * an error occurs while creating the basic document info.
-function model:init_document()
-    assert(not self.context, 'You must end the previous document first.')
+-- @tparam model self The model.
+-- @tparam table literals Terms assumed to be true or `nil`.
+-- @tparam table options Options of the search.
+-- 
+-- @treturn bool True if the context is sat and a model was created.
+-- @treturn string Status when the result is unknown.
+local function check(self, literals, options)
+    if self.layout_cache_size <= 0 then
+        self.layout = nil
+        return solve(self, literals, options)
+    end
     
-    if not smt.CONTEXT[self] then
-        smt.create_context(self)
+    local cache = layout_cache(self)
+    local key = layout_key(literals)
+    local entry = cache.entries[key]
+    cache.tick = cache.tick + 1
+    
+    if entry then
+        entry.used = cache.tick
+        self.layout = entry
+        self.model = entry.sat
+        return self.model
     end
     
-    if self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST then
-        self.I = smt.constant(smt.REAL, 'I')
-        smt.assert(self, smt.gt(self.I, smt.real(0)))
+    local sat, status = solve(self, literals, options)
+    if status == 'interrupted' then
+        return sat, status
+    elseif status then
+        self.layout = nil
+        return sat, status
     end
     
-    if self.scenario == SCENARIO.ST then
-        self.T = smt.constant(smt.REAL, 'T')
-        smt.assert(self, smt.ge(self.T, smt.real(0)))
+    -- the flows may have been encoded by the check
+    cache = layout_cache(self)
+    
+    -- drop the layout least recently used
+    if cache.count >= self.layout_cache_size then
+        local old
+        for k, e in pairs(cache.entries) do
+            if not old or e.used < cache.entries[old].used then
+                old = k
+            end
+        end
+        cache.entries[old] = nil
+        cache.count = cache.count - 1
     end
     
+    local copy = {}
+    for i, term in ipairs(literals or {}) do
+        copy[i] = term
+    end
+    entry = {sat = sat, literals = literals and copy, options = options, values = {}, used = cache.tick}
+    cache.entries[key] = entry
+    cache.count = cache.count + 1
+    self.layout = entry
+    self.solved = entry
     
-    local _t = {
-        ['t_size'] = self.t_size,
-        ['x_size'] = self.x_size,
-        ['x_init'] = 0,
-        ['x_end'] = self.x_size,
-        ['y_size'] = self.y_size,
-        ['y_init'] = 0,
-        ['y_end'] = self.y_size
-    }
-    self.canvas = item:new(self, 'canvas', _t)
+    return sat
+end
+
+
+---------------------------------------------------------------------
+-- Makes the model of the solver be the one of the current layout,
+-- solving it again if it was taken from the cache.
+-- 
+-- @tparam model self The model.
+-- 
+-- @raise Error if the layout can not be solved again.
+local function solved(self)
+    local entry = self.layout
+    if entry and self.solved ~= entry then
+        local sat = solve(self, entry.literals, entry.options)
+        assert(sat == entry.sat, 'The layout could not be solved again.')
+        self.solved = entry
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Evaluates a list of constants, taking the values of the current
+-- layout from the cache. The values evaluated by the solver are
+-- added to the cache.
+-- 
+-- @tparam model self The model.
+-- @tparam table terms List of terms to be evaluated.
+-- @tparam table types List with the type of each term.
+local function evaluate_all(self, terms, types)
+    local entry = self.layout
+    if not entry then
+        smt.eval_all(self, terms, types)
+        return
+    end
     
-    if self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST then
-        self.canvas.ti = smt.constant(smt.REAL, 'canvas.ti')
-        self.canvas.tc = smt.constant(smt.REAL, 'canvas.tc')
-        self.canvas.te = smt.constant(smt.REAL, 'canvas.te')
-        self.canvas.ts = smt.constant(smt.REAL, 'canvas.ts')
-        self.canvas.pl = smt.constant(smt.BOOL, 'canvas.pl')
-        
-        self:config_interval(self.canvas.ti, self.canvas.tc, self.canvas.te, self.canvas.ts)
-        
-        smt.assert(self, smt.eq(self.canvas.ti, smt.real(0)))
-        if self.t_size ~= model.INF then
-            smt.assert(self, smt.eq(self.canvas.ts, smt.real(self.t_size)))
+    local t, k = {}, {}
+    for i, term in ipairs(terms) do
+        local value = entry.values[term.index]
+        if value ~= nil then
+            term.value = value
         else
-            smt.assert(self, smt.gt(self.canvas.ts, smt.real(0)))
+            t[#t + 1] = term
+            k[#k + 1] = types[i]
         end
-        smt.assert(self, smt.le(self.canvas.te, self.I))
-        smt.assert(self, self.canvas.pl)
     end
     
-    if self.scenario == SCENARIO.ST then
-        self.canvas.oc = smt.constant(smt.BOOL, 'canvas.oc')
-        
-        smt.assert(self, self.canvas.oc)
+    if #t > 0 then
+        solved(self)
+        smt.eval_all(self, t, k)
+        for _, term in ipairs(t) do
+            entry.values[term.index] = term.value
+        end
     end
-    
-    if self.scenario == SCENARIO.S or self.scenario == SCENARIO.ST then
-        self.canvas.xi = smt.constant(smt.REAL, 'canvas.xi')
-        self.canvas.xc = smt.constant(smt.REAL, 'canvas.xc')
-        self.canvas.xe = smt.constant(smt.REAL, 'canvas.xe')
-        self.canvas.xs = smt.constant(smt.REAL, 'canvas.xs')
-        self.canvas.yi = smt.constant(smt.REAL, 'canvas.yi')
-        self.canvas.yc = smt.constant(smt.REAL, 'canvas.yc')
-        self.canvas.ye = smt.constant(smt.REAL, 'canvas.ye')
-        self.canvas.ys = smt.constant(smt.REAL, 'canvas.ys')
-        
-        self:config_interval(self.canvas.xi, self.canvas.xc, self.canvas.xe, self.canvas.xs)
-        self:config_interval(self.canvas.yi, self.canvas.yc, self.canvas.ye, self.canvas.ys)
-        
-        smt.assert(self, smt.eq(self.canvas.xi, smt.real(0)))
-        smt.assert(self, smt.eq(self.canvas.yi, smt.real(0)))
-        smt.assert(self, smt.eq(self.canvas.xs, smt.real(self.x_size)))
-        smt.assert(self, smt.eq(self.canvas.ys, smt.real(self.y_size)))
+end
+
+
+---------------------------------------------------------------------
+-- Evaluates a constant as `smt.eval`, taking the value of the
+-- current layout from the cache.
+-- 
+-- @tparam model self The model.
+-- @tparam term term Term to be evaluated.
+-- @tparam type type The type of the term.
+-- 
+-- @return The value of the constant.
+local function evaluate(self, term, type)
+    local entry = self.layout
+    if not entry then
+        return smt.eval(self, term, type)
     end
     
-    self.context = true
+    local value = entry.values[term.index]
+    if value == nil then
+        solved(self)
+        value = smt.eval(self, term, type)
+        entry.values[term.index] = value
+    end
+    term.value = value
+    return value
 end
 
 
 ---------------------------------------------------------------------
--- Destroys a context and a model (if existent) after document
--- validation is performed.
+-- Checks whether the context is sat or not. In case it is, creates
+-- a model with possible values for each constant.
+-- 
+-- The check may be bounded by field `timeout_ms` of `options`, the
+-- other fields being solver search parameters. If the time limit
+-- passes, the previous model (if any) is kept, so the values of the
+-- last successful check can still be evaluated. For an incremental
+-- document the bounded check is done inside a backtracking point, so
+-- the context can be used again after an interruption.
+-- 
+-- @tparam table options Options of the search (see `smt.check`).
+-- 
+-- @treturn bool True if the context is sat and a model was created,
+-- `nil` if the check was interrupted or its result is unknown.
+-- @treturn string When `nil` is returned, `'interrupted'` or `'unknown'`.
 -- 
 -- @raise Error if one of the following occurs:
 --
---  * there is not a context for the model;
---  * an error occurs while destroying the context and/or the model.
-function model:end_document()
+--  * there is not a context;
+--  * `options` is not a table;
+--  * an error occurs while checking the context or building the model.
+function model:check(options)
     assert(self.context, 'You must initiate the document first.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
     
-    if self.model then
-        smt.destroy_model(self);
-    end
-    smt.destroy_context(self);
+    return check(self, nil, options)
 end
 
 
 ---------------------------------------------------------------------
--- Checks whether the context is sat or not. In case it is, creates
--- a model with possible values for each constant.
+-- Checks whether the context is sat assuming a list of literals, as
+-- the visibility of the items (`item.oc`) or the value of `T`. The
+-- literals hold only for this check, so there is no need to
+-- backtrack them. In case the context is sat, creates a model.
 -- 
--- @treturn bool True if the context is sat and a model was created.
+-- @tparam table literals List of terms assumed to be true.
+-- @tparam table options Options of the search (see `model:check`).
+-- 
+-- @treturn bool True if the context is sat and a model was created,
+-- `nil` if the check was interrupted or its result is unknown.
+-- @treturn string When `nil` is returned, `'interrupted'` or `'unknown'`.
 -- 
 -- @raise Error if one of the following occurs:
 --
 --  * there is not a context;
+--  * the document `features` do not include `incremental`;
+--  * one of the argument's type is not correct;
 --  * an error occurs while checking the context or building the model.
-function model:check()
+-- 
+-- @usage
+-- m:check_assuming{f1.oc, smt.lnot(f2.oc)}
+function model:check_assuming(literals, options)
     assert(self.context, 'You must initiate the document first.')
+    assert(type(literals) == 'table', 'Wrong type for argument literals.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
+    assert(uses(self, 'incremental'), 'The document features do not include incremental.')
     
-    self.model = smt.check(self)
-    if self.model then
-        smt.create_model(self)
-    end
-    return self.model
+    return check(self, literals, options)
 end
 
 
@@ -253,48 +1876,297 @@ function model:eval(item)
     
     local pl
     if self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST then
-        pl = smt.eval(self, item.pl, smt.BOOL)
+        pl = evaluate(self, item.pl, smt.BOOL)
     end
     if pl then
         item.eval = true
-        smt.eval(self, item.ti, smt.REAL)
-        smt.eval(self, item.tc, smt.REAL)
-        smt.eval(self, item.te, smt.REAL)
-        smt.eval(self, item.ts, smt.REAL)
+        evaluate(self, item.ti, smt.REAL)
+        evaluate(self, item.tc, smt.REAL)
+        evaluate(self, item.te, smt.REAL)
+        evaluate(self, item.ts, smt.REAL)
         
         for _,i in ipairs(item.i_selec) do
-            local p = smt.eval(self, i.pl, smt.BOOL)
+            local p = evaluate(self, i.pl, smt.BOOL)
             if p then
                 i.eval = true
-                smt.eval(self, i.ti, smt.REAL)
+                evaluate(self, i.ti, smt.REAL)
             end
         end
         for _,i in ipairs(item.i_pause) do
-            local p = smt.eval(self, i.pl, smt.BOOL)
+            local p = evaluate(self, i.pl, smt.BOOL)
             if p then
                 i.eval = true
-                smt.eval(self, i.ti, smt.REAL)
-                smt.eval(self, i.tc, smt.REAL)
-                smt.eval(self, i.te, smt.REAL)
-                smt.eval(self, i.ts, smt.REAL)
+                evaluate(self, i.ti, smt.REAL)
+                evaluate(self, i.tc, smt.REAL)
+                evaluate(self, i.te, smt.REAL)
+                evaluate(self, i.ts, smt.REAL)
             end
         end
     end
     local oc
     if pl and self.scenario == SCENARIO.ST then
-        oc = smt.eval(self, item.oc, smt.BOOL)
+        oc = evaluate(self, item.oc, smt.BOOL)
     end
     if self.scenario == SCENARIO.S or (oc and self.scenario == SCENARIO.ST) then
         item.eval = true
-        smt.eval(self, item.xi, smt.REAL)
-        smt.eval(self, item.xc, smt.REAL)
-        smt.eval(self, item.xe, smt.REAL)
-        smt.eval(self, item.xs, smt.REAL)
-        smt.eval(self, item.yi, smt.REAL)
-        smt.eval(self, item.yc, smt.REAL)
-        smt.eval(self, item.ye, smt.REAL)
-        smt.eval(self, item.ys, smt.REAL)
+        evaluate(self, item.xi, smt.REAL)
+        evaluate(self, item.xc, smt.REAL)
+        evaluate(self, item.xe, smt.REAL)
+        evaluate(self, item.xs, smt.REAL)
+        evaluate(self, item.yi, smt.REAL)
+        evaluate(self, item.yc, smt.REAL)
+        evaluate(self, item.ye, smt.REAL)
+        evaluate(self, item.ys, smt.REAL)
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Lists the constants of the items evaluated by `model:eval_all`.
+-- 
+-- @tparam model self The model.
+-- @tparam table items List of item objects.
+-- 
+-- @treturn table List of terms.
+-- @treturn table List with the type of each term.
+local function item_terms(self, items)
+    local temporal = self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST
+    local spatial = self.scenario == SCENARIO.S or self.scenario == SCENARIO.ST
+    local terms, types = {}, {}
+    local function add(term, type)
+        terms[#terms + 1] = term
+        types[#types + 1] = type
+    end
+    
+    for _,item in ipairs(items) do
+        assert(typeof(item) == 'item', 'Wrong type for argument item.')
+        if temporal then
+            add(item.pl, smt.BOOL)
+            add(item.ti, smt.REAL)
+            add(item.tc, smt.REAL)
+            add(item.te, smt.REAL)
+            add(item.ts, smt.REAL)
+            for _,i in ipairs(item.i_selec) do
+                add(i.pl, smt.BOOL)
+                add(i.ti, smt.REAL)
+            end
+            for _,i in ipairs(item.i_pause) do
+                add(i.pl, smt.BOOL)
+                add(i.ti, smt.REAL)
+                add(i.tc, smt.REAL)
+                add(i.te, smt.REAL)
+                add(i.ts, smt.REAL)
+            end
+        end
+        if self.scenario == SCENARIO.ST then
+            add(item.oc, smt.BOOL)
+        end
+        if spatial then
+            add(item.xi, smt.REAL)
+            add(item.xc, smt.REAL)
+            add(item.xe, smt.REAL)
+            add(item.xs, smt.REAL)
+            add(item.yi, smt.REAL)
+            add(item.yc, smt.REAL)
+            add(item.ye, smt.REAL)
+            add(item.ys, smt.REAL)
+        end
+    end
+    return terms, types
+end
+
+
+---------------------------------------------------------------------
+-- Evaluates the constants of a list of items. The values of all
+-- items are retrieved in a single solver call.
+-- 
+-- The values are stored in the items constants as in `model:eval`,
+-- which also gives the rules for an item to be marked as evaluated.
+-- 
+-- @tparam table items List of item objects to have their value evaluated.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is not a model for the context;
+--  * one of the items is not an item object;
+--  * an error occurs while evaluating the values.
+function model:eval_all(items)
+    assert(self.model, 'There is no model for the document.')
+    
+    local temporal = self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST
+    local terms, types = item_terms(self, items)
+    evaluate_all(self, terms, types)
+    
+    for _,item in ipairs(items) do
+        local pl = temporal and item.pl.value
+        if pl then
+            item.eval = true
+            for _,i in ipairs(item.i_selec) do
+                if i.pl.value then
+                    i.eval = true
+                end
+            end
+            for _,i in ipairs(item.i_pause) do
+                if i.pl.value then
+                    i.eval = true
+                end
+            end
+        end
+        if self.scenario == SCENARIO.S or (pl and self.scenario == SCENARIO.ST and item.oc.value) then
+            item.eval = true
+        end
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Lists the states likely to follow the current one, to be solved by
+-- `model:presolve` while the document is idle. The states are the
+-- ones reached by toggling one of the `literals` of the last check
+-- (e.g. an item becoming visible or hidden) and, if `options.time`
+-- is given, the checks of `model:checkInTime` at the next begin or
+-- end of each item after that time.
+-- 
+-- The states replace the ones not yet solved. When one of them is
+-- checked, its layout is taken from the layout cache, so the number
+-- of states is bounded by `layout_cache_size`.
+-- 
+-- @tparam table literals List of terms assumed in the current state.
+-- @tparam table items Items to have their values evaluated in each
+-- state (see `model:eval_all`).
+-- @tparam table options Options of the search (see `model:check`),
+-- and `time`, the current value of `T`. If `nil`, the last check
+-- options are used.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is not a context;
+--  * the document `features` do not include `incremental`;
+--  * one of the argument's type is not correct;
+--  * `options.time` is given and the `scenario` is `S` or there is
+--  not a model for the context.
+-- 
+-- @usage
+-- m:check_assuming{f1.oc, smt.lnot(f2.oc)}
+-- m:speculate({f1.oc, smt.lnot(f2.oc)}, {f1, f2})
+-- event.timer(0, function () m:presolve() end)
+function model:speculate(literals, items, options)
+    assert(self.context, 'You must initiate the document first.')
+    assert(type(literals) == 'table', 'Wrong type for argument literals.')
+    assert(type(items) == 'table', 'Wrong type for argument items.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
+    assert(uses(self, 'incremental'), 'The document features do not include incremental.')
+    
+    local states = {}
+    local search
+    if options then
+        search = {}
+        for k, v in pairs(options) do
+            if k ~= 'time' then
+                search[k] = v
+            end
+        end
+    end
+    
+    for i = 1, #literals do
+        local state = {}
+        for j, term in ipairs(literals) do
+            state[j] = i == j and smt.lnot(term) or term
+        end
+        states[#states + 1] = state
+    end
+    
+    local time = options and options.time
+    if time then
+        assert(self.scenario ~= SCENARIO.S, "The model scenario must be either T or ST.")
+        assert(type(time) == 'number', 'Wrong type for option time.')
+        assert(self.model, 'There is no model for the document.')
+        
+        local times, seen = {}, {}
+        for _, item in ipairs(items) do
+            if evaluate(self, item.pl, smt.BOOL) then
+                local t
+                for _, v in ipairs{evaluate(self, item.ti, smt.REAL), evaluate(self, item.te, smt.REAL)} do
+                    if v > time and (not t or v < t) then
+                        t = v
+                    end
+                end
+                if t and not seen[t] then
+                    seen[t] = true
+                    times[#times + 1] = t
+                end
+            end
+        end
+        table.sort(times)
+        for _, t in ipairs(times) do
+            states[#states + 1] = {smt.eq(self.T, smt.real(t))}
+        end
+    end
+    
+    -- keep room in the cache for the current layout
+    for i = #states, math.max(self.layout_cache_size - 1, 0) + 1, -1 do
+        states[i] = nil
+    end
+    
+    local terms, types = item_terms(self, items)
+    self.speculation = {states = states, terms = terms, types = types, options = search}
+end
+
+
+---------------------------------------------------------------------
+-- Solves the next state listed by `model:speculate`, evaluating the
+-- items in it and storing its layout in the layout cache. Meant to be
+-- called while the document is idle, one state per call, so that the
+-- events are handled between the calls.
+-- 
+-- The current layout, the model of the solver and the values of the
+-- items are kept, so the speculation does not change the results of
+-- the last check. A state whose check is interrupted or unknown is
+-- dropped.
+-- 
+-- @tparam table options Options of the search (see `model:check`).
+-- If `nil`, the options given to `model:speculate` are used.
+-- 
+-- @treturn bool True if there are states still to be solved.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is not a context;
+--  * `options` is not a table;
+--  * an error occurs while checking the context or evaluating values.
+function model:presolve(options)
+    assert(self.context, 'You must initiate the document first.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
+    
+    local speculation = self.speculation
+    if not speculation or #speculation.states == 0 or self.layout_cache_size <= 0 then
+        self.speculation = nil
+        return false
+    end
+    
+    local literals = table.remove(speculation.states, 1)
+    local cache = layout_cache(self)
+    if not cache.entries[layout_key(literals)] then
+        -- the model of the solver is kept too, since it is evaluated
+        -- when there is no current layout
+        local sat, layout, solved, current = self.model, self.layout, self.solved, smt.MODEL[self]
+        local values = {}
+        for i, term in ipairs(speculation.terms) do
+            values[i] = term.value
+        end
+        
+        if check(self, literals, options or speculation.options) then
+            evaluate_all(self, speculation.terms, speculation.types)
+        end
+        
+        for i, term in ipairs(speculation.terms) do
+            term.value = values[i]
+        end
+        self.model, self.layout, self.solved = sat, layout, solved
+        smt.MODEL[self] = current
     end
+    
+    return #speculation.states > 0
 end
 
 
@@ -363,12 +2235,17 @@ function model:init(items)
     assert(self.scenario ~= SCENARIO.S, "The model scenario must be either T or ST.")
     assert(type(items) == 'table', 'Wrong type for argument items.')
     
+    local forms = {}
     for i, item in ipairs(items) do
         assert(typeof(item) == 'item', 'Element at index ' .. i .. ' must be an item')
         
-        smt.assert(self, smt.land{item.pl, smt.eq(item.ti, self.canvas.ti)})
+        forms[#forms + 1] = smt.land{item.pl, smt.eq(item.ti, self.canvas.ti)}
         item.t_init = 0
+        self:difference(item.ti, self.canvas.ti, 0)
+        self:difference(self.canvas.ti, item.ti, 0)
     end
+    
+    self:assert_group(forms)
 end
 
 
@@ -386,6 +2263,14 @@ end
 -- means that relation **during** will be parameterized with a delay
 -- of 10 time units.
 -- 
+-- A single Allen relation is also given to the temporal network of
+-- the model (see `model:difference`). Alternative Allen relations
+-- leave the times to the solver. A single spatial equality between
+-- items that always exist (the `S` scenario) is eliminated if the
+-- model `eliminate`s (see `model:equate`). The RCC relations decided
+-- by the regions the items bound are not asserted, or drop out of
+-- the alternatives if they cannot hold.
+-- 
 -- @tparam item item1 Item to participate in the relation.
 -- @tparam table relation Relation(s) to be issued between `item1` and `item2`.
 -- @tparam item item2 Item to participate in the relation.
@@ -409,11 +2294,12 @@ function model:relate(item1, relation, item2)
     assert(typeof(item2) == 'item', 'Wrong type for argument item2.')
     
     local exp = {}
+    local detail
     for _, rel in pairs(relation) do
         if type(rel) == "table" then
-            exp[#exp + 1], exp_type = rel[1](item1, item2, unpack(rel, 2))
+            exp[#exp + 1], exp_type, detail = rel[1](item1, item2, unpack(rel, 2))
         else
-            exp[#exp + 1], exp_type = rel(item1, item2)
+            exp[#exp + 1], exp_type, detail = rel(item1, item2)
         end
         assert(self.scenario == SCENARIO.ST or exp_type == self.scenario, 'This relation can not be asserted in the current scenario.')
     end
@@ -427,16 +2313,45 @@ function model:relate(item1, relation, item2)
         ext_var = smt.land{item1.pl, item2.pl}
     end
     
-    if #exp == 1 then
-        exp = exp[1]
+    -- a single Allen relation is a conjunction of differences
+    if exp_type == SCENARIO.T then
+        if #exp == 1 and detail then
+            for _, d in ipairs(detail) do
+                self:difference(d[1], d[2], d[3], d[4])
+            end
+        else
+            leave_network(self)
+        end
+    end
+    
+    -- a single equality that always holds may be eliminated
+    if self.eliminate and not self.tracked and exp_type == SCENARIO.S and #exp == 1 and detail and not ext_var then
+        self:equate(detail[1], detail[2], detail[3])
+        return
+    end
+    
+    -- RCC relations decided by the item regions (see model.rcc)
+    local open = {}
+    for _, e in ipairs(exp) do
+        if e.index == smt.TRUE.index then
+            return
+        elseif e.index ~= smt.FALSE.index then
+            open[#open + 1] = e
+        end
+    end
+    
+    if #open == 0 then
+        exp = smt.FALSE
+    elseif #open == 1 then
+        exp = open[1]
     else
-        exp = smt.lor(exp)
+        exp = smt.lor(open)
     end
     
     if ext_var then
-        smt.assert(self, smt.imp(ext_var, exp))
+        self:assert_group{smt.imp(ext_var, exp)}
     else
-        smt.assert(self, exp)
+        self:assert_group{exp}
     end
 end
 
@@ -482,12 +2397,60 @@ function model:place(left, right)
         for _, i in ipairs(right) do
             p[#p + 1] = i.pl
         end
-        pr = smt.land(p)
-    else
-        pr = right[1].pl
+        pr = smt.land(p)
+    else
+        pr = right[1].pl
+    end
+    
+    self:assert_group{smt.iff(pl, pr)}
+end
+
+
+---------------------------------------------------------------------
+-- Joins a list of formulas with `smt.land` or `smt.lor`, which need
+-- at least two terms.
+-- 
+-- @tparam function op `smt.land` or `smt.lor`.
+-- @tparam table forms List of formulas.
+-- 
+-- @treturn term The formula.
+local function join(op, forms)
+    if #forms == 1 then
+        return forms[1]
+    end
+    return op(forms)
+end
+
+
+---------------------------------------------------------------------
+-- Creates an expression that associates a variable to the bound of
+-- the variables from a list of pairs (variable, property), given that
+-- property is true. The expression has linear size: `var` is bounded
+-- by each variable whose property is true and equals one of them.
+-- 
+-- @tparam term var Variable to have its value set.
+-- @tparam table props List of pairs (variable, property). If the
+-- property is `nil`, the variable is always considered.
+-- @tparam function bound `smt.le` for the smaller variable or
+-- `smt.ge` for the biggest.
+-- 
+-- @treturn term An expression giving the possible values of `var`,
+-- given that one of the properties in `props` is true.
+local function extreme(var, props, bound)
+    local forms = {}
+    local values = {}
+    for _, p in ipairs(props) do
+        if p[2] then
+            forms[#forms + 1] = smt.lor{smt.lnot(p[2]), bound(var, p[1])}
+            values[#values + 1] = smt.land{p[2], smt.eq(var, p[1])}
+        else
+            forms[#forms + 1] = bound(var, p[1])
+            values[#values + 1] = smt.eq(var, p[1])
+        end
     end
+    forms[#forms + 1] = join(smt.lor, values)
     
-    smt.assert(self, smt.iff(pl, pr))
+    return join(smt.land, forms)
 end
 
 
@@ -496,36 +2459,13 @@ end
 -- variable from a list of pairs (variable, property), given that
 -- property is true.
 -- 
--- @tparam string var String representing the variable to have its
--- value set.
+-- @tparam term var Variable to have its value set.
 -- @tparam table props List of pairs (variable, property).
 -- 
 -- @treturn term An expression giving the possible values of `var`,
 -- given that one of the properties in `props` is true.
 local function first(var, props)
-    local forms = {}
-    for i, p in ipairs(props) do
-        local f = {p[2]}
-        for j,q in ipairs(props) do
-            if j < i then
-                if q[2] then
-                    f[#f + 1] = smt.lor{smt.le(p[1], q[1]), smt.lnot(q[2])}
-                else
-                    f[#f + 1] = smt.le(p[1], q[1])
-                end
-            elseif j > i then
-                if q[2] then
-                    f[#f + 1] = smt.lor{smt.lt(p[1], q[1]), smt.lnot(q[2])}
-                else
-                    f[#f + 1] = smt.lt(p[1], q[1])
-                end
-            end
-        end
-        f[#f + 1] = smt.eq(var, p[1])
-        forms[#forms + 1] = smt.land(f)
-    end
-    
-    return smt.lor(forms)
+    return extreme(var, props, smt.le)
 end
 
 
@@ -534,37 +2474,13 @@ end
 -- variable from a list of pairs (variable, property), given that
 -- property is true.
 -- 
--- @tparam string var String representing the variable to have its
--- value set.
+-- @tparam term var Variable to have its value set.
 -- @tparam table props List of pairs (variable, property).
 -- 
 -- @treturn term An expression giving the possible values of `var`,
 -- given that one of the properties in `props` is true.
 local function last(var, props)
-    -- create formulas relating propositions
-    local forms = {}
-    for i, p in ipairs(props) do
-        local f = {p[2]}
-        for j,q in ipairs(props) do
-            if j < i then
-                if q[2] then
-                    f[#f + 1] = smt.lor{smt.ge(p[1], q[1]), smt.lnot(q[2])}
-                else
-                    f[#f + 1] = smt.ge(p[1], q[1])
-                end
-            elseif j > i then
-                if q[2] then
-                    f[#f + 1] = smt.lor{smt.gt(p[1], q[1]), smt.lnot(q[2])}
-                else
-                    f[#f + 1] = smt.gt(p[1], q[1])
-                end
-            end
-        end
-        f[#f + 1] = smt.eq(var, p[1])
-        forms[#forms + 1] = smt.land(f)
-    end
-    
-    return smt.lor(forms)
+    return extreme(var, props, smt.ge)
 end
 
 
@@ -589,6 +2505,7 @@ function model:conditional(evt, events)
     assert(typeof(evt) == 'event', 'Wrong type for argument evt.')
     assert(type(events) == 'table', 'Wrong type for argument events.')
     
+    leave_network(self)
     local var
     local val
     
@@ -654,7 +2571,7 @@ function model:conditional(evt, events)
         val = first(var, props)
     end
     
-    smt.assert(self, smt.imp(evt.orig.pl, val))
+    self:assert_group{smt.imp(evt.orig.pl, val)}
 end
 
 
@@ -686,6 +2603,10 @@ function model:composition(relation, items)
     assert(type(items) == 'table', 'Wrong type for argument items.')
     
     local comp = self:new_item{t_size = model.INF, cond_end = true}
+    local forms = {}
+    if self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST then
+        leave_network(self)
+    end
     
     if self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST then
         local ti = {}
@@ -698,11 +2619,11 @@ function model:composition(relation, items)
         end
     
         -- comp exists only if some internal item exists
-        smt.assert(self, smt.iff(comp.pl, smt.lor(pl)))
+        forms[#forms + 1] = smt.iff(comp.pl, smt.lor(pl))
     
         -- comp begins with the first and ends with the last internal
-        smt.assert(self, smt.imp(comp.pl, first(comp.ti, ti)))
-        smt.assert(self, smt.imp(comp.pl, last(comp.te, te)))
+        forms[#forms + 1] = smt.imp(comp.pl, first(comp.ti, ti))
+        forms[#forms + 1] = smt.imp(comp.pl, last(comp.te, te))
     end
     
     if self.scenario == SCENARIO.S or self.scenario == SCENARIO.ST then
@@ -720,16 +2641,18 @@ function model:composition(relation, items)
         end
         
         -- comp exists only if some internal item exists
-        smt.assert(self, smt.iff(comp.oc, smt.lor(oc)))
+        forms[#forms + 1] = smt.iff(comp.oc, smt.lor(oc))
         
         -- comp begins with the first and ends with the last internal in eaxh axis
-        smt.assert(self, smt.imp(comp.oc, first(comp.xi, xi)))
-        smt.assert(self, smt.imp(comp.oc, last(comp.xe, xe)))
+        forms[#forms + 1] = smt.imp(comp.oc, first(comp.xi, xi))
+        forms[#forms + 1] = smt.imp(comp.oc, last(comp.xe, xe))
         
-        smt.assert(self, smt.imp(comp.oc, first(comp.yi, yi)))
-        smt.assert(self, smt.imp(comp.oc, last(comp.ye, ye)))
+        forms[#forms + 1] = smt.imp(comp.oc, first(comp.yi, yi))
+        forms[#forms + 1] = smt.imp(comp.oc, last(comp.ye, ye))
     end
     
+    self:assert_group(forms)
+    
     -- issue the relations among all internal
     for i = 1, #items - 1 do
         self:relate(items[i], relation, items[i + 1])
@@ -765,6 +2688,7 @@ end
 --
 --  * there is not a context;
 --  * one of the argument's type is not correct;
+--  * the document `features` do not include `animation`;
 --  * an error occurs while asserting realtion info.
 -- 
 -- @usage 
@@ -788,10 +2712,11 @@ function model:animate(anim_var, animation, p, t_init, t_end, anim_bef, anim_aft
     assert(_t == 'term' or _t == 'table', 'Wrong type for argument t_end.')
     assert(anim_bef == nil or type(anim_bef) == 'boolean', 'Wrong type for argument anim_bef.')
     assert(anim_aft == nil or type(anim_aft) == 'boolean', 'Wrong type for argument anim_aft.')
+    assert(uses(self, 'animation'), 'The document features do not include animation.')
     
     -- calculate the initial time
     local t_ai
-    if type(t_init) == 'table' then
+    if typeof(t_init) == 'table' then
         assert(typeof(t_init[1]) == 'term', 'Wrong type for t_init begin point.')
         assert(type(t_init[2]) == 'number', 'Wrong type for t_init delay.')
         
@@ -804,7 +2729,7 @@ function model:animate(anim_var, animation, p, t_init, t_end, anim_bef, anim_aft
     
     -- calculate the final time
     local t_ae
-    if type(t_end) == 'table' then
+    if typeof(t_end) == 'table' then
         assert(typeof(t_end[1]) == 'term', 'Wrong type for t_end begin point.')
         assert(type(t_end[2]) == 'number', 'Wrong type for t_end delay.')
         
@@ -824,14 +2749,28 @@ function model:animate(anim_var, animation, p, t_init, t_end, anim_bef, anim_aft
     local v_aft
     v_bef, v_dur, v_aft = animation(t_var, t_ae, p)
     
+    local forms = {}
     if anim_bef then
-        smt.assert(self, smt.imp(smt.lt(self.T, t_ai), smt.eq(anim_var, v_bef)))
+        forms[#forms + 1] = smt.imp(smt.lt(self.T, t_ai), smt.eq(anim_var, v_bef))
     end
     
-    smt.assert(self, smt.imp(smt.between(t_ai, self.T, t_ae), v_dur))
+    forms[#forms + 1] = smt.imp(smt.between(t_ai, self.T, t_ae), smt.eq(anim_var, v_dur))
     
     if anim_aft then
-        smt.assert(self, smt.imp(smt.gt(self.T, t_ae), smt.eq(anim_var, v_aft)))
+        forms[#forms + 1] = smt.imp(smt.gt(self.T, t_ae), smt.eq(anim_var, v_aft))
+    end
+    
+    self:assert_group(forms)
+    
+    self.boundaries = self.boundaries or {}
+    self.boundaries[#self.boundaries + 1] = t_ai
+    self.boundaries[#self.boundaries + 1] = t_ae
+    
+    if animation == polynomial then
+        self.animations = self.animations or {}
+        self.animations[#self.animations + 1] = {
+            var = anim_var, coef = p, ti = t_ai, te = t_ae, before = anim_bef, after = anim_aft
+        }
     end
 end
 
@@ -866,7 +2805,11 @@ function model:set(anim_var, value, interval)
     assert(not interval or typeof(interval) == 'item', 'Wrong type for argument interval.')
         
     local interval = interval or self:new_item()
-    smt.assert(self, smt.imp(smt.between(interval.ti, self.T, interval.te), smt.eq(anim_var, smt.real(value))))
+    self:assert_group{smt.imp(smt.between(interval.ti, self.T, interval.te), smt.eq(anim_var, smt.real(value)))}
+    
+    self.boundaries = self.boundaries or {}
+    self.boundaries[#self.boundaries + 1] = interval.ti
+    self.boundaries[#self.boundaries + 1] = interval.te
     
     return interval
 end
@@ -887,12 +2830,19 @@ end
 -- @tparam model.FLOW_ALIGN v_align Vertical alignment inside the
 -- flow. The default value is `model.FLOW_ALIGN.CENTER`.
 -- 
+-- If the sizes of the items and the region of the canvas are fixed,
+-- the items are placed without the solver in the checks assuming the
+-- visibility of all of them, by literals fixing their init. Otherwise
+-- (or once a check does not assume their visibility) the lines are
+-- broken by the solver.
+-- 
 -- @treturn item Item representing the canvas.
 -- 
 -- @raise Error if one of the following occurs:
 --
 --  * there is not a context;
 --  * one of the argument's type is not correct;
+--  * the document `features` do not include `flow`;
 --  * an error occurs while asserting realtion info.
 function model:flow(p, items, hspace, vspace, l_align, h_align, v_align)
     assert(self.context, 'You must initiate the document first.')
@@ -903,6 +2853,7 @@ function model:flow(p, items, hspace, vspace, l_align, h_align, v_align)
     assert(not l_align or type(l_align) == 'number', 'Wrong type for argument l_align.')
     assert(not h_align or type(h_align) == 'number', 'Wrong type for argument h_align.')
     assert(not v_align or type(v_align) == 'number', 'Wrong type for argument v_align.')
+    assert(uses(self, 'flow'), 'The document features do not include flow.')
     
     if l_align == nil or l_align == model.FLOW_ALIGN.LEFT or l_align == model.FLOW_ALIGN.RIGHT then
         l_align = model.FLOW_ALIGN.CENTER
@@ -915,216 +2866,51 @@ function model:flow(p, items, hspace, vspace, l_align, h_align, v_align)
     end
     
     local flow_canvas = self:new_item(p)
+    local forms = {}
     
     -- flow exists only if some internal item exists
     local p = {}
     for _,it in ipairs(items) do
         p[#p + 1] = it.oc
     end
-    smt.assert(self, smt.iff(flow_canvas.oc, smt.lor(p)))
+    forms[#forms + 1] = smt.iff(flow_canvas.oc, smt.lor(p))
+    
+    local flow = {
+        canvas = flow_canvas,
+        items = items,
+        hspace = hspace,
+        vspace = vspace,
+        l_align = l_align,
+        h_align = h_align,
+        v_align = v_align
+    }
     
-    -- create flow auxiliary functions if they do not exist
-    if not self.flow_funcs then
-        self.flow_funcs = {
-            lin = smt.create_function({smt.INT, smt.INT}, smt.INT, 'lin'),
-            top = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'top'),
-            bot = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'bot'),
-            first = smt.create_function({smt.INT, smt.INT}, smt.BOOL, 'first'),
-            lxi = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.xi'),
-            lxc = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.xc'),
-            lxe = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.xe'),
-            lxs = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.xs'),
-            lyi = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.yi'),
-            lyc = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.yc'),
-            lye = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.ye'),
-            lys = smt.create_function({smt.INT, smt.INT}, smt.REAL, 'l.ys')
-        }
+    -- the items are placed without the solver if their sizes and
+    -- the flow region are fixed (see layout_flow)
+    local fixed = flow_canvas.x_size and flow_canvas.y_size
+        and (flow_canvas.x_init or flow_canvas.x_end)
+        and (flow_canvas.y_init or flow_canvas.y_end)
+    for _,it in ipairs(items) do
+        fixed = fixed and it.x_size and it.y_size
     end
     
-    -- flow info
-    self.num_flow = self.num_flow + 1
-    local nf = smt.int(self.num_flow)
-    local lin = self.flow_funcs.lin
-    local top = self.flow_funcs.top
-    local bot = self.flow_funcs.bot
-    local first = self.flow_funcs.first
-    local lxi = self.flow_funcs.lxi
-    local lxc = self.flow_funcs.lxc
-    local lxe = self.flow_funcs.lxe
-    local lxs = self.flow_funcs.lxs
-    local lyi = self.flow_funcs.lyi
-    local lyc = self.flow_funcs.lyc
-    local lye = self.flow_funcs.lye
-    local lys = self.flow_funcs.lys
-    
-    -- create hspace and vspace constants
-    local vs = smt.constant(smt.REAL, 'vspace')
-    local hs = smt.constant(smt.REAL, 'hspace')
-    smt.assert(self, smt.eq(hs, smt.real(hspace)))
-    smt.assert(self, smt.eq(vs, smt.real(vspace)))
-    
-    -- flow relation among items
-    for i = 1, #items - 1 do
-        local item_a = items[i]
-        local item_b = items[i+1]
-        local pos_a = smt.int(i)
-        local pos_b = smt.int(i+1)
-        
-        
-        local l_align_exp
-        if l_align == model.FLOW_ALIGN.TOP then
-            l_align_exp = smt.eq(item_b.yi, item_a.yi)
-        elseif l_align == model.FLOW_ALIGN.CENTER then
-            l_align_exp = smt.eq(item_b.yc, item_a.yc)
-        elseif l_align == model.FLOW_ALIGN.BOTTOM then
-            l_align_exp = smt.eq(item_b.ye, item_a.ye)
-        end
-        
-        local h_align_exp
-        if h_align == model.FLOW_ALIGN.LEFT then
-            h_align_exp = smt.eq(smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_b})}), flow_canvas.xi)
-        elseif h_align == model.FLOW_ALIGN.CENTER then
-            h_align_exp = smt.eq(smt.apply(lxc, {nf, smt.apply(lin, {nf, pos_b})}), flow_canvas.xc)
-        elseif h_align == model.FLOW_ALIGN.RIGHT then
-            h_align_exp = smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, pos_b})}), flow_canvas.xe)
+    if fixed and not self.tracked then
+        flow.x = flow_canvas.x_init or flow_canvas.x_end - flow_canvas.x_size
+        flow.y = flow_canvas.y_init or flow_canvas.y_end - flow_canvas.y_size
+        flow.hidden = {}
+        for i,it in ipairs(items) do
+            flow.hidden[i] = smt.lnot(it.oc)
         end
-        
-        local h_align_exp
-        if h_align == model.FLOW_ALIGN.LEFT then
-            h_align_exp = smt.eq(smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_b})}), flow_canvas.xi)
-        elseif h_align == model.FLOW_ALIGN.CENTER then
-            h_align_exp = smt.eq(smt.apply(lxc, {nf, smt.apply(lin, {nf, pos_b})}), flow_canvas.xc)
-        elseif h_align == model.FLOW_ALIGN.RIGHT then
-            h_align_exp = smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, pos_b})}), flow_canvas.xe)
+        self.flows = self.flows or {}
+        self.flows[#self.flows + 1] = flow
+    else
+        flow.encoded = true
+        for _,f in ipairs(encode_flow(self, flow)) do
+            forms[#forms + 1] = f
         end
-        
-        
-        smt.assert(self, 
-            smt.ite(smt.lnot(item_b.oc),
-                    smt.land{
-                        smt.eq(smt.apply(lin, {nf, pos_b}), smt.apply(lin, {nf, pos_a})),
-                        smt.eq(smt.apply(top, {nf, pos_b}), smt.apply(top, {nf, pos_a})),
-                        smt.eq(smt.apply(bot, {nf, pos_b}), smt.apply(bot, {nf, pos_a})),
-                        l_align_exp,
-                        smt.ite(item_a.oc,
-                                smt.land{
-                                    smt.eq(item_b.xi, item_a.xe),
-                                    smt.lnot(smt.apply(first, {nf, pos_b}))
-                                },
-                                smt.land{
-                                    smt.eq(item_b.xi, item_a.xi),
-                                    smt.iff(smt.apply(first, {nf, pos_b}), smt.apply(first, {nf, pos_a}))
-                                })
-                    },
-                    smt.ite(item_a.oc,
-                            smt.ite(smt.le(smt.sum{smt.sub(item_a.xe, smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_a})})),hs, item_b.xs}, flow_canvas.xs),
-                                    smt.land{
-                                        smt.eq(smt.apply(lin, {nf, pos_b}), smt.apply(lin, {nf, pos_a})),
-                                        smt.ite(smt.lt(item_b.yi, smt.apply(top, {nf, pos_a})),
-                                                smt.eq(smt.apply(top, {nf, pos_b}), item_b.yi),
-                                                smt.eq(smt.apply(top, {nf, pos_b}), smt.apply(top, {nf, pos_a}))
-                                        ),
-                                        smt.ite(smt.gt(item_b.ye, smt.apply(bot, {nf, pos_a})),
-                                                smt.eq(smt.apply(bot, {nf, pos_b}), item_b.ye),
-                                                smt.eq(smt.apply(bot, {nf, pos_b}), smt.apply(bot, {nf, pos_a}))
-                                        ),
-                                        smt.lnot(smt.apply(first, {nf, pos_b})),
-                                        smt.eq(item_b.xi, smt.sum{item_a.xe, hs}),
-                                        l_align_exp
-                                    },
-                                    smt.land{
-                                        smt.eq(smt.apply(lin, {nf, pos_b}), smt.sum{smt.apply(lin, {nf, pos_a}), smt.int(1)}),
-                                        smt.eq(smt.apply(top, {nf, pos_b}), item_b.yi),
-                                        smt.eq(smt.apply(bot, {nf, pos_b}), item_b.ye),
-                                        smt.apply(first, {nf, pos_b}),
-                                        smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, pos_a})}), item_a.xe),
-                                        smt.eq(smt.apply(lyi, {nf, smt.apply(lin, {nf, pos_a})}), smt.apply(top, {nf, pos_a})),
-                                        smt.eq(smt.apply(lye, {nf, smt.apply(lin, {nf, pos_a})}), smt.apply(bot, {nf, pos_a})),
-                                        smt.eq(smt.apply(lxc, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_b})}), smt.div(smt.apply(lxs, {nf, smt.apply(lin, {nf, pos_b})}), smt.real(2))}),
-                                        smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_b})}), smt.apply(lxs, {nf, smt.apply(lin, {nf, pos_b})})}),
-                                        smt.eq(smt.apply(lyc, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lyi, {nf, smt.apply(lin, {nf, pos_b})}), smt.div(smt.apply(lys, {nf, smt.apply(lin, {nf, pos_b})}), smt.real(2))}),
-                                        smt.eq(smt.apply(lye, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lyi, {nf, smt.apply(lin, {nf, pos_b})}), smt.apply(lys, {nf, smt.apply(lin, {nf, pos_b})})}),
-                                        h_align_exp,
-                                        smt.eq(smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_b})}), item_b.xi),
-                                        smt.eq(smt.apply(lyi, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lye, {nf, smt.apply(lin, {nf, pos_a})}), vs})
-                                    }
-                            ),
-                            smt.ite(smt.apply(first, {nf, pos_a}),
-                                    smt.land{
-                                        smt.eq(smt.apply(lin, {nf, pos_b}), smt.apply(lin, {nf, pos_a})),
-                                        smt.eq(smt.apply(top, {nf, pos_b}), item_b.yi),
-                                        smt.eq(smt.apply(bot, {nf, pos_b}), item_b.ye),
-                                        smt.eq(item_b.xi, item_a.xi)
-                                    },
-                                    smt.ite(smt.le(smt.sum{smt.sub(item_a.xi, smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_a})})), hs, item_b.xs}, flow_canvas.xs),
-                                            smt.land{
-                                                smt.eq(smt.apply(lin, {nf, pos_b}), smt.apply(lin, {nf, pos_a})),
-                                                smt.ite(smt.lt(item_b.yi, smt.apply(top, {nf, pos_a})),
-                                                    smt.eq(smt.apply(top, {nf, pos_b}), item_b.yi),
-                                                    smt.eq(smt.apply(top, {nf, pos_b}), smt.apply(top, {nf, pos_a}))
-                                                ),
-                                                smt.ite(smt.gt(item_b.ye, smt.apply(bot, {nf, pos_a})),
-                                                    smt.eq(smt.apply(bot, {nf, pos_b}), item_b.ye),
-                                                    smt.eq(smt.apply(bot, {nf, pos_b}), smt.apply(bot, {nf, pos_a}))
-                                                ),
-                                                smt.lnot(smt.apply(first, {nf, pos_b})),
-                                                smt.eq(item_b.xi, smt.sum{item_a.xi, hs}),
-                                                l_align_exp
-                                            },
-                                            smt.land{
-                                                smt.eq(smt.apply(lin, {nf, pos_b}), smt.sum{smt.apply(lin, {nf, pos_a}), smt.int(1)}),
-                                                smt.eq(smt.apply(top, {nf, pos_b}), item_b.yi),
-                                                smt.eq(smt.apply(bot, {nf, pos_b}), item_b.ye),
-                                                smt.apply(first, {nf, pos_b}),
-                                                smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, pos_a})}), item_a.xi),
-                                                smt.eq(smt.apply(lyi, {nf, smt.apply(lin, {nf, pos_a})}), smt.apply(top, {nf, pos_a})),
-                                                smt.eq(smt.apply(lye, {nf, smt.apply(lin, {nf, pos_a})}), smt.apply(bot, {nf, pos_a})),
-                                                smt.eq(smt.apply(lxc, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_b})}), smt.div(smt.apply(lxs, {nf, smt.apply(lin, {nf, pos_b})}), smt.real(2))}),
-                                                smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_b})}), smt.apply(lxs, {nf, smt.apply(lin, {nf, pos_b})})}),
-                                                smt.eq(smt.apply(lyc, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lyi, {nf, smt.apply(lin, {nf, pos_b})}), smt.div(smt.apply(lys, {nf, smt.apply(lin, {nf, pos_b})}), smt.real(2))}),
-                                                smt.eq(smt.apply(lye, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lyi, {nf, smt.apply(lin, {nf, pos_b})}), smt.apply(lys, {nf, smt.apply(lin, {nf, pos_b})})}),
-                                                h_align_exp,
-                                                smt.eq(smt.apply(lxi, {nf, smt.apply(lin, {nf, pos_b})}), item_b.xi),
-                                                smt.eq(smt.apply(lyi, {nf, smt.apply(lin, {nf, pos_b})}), smt.sum{smt.apply(lye, {nf, smt.apply(lin, {nf, pos_a})}), vs})
-                                            })))))
-    end
-    
-    local n = smt.int(#items)
-    
-    smt.assert(self, smt.eq(smt.apply(lin, {nf, smt.int(1)}), smt.int(1)))
-    smt.assert(self, smt.eq(smt.apply(top, {nf, smt.int(1)}), items[1].yi))
-    smt.assert(self, smt.eq(smt.apply(bot, {nf, smt.int(1)}), items[1].ye))
-    smt.assert(self, smt.apply(first, {nf, smt.int(1)}))
-    smt.assert(self, smt.eq(smt.apply(lxc, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.sum{smt.apply(lxi, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.div(smt.apply(lxs, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.real(2))}))
-    smt.assert(self, smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.sum{smt.apply(lxi, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.apply(lxs, {nf, smt.apply(lin, {nf, smt.int(1)})})}))
-    smt.assert(self, smt.eq(smt.apply(lyc, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.sum{smt.apply(lyi, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.div(smt.apply(lys, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.real(2))}))
-    smt.assert(self, smt.eq(smt.apply(lye, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.sum{smt.apply(lyi, {nf, smt.apply(lin, {nf, smt.int(1)})}), smt.apply(lys, {nf, smt.apply(lin, {nf, smt.int(1)})})}))
-    if h_align == model.FLOW_ALIGN.LEFT then
-        smt.assert(self, smt.eq(smt.apply(lxi, {nf, smt.apply(lin, {nf, smt.int(1)})}), flow_canvas.xi))
-    elseif h_align == model.FLOW_ALIGN.CENTER then
-        smt.assert(self, smt.eq(smt.apply(lxc, {nf, smt.apply(lin, {nf, smt.int(1)})}), flow_canvas.xc))
-    elseif h_align == model.FLOW_ALIGN.RIGHT then
-        smt.assert(self, smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, smt.int(1)})}), flow_canvas.xe))
-    end
-    smt.assert(self, smt.eq(smt.apply(lxi, {nf, smt.apply(lin, {nf, smt.int(1)})}), items[1].xi))
-    
-    smt.assert(self, smt.ite(items[#items].oc,
-                            smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, n})}), items[#items].xe),
-                            smt.eq(smt.apply(lxe, {nf, smt.apply(lin, {nf, n})}), items[#items].xi)))
-    smt.assert(self, smt.eq(smt.apply(lyi, {nf, smt.apply(lin, {nf, n})}), smt.apply(top, {nf, n})))
-    smt.assert(self, smt.eq(smt.apply(lye, {nf, smt.apply(lin, {nf, n})}), smt.apply(bot, {nf, n})))
-    
-    smt.assert(self, smt.eq(smt.apply(lyc, {nf, smt.int(0)}), smt.sum{smt.apply(lyi, {nf, smt.int(0)}), smt.div(smt.apply(lys, {nf, smt.int(0)}), smt.real(2))}))
-    smt.assert(self, smt.eq(smt.apply(lye, {nf, smt.int(0)}), smt.sum{smt.apply(lyi, {nf, smt.int(0)}), smt.apply(lys, {nf, smt.int(0)})}))
-    if v_align == model.FLOW_ALIGN.TOP then
-        smt.assert(self, smt.eq(smt.apply(lyi, {nf, smt.int(0)}), flow_canvas.yi))
-    elseif v_align == model.FLOW_ALIGN.CENTER then
-        smt.assert(self, smt.eq(smt.apply(lyc, {nf, smt.int(0)}), flow_canvas.yc))
-    elseif v_align == model.FLOW_ALIGN.BOTTOM then
-        smt.assert(self, smt.eq(smt.apply(lye, {nf, smt.int(0)}), flow_canvas.ye))
     end
-    smt.assert(self, smt.eq(smt.apply(lyi, {nf, smt.int(0)}), smt.apply(lyi, {nf, smt.apply(lin, {nf, smt.int(1)})})))
-    smt.assert(self, smt.eq(smt.apply(lye, {nf, smt.int(0)}), smt.apply(lye, {nf, smt.apply(lin, {nf, n})})))
+    
+    self:assert_group(forms)
     
     return flow_canvas
 end
@@ -1188,6 +2974,7 @@ function model:distribute(items, axis, bord)
     end
     
     local comp = self:new_item()
+    local forms = {}
     
     local yi = {}
     local ye = {}
@@ -1207,33 +2994,35 @@ function model:distribute(items, axis, bord)
                         }
     
     if self.scenario == SCENARIO.ST then
-        smt.assert(self, smt.imp(comp.oc, exp))
+        forms[#forms + 1] = smt.imp(comp.oc, exp)
         
         -- comp exists only if some internal item exists
-        smt.assert(self, smt.iff(comp.oc, smt.land(oc)))
+        forms[#forms + 1] = smt.iff(comp.oc, smt.land(oc))
     else
-        smt.assert(self, exp)
+        forms[#forms + 1] = exp
     end
     
     
     -- create the distribute expression
-    local var = smt.constant(smt.REAL)
-    smt.assert(self, smt.gt(var, smt.real(0)))
+    local var = smt.constant(smt.REAL, comp.name .. '.d')
+    forms[#forms + 1] = smt.gt(var, smt.real(0))
     
     local exp = {}
     if bord ~= spatial.BORD.OUT then
         for i = 1, #items-1 do
             exp[#exp + 1] = smt.gt(items[i+1].xi, items[i].xe)
-            exp[#exp + 1] = smt.eq(items[i+1][field], smt.sum{items[i][field], var})
+            self:equate(items[i+1][field], items[i][field], var, exp)
         end
     else
         for i = 1, #items-1 do
             exp[#exp + 1] = smt.gt(items[i+1].xi, items[i].xe)
-            exp[#exp + 1] = smt.eq(items[i+1][field .. 'i'], smt.sum{items[i][field .. 'e'], var})
+            self:equate(items[i+1][field .. 'i'], items[i][field .. 'e'], var, exp)
         end
     end
     
-    smt.assert(self, smt.land(exp))
+    forms[#forms + 1] = #exp > 1 and smt.land(exp) or exp[1]
+    
+    self:assert_group(forms)
     
     return comp, var
 end
@@ -1257,17 +3046,22 @@ function model:inside(item1, item2)
     assert(typeof(item1) == 'item', 'Wrong type for argument item1.')
     assert(typeof(item2) == 'item', 'Wrong type for argument item2.')
     
+    local forms = {}
     if self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST then
-        smt.assert(self, smt.ge(item1.ti, item2.ti))
-        smt.assert(self, smt.le(item1.te, item2.te))
+        forms[#forms + 1] = smt.ge(item1.ti, item2.ti)
+        forms[#forms + 1] = smt.le(item1.te, item2.te)
+        self:difference(item1.ti, item2.ti, 0)
+        self:difference(item2.te, item1.te, 0)
     end
     
     if self.scenario == SCENARIO.S or self.scenario == SCENARIO.ST then
-        smt.assert(self, smt.ge(item1.xi, item2.xi))
-        smt.assert(self, smt.le(item1.xe, item2.xe))
-        smt.assert(self, smt.ge(item1.yi, item2.yi))
-        smt.assert(self, smt.le(item1.ye, item2.ye))
+        forms[#forms + 1] = smt.ge(item1.xi, item2.xi)
+        forms[#forms + 1] = smt.le(item1.xe, item2.xe)
+        forms[#forms + 1] = smt.ge(item1.yi, item2.yi)
+        forms[#forms + 1] = smt.le(item1.ye, item2.ye)
     end
+    
+    self:assert_group(forms)
 end
 
 
@@ -1287,14 +3081,14 @@ function model:setTime(value)
     assert(self.scenario ~= SCENARIO.S, "The model scenario must be either T or ST.")
     assert(type(value) == 'number', 'Wrong type for argument value.')
     
-    smt.assert(self, smt.eq(self.T, smt.real(value)))
+    self:assert_group{smt.eq(self.T, smt.real(value))}
 end
 
 
 ---------------------------------------------------------------------
 -- Sets the value of variable T and checking the context. The value
--- of T is asserted inside a backtracking point, so that other values
--- of T can be used in sequential calls to this function. It also
+-- of T is only assumed during the check, so that other values of T
+-- can be used in sequential calls to this function. It also
 -- evaluates the positioning attrubutes for each item that is being
 -- presented in time T.
 -- 
@@ -1306,25 +3100,25 @@ end
 --  * there is not a context;
 --  * the `scenario` is not `T` or `ST`;
 --  * one of the argument's type is not correct;
+--  * the document `features` do not include `incremental`;
 --  * an error occurs while asserting realtion info.
 function model:checkInTime(value, items)
     assert(self.context, 'You must initiate the document first.')
     assert(self.scenario ~= SCENARIO.S, "The model scenario must be either T or ST.")
     assert(type(value) == 'number', 'Wrong type for argument value.')
     assert(type(items) == 'table', 'Wrong type for argument items.')
+    assert(uses(self, 'incremental'), 'The document features do not include incremental.')
     
-    smt.mark_backtrack(self)
-    smt.assert(self, smt.eq(self.T, smt.real(value)))
-    self:check()
+    self:check_assuming{smt.eq(self.T, smt.real(value))}
     for _,item in ipairs(items) do
-        if smt.eval(self, item.oc, smt.BOOL) then
+        if evaluate(self, item.oc, smt.BOOL) then
             item.eval = true
-            smt.eval(self, item.xi, smt.REAL)
-            smt.eval(self, item.xe, smt.REAL)
-            smt.eval(self, item.xs, smt.REAL)
-            smt.eval(self, item.yi, smt.REAL)
-            smt.eval(self, item.ye, smt.REAL)
-            smt.eval(self, item.ys, smt.REAL)
+            evaluate(self, item.xi, smt.REAL)
+            evaluate(self, item.xe, smt.REAL)
+            evaluate(self, item.xs, smt.REAL)
+            evaluate(self, item.yi, smt.REAL)
+            evaluate(self, item.ye, smt.REAL)
+            evaluate(self, item.ys, smt.REAL)
         else
             item.eval = false
             item.xi.value = nil
@@ -1335,7 +3129,528 @@ function model:checkInTime(value, items)
             item.ys.value = nil
         end
     end
-    smt.backtrack(self)
+end
+
+
+---------------------------------------------------------------------
+-- Computes the layouts of a list of items along an interval of time.
+-- 
+-- The temporal model is solved once, and its times are kept for the
+-- whole timeline. The values of `T` at which one of the `items`
+-- begins or ends (or a pause, an animation or a value `set`) are the
+-- critical instants, between which the visible `items` do not change.
+-- The spatial layout is solved once for each interval between two
+-- critical instants, assuming `T` at its middle. The positions of
+-- animated items are the ones at that time. The items not listed do
+-- not give instants, so the layout of an interval holds only while
+-- their visibility does not change in it.
+-- 
+-- @tparam table items Items to have their positions evaluated.
+-- @tparam table options Fields `from` and `to` bound the timeline.
+-- They default to the beginning and the end of the canvas.
+-- 
+-- @treturn table The intervals between critical instants, in order.
+-- Each has fields `ti` and `te`, the interval bounds, and `items`,
+-- holding the positions (fields `xi`, `xe`, `xs`, `yi`, `ye` and
+-- `ys`) of the items visible in the interval, indexed by item. `nil`
+-- if the document is unsat.
+-- @treturn string Status when the result is unknown.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is not a context;
+--  * the `scenario` is not `ST`;
+--  * one of the argument's type is not correct;
+--  * the document `features` do not include `incremental`;
+--  * the times of the temporal model can not be kept (their values
+--  being rounded);
+--  * an error occurs while checking the context or evaluating values.
+-- 
+-- @usage
+-- for _, step in ipairs(m:timeline({f1, f2}, {from = 0, to = 60})) do
+--     print(step.ti, step.te, step.items[f1] and step.items[f1].xi)
+-- end
+function model:timeline(items, options)
+    assert(self.context, 'You must initiate the document first.')
+    assert(self.scenario == SCENARIO.ST, "The model scenario must be ST.")
+    assert(type(items) == 'table', 'Wrong type for argument items.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
+    assert(uses(self, 'incremental'), 'The document features do not include incremental.')
+    
+    local options = options or {}
+    local sat, status = check(self, nil)
+    if not sat then
+        return nil, status
+    end
+    
+    -- the times of the temporal model, kept as assumptions
+    local terms, types = {}, {}
+    local function add(term, type)
+        terms[#terms + 1] = term
+        types[#types + 1] = type
+    end
+    add(self.canvas.ti, smt.REAL)
+    add(self.canvas.te, smt.REAL)
+    for _, i in ipairs(items) do
+        assert(typeof(i) == 'item', 'Wrong type for argument items.')
+        for _, p in ipairs{i, unpack(i.i_pause)} do
+            add(p.pl, smt.BOOL)
+            add(p.ti, smt.REAL)
+            add(p.te, smt.REAL)
+        end
+    end
+    for _, t in ipairs(self.boundaries or {}) do
+        add(t, smt.REAL)
+    end
+    evaluate_all(self, terms, types)
+    
+    local literals = {}
+    local from = options.from or self.canvas.ti.value
+    local to = options.to or self.canvas.te.value
+    local instants = {from, to}
+    for k, term in ipairs(terms) do
+        if types[k] == smt.BOOL then
+            literals[#literals + 1] = term.value and term or smt.lnot(term)
+        else
+            literals[#literals + 1] = smt.eq(term, smt.real(term.value))
+            if term.value > from and term.value < to then
+                instants[#instants + 1] = term.value
+            end
+        end
+    end
+    table.sort(instants)
+    
+    -- times rounded by Lua may not hold together
+    sat, status = check(self, literals)
+    if sat == false then
+        error('The times of the temporal model can not be kept.')
+    elseif not sat then
+        return nil, status
+    end
+    
+    -- the spatial terms of the items
+    terms, types = {}, {}
+    for _, i in ipairs(items) do
+        add(i.oc, smt.BOOL)
+        for _, f in ipairs{'xi', 'xe', 'xs', 'yi', 'ye', 'ys'} do
+            add(i[f], smt.REAL)
+        end
+    end
+    
+    local timeline = {}
+    for k = 2, #instants do
+        local ti, te = instants[k - 1], instants[k]
+        if te > ti then
+            local at = smt.eq(self.T, smt.real((ti + te) / 2))
+            literals[#literals + 1] = at
+            sat, status = check(self, literals)
+            literals[#literals] = nil
+            if not sat then
+                return nil, status
+            end
+            
+            evaluate_all(self, terms, types)
+            local step = {ti = ti, te = te, items = {}}
+            for _, i in ipairs(items) do
+                if i.oc.value then
+                    step.items[i] = {xi = i.xi.value, xe = i.xe.value, xs = i.xs.value,
+                                     yi = i.yi.value, ye = i.ye.value, ys = i.ys.value}
+                end
+            end
+            timeline[#timeline + 1] = step
+        end
+    end
+    
+    return timeline
+end
+
+
+---------------------------------------------------------------------
+-- Samples the polynomial animations of the document at a list of
+-- times, without the solver.
+-- 
+-- The times at which the animations begin and end are taken from the
+-- current model, so the document must be checked first. The values
+-- are then plain polynomials, evaluated for all the times at once
+-- (see `smt.sample`). Outside of an animation that does not set the
+-- value before or after it, the value of the variable in the current
+-- model is kept. Several animations of a variable are combined, each
+-- one giving the values inside of it.
+-- 
+-- @tparam table times List of times (e.g. the frames to be shown).
+-- 
+-- @treturn table Lists with the values of each animated variable at
+-- the times, indexed by the variable (e.g. `item.xi`).
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is not a model for the context;
+--  * `times` is not a table;
+--  * an error occurs while evaluating the values.
+-- 
+-- @usage
+-- m:check()
+-- local frames = {}
+-- for i = 1, 600 do frames[i] = i / 60 end
+-- local left = m:sample(frames)[video.xi]
+function model:sample(times)
+    assert(self.model, 'There is no model for the document.')
+    assert(type(times) == 'table', 'Wrong type for argument times.')
+    
+    local animations = self.animations or {}
+    local terms, types = {}, {}
+    for _, a in ipairs(animations) do
+        terms[#terms + 1] = a.ti
+        terms[#terms + 1] = a.te
+        terms[#terms + 1] = a.var
+        types[#types + 1] = smt.REAL
+        types[#types + 1] = smt.REAL
+        types[#types + 1] = smt.REAL
+    end
+    evaluate_all(self, terms, types)
+    
+    local pieces = {}
+    for i, a in ipairs(animations) do
+        local c, ti, te = a.coef, a.ti.value, a.te.value
+        
+        -- the value after the animation is the polynomial at its end
+        local after = 0
+        for k = #c, 1, -1 do
+            after = after * te + c[k]
+        end
+        pieces[i] = {coef = c, ti = ti, te = te, value = a.var.value,
+                     before = a.before and c[1] or nil, after = a.after and after or nil}
+    end
+    local values = smt.sample(pieces, times)
+    
+    local result = {}
+    for i, a in ipairs(animations) do
+        local v = result[a.var]
+        if not v then
+            result[a.var] = values[i]
+        else
+            local p = pieces[i]
+            for j, t in ipairs(times) do
+                if (t >= p.ti and t <= p.te) or (t < p.ti and p.before) or (t > p.te and p.after) then
+                    v[j] = values[i][j]
+                end
+            end
+        end
+    end
+    
+    return result
+end
+
+
+---------------------------------------------------------------------
+-- Finds a minimal set of builder calls in conflict, for a `tracked`
+-- model whose check is unsat. The calls are searched by QuickXplain
+-- over the selectors of their formulas, assumed in checks of the
+-- same context, so the document is not built again. Removing any
+-- of the calls found makes the rest of them consistent.
+-- 
+-- The formulas asserted out of the builders (as the equalities
+-- eliminated before tracking) always hold.
+-- 
+-- @tparam table options Options of the checks (see `model:check`).
+-- 
+-- @treturn table The calls in conflict (see `model:assert_group`),
+-- each one with fields `builder`, `where` and `literal`. Empty if
+-- the formulas not tracked are unsat by themselves and `nil` if the
+-- document is sat.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is not a context;
+--  * the model is not `tracked`;
+--  * the document `features` do not include `incremental`;
+--  * `options` is not a table;
+--  * the result of a check is unknown or interrupted.
+-- 
+-- @usage
+-- if not m:check() then
+--     for _, call in ipairs(m:explain()) do
+--         print(call.where, call.builder)
+--     end
+-- end
+function model:explain(options)
+    assert(self.context, 'You must initiate the document first.')
+    assert(self.tracked, 'The model is not tracked.')
+    assert(uses(self, 'incremental'), 'The document features do not include incremental.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
+    
+    local function consistent(groups)
+        local literals = {}
+        for i, g in ipairs(groups) do
+            literals[i] = g.literal
+        end
+        local sat, status = smt.check_with_assumptions(self, literals, options)
+        assert(sat ~= nil, 'The search was ' .. tostring(status) .. '.')
+        return sat
+    end
+    local function union(a, b)
+        local u = {}
+        for _, g in ipairs(a) do
+            u[#u + 1] = g
+        end
+        for _, g in ipairs(b) do
+            u[#u + 1] = g
+        end
+        return u
+    end
+    
+    -- the conflict in `groups`, given the ones in `background`
+    local function quickxplain(background, added, groups)
+        if added and not consistent(background) then
+            return {}
+        elseif #groups == 1 then
+            return groups
+        end
+        
+        local half = math.floor(#groups / 2)
+        local first, second = {}, {}
+        for i, g in ipairs(groups) do
+            if i <= half then
+                first[#first + 1] = g
+            else
+                second[#second + 1] = g
+            end
+        end
+        
+        local d2 = quickxplain(union(background, first), true, second)
+        local d1 = quickxplain(union(background, d2), #d2 > 0, first)
+        return union(d1, d2)
+    end
+    
+    local groups = self.selectors or {}
+    if consistent(groups) then
+        return nil
+    elseif #groups == 0 or not consistent({}) then
+        return {}
+    end
+    return quickxplain({}, false, groups)
+end
+
+
+---------------------------------------------------------------------
+-- Finds a model of the document with the best value for an
+-- objective (e.g. the whitespace or the distance to preferred
+-- positions), whose value is tightened by bounds assumed in checks
+-- of the same context, so what the solver learned is kept between
+-- the checks.
+-- 
+-- The first check gives a feasible value. The bound is then moved
+-- away from it in doubling steps until a check is unsat, and the
+-- search goes on by bisection between the feasible and the
+-- infeasible bounds, until they are within `tolerance`. Each check
+-- that is sat moves the feasible bound to the value of its model.
+-- The bounds are only assumed, so no backtracking point is needed
+-- and the context is left as it was. The best model found, the one
+-- of the last check that was sat, is the model of the document
+-- afterwards, also if the time limit passes, and its values are
+-- evaluated without the layout cache. The bound is doubled at most
+-- `steps` times, after which the objective is taken as unbounded.
+--
+-- The time limit is measured by `smt.clock`.
+-- 
+-- @tparam term objective Arithmetic term to be optimized.
+-- @tparam table options Options of the search: `minimize` (`true`)
+-- or maximize, `tolerance` (`1`, greater than zero), `steps` (`64`),
+-- the number of doubling steps, and `timeout_ms`, the time limit of
+-- the whole search. The other fields are search parameters of the
+-- checks (see `model:check`).
+-- 
+-- @treturn number The value of the objective in the best model, `nil`
+-- if the document is unsat or its first check is not decided.
+-- @treturn string When `nil` is returned for a check not decided,
+-- `'interrupted'` or `'unknown'`. `'unbounded'` with the best value
+-- if the doubling steps ran out.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is not a context;
+--  * the document `features` do not include `incremental`;
+--  * one of the argument's type is not correct;
+--  * `tolerance` is not greater than zero;
+--  * an error occurs while checking the context or evaluating values.
+-- 
+-- @usage
+-- local gap = smt.sub(item2.xi, item1.xe)
+-- m:optimize(gap, {minimize = true, tolerance = 0.5, timeout_ms = 200})
+function model:optimize(objective, options)
+    assert(self.context, 'You must initiate the document first.')
+    assert(typeof(objective) == 'term', 'Wrong type for argument objective.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
+    assert(uses(self, 'incremental'), 'The document features do not include incremental.')
+    
+    local sign = (not options or options.minimize ~= false) and 1 or -1
+    local tolerance = options and options.tolerance or 1
+    local steps = options and options.steps or 64
+    assert(type(tolerance) == 'number' and tolerance > 0, 'The tolerance must be greater than zero.')
+    assert(type(steps) == 'number', 'Wrong type for argument options.')
+    local deadline = options and options.timeout_ms and smt.clock() + options.timeout_ms / 1000
+    local search = {}
+    for k, v in pairs(options or {}) do
+        if k ~= 'minimize' and k ~= 'tolerance' and k ~= 'steps' and k ~= 'timeout_ms' then
+            search[k] = v
+        end
+    end
+    
+    -- checks the document with the objective bounded by `bound`
+    local function probe(bound)
+        if deadline then
+            search.timeout_ms = math.floor((deadline - smt.clock()) * 1000)
+            if search.timeout_ms <= 0 then
+                return nil, 'interrupted'
+            end
+        end
+        
+        local literals
+        if bound then
+            literals = {sign > 0 and smt.le(objective, smt.real(bound)) or smt.ge(objective, smt.real(-bound))}
+        end
+        local sat, status = solve(self, literals, search)
+        if sat then
+            return sign * smt.eval(self, objective, smt.REAL)
+        end
+        return sat, status
+    end
+    
+    local best, status = probe(nil)
+    if not best then
+        return nil, status
+    end
+    
+    local infeasible = -math.huge
+    local step = math.max(tolerance, math.abs(best))
+    while best - infeasible > tolerance do
+        local bound
+        if infeasible == -math.huge then
+            -- an unbounded objective
+            if steps == 0 then
+                status = 'unbounded'
+                break
+            end
+            bound = best - step
+            step = step * 2
+            steps = steps - 1
+        else
+            bound = (best + infeasible) / 2
+        end
+        
+        -- the bound overflows or the bounds are adjacent numbers
+        if math.abs(bound) == math.huge or bound == best or bound == infeasible then
+            break
+        end
+        
+        local value = probe(bound)
+        if value then
+            best = value
+        elseif value == false then
+            infeasible = bound
+        else
+            break
+        end
+    end
+    
+    -- the checks that are not sat keep the model of the solver
+    self.model = true
+    self.layout = nil
+    self.solved = nil
+    
+    return sign * best, status
+end
+
+
+---------------------------------------------------------------------
+-- Enumerates distinct layouts of a list of items, in the same
+-- context. Each layout is evaluated as by `model:eval_all`, and the
+-- next checks assume a formula blocking it: some item must change
+-- its presence or visibility, or move its init (`ti`, `xi` or `yi`)
+-- by at least `distance`. The blocking formulas are only assumed,
+-- so the context is left as it was.
+-- 
+-- @tparam table items Items whose layouts must differ.
+-- @tparam number k Maximum number of layouts.
+-- @tparam table options Field `distance` is the least change of an
+-- init between layouts (`1`). The other fields are options of the
+-- checks (see `model:check`).
+-- 
+-- @treturn function Iterator giving the number of each layout, while
+-- there is one.
+-- 
+-- @raise Error if one of the following occurs:
+--
+--  * there is not a context;
+--  * the document `features` do not include `incremental`;
+--  * one of the argument's type is not correct;
+--  * an error occurs while checking the context or evaluating values.
+-- 
+-- @usage
+-- for i in m:enumerate({f1, f2}, 3, {distance = 10}) do
+--     print(i, f1.xi.value, f2.xi.value)
+-- end
+function model:enumerate(items, k, options)
+    assert(self.context, 'You must initiate the document first.')
+    assert(type(items) == 'table', 'Wrong type for argument items.')
+    assert(type(k) == 'number', 'Wrong type for argument k.')
+    assert(not options or type(options) == 'table', 'Wrong type for argument options.')
+    assert(uses(self, 'incremental'), 'The document features do not include incremental.')
+    
+    local distance = options and options.distance or 1
+    local search
+    for key, v in pairs(options or {}) do
+        if key ~= 'distance' then
+            search = search or {}
+            search[key] = v
+        end
+    end
+    
+    local temporal = self.scenario == SCENARIO.T or self.scenario == SCENARIO.ST
+    local literals = {}
+    local count = 0
+    
+    -- the item init moved by at least `distance`
+    local function moved(term)
+        return smt.lor{smt.le(term, smt.real(term.value - distance)),
+                       smt.ge(term, smt.real(term.value + distance))}
+    end
+    
+    return function ()
+        if count >= k or not check(self, literals, search) then
+            return nil
+        end
+        count = count + 1
+        self:eval_all(items)
+        
+        local changes = {}
+        for _, i in ipairs(items) do
+            local shown = true
+            if temporal then
+                shown = i.pl.value
+                changes[#changes + 1] = shown and smt.lnot(i.pl) or i.pl
+                if shown then
+                    changes[#changes + 1] = moved(i.ti)
+                end
+            end
+            -- the visibility of an item not playing is not evaluated
+            if self.scenario == SCENARIO.ST and shown then
+                shown = i.oc.value
+                changes[#changes + 1] = shown and smt.lnot(i.oc) or i.oc
+            end
+            if shown and self.scenario ~= SCENARIO.T then
+                changes[#changes + 1] = moved(i.xi)
+                changes[#changes + 1] = moved(i.yi)
+            end
+        end
+        
+        if #changes == 0 then
+            count = k
+        else
+            literals[#literals + 1] = join(smt.lor, changes)
+        end
+        return count
+    end
 end
 
 
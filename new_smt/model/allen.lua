@@ -11,6 +11,30 @@ local smt = require('lib.smt')
 local allen = {}
 
 
+---------------------------------------------------------------------
+-- Lists the differences (see `model:difference`) of the conjunction
+-- of a relation: `{a, 'eq', b, d}` for `a = b + d` and `{a, 'lt', b}`
+-- for `a < b`.
+-- 
+-- @tparam table atoms The atoms of the conjunction.
+-- 
+-- @treturn table List of differences `{a, b, d, strict}`, stating
+-- `a >= b + d`, or `a > b + d` if `strict`.
+local function differences(atoms)
+    local list = {}
+    for _, atom in ipairs(atoms) do
+        local a, op, b, d = atom[1], atom[2], atom[3], atom[4] or 0
+        if op == 'eq' then
+            list[#list + 1] = {a, b, d}
+            list[#list + 1] = {b, a, -d}
+        else
+            list[#list + 1] = {b, a, 0, true}
+        end
+    end
+    return list
+end
+
+
 ---------------------------------------------------------------------
 -- Creates expression representing relation **before** between
 -- item intervals.
@@ -26,6 +50,8 @@ local allen = {}
 -- intervals.
 -- @treturn scenario The type of the relation. It is either
 -- `SCENARIO.T` or `SCENARIO.S`.
+-- @treturn table The differences stated by the relation (see
+-- `model:difference`).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -37,9 +63,11 @@ function allen.before(item1, item2, d)
     assert(not d or type(d) == 'number', 'Wrong type for argument d.')
     
     if d then
-        return smt.eq(smt.sum{item1.te, smt.real(d)}, item2.ti), SCENARIO.T
+        return smt.compile{'eq', {'sum', item1.te, d}, item2.ti}, SCENARIO.T,
+            differences{{item2.ti, 'eq', item1.te, d}}
     else
-        return smt.lt(item1.te, item2.ti), SCENARIO.T
+        return smt.lt(item1.te, item2.ti), SCENARIO.T,
+            differences{{item1.te, 'lt', item2.ti}}
     end
 end
 
@@ -55,6 +83,8 @@ end
 -- intervals.
 -- @treturn scenario The type of the relation. It is either
 -- `SCENARIO.T` or `SCENARIO.S`.
+-- @treturn table The differences stated by the relation (see
+-- `model:difference`).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -64,7 +94,8 @@ function allen.meets(item1, item2)
     assert(typeof(item1) == 'item', 'Wrong type for argument item1.')
     assert(typeof(item2) == 'item', 'Wrong type for argument item2.')
     
-    return smt.eq(item1.te, item2.ti), SCENARIO.T
+    return smt.eq(item1.te, item2.ti), SCENARIO.T,
+        differences{{item2.ti, 'eq', item1.te}}
 end
 
 
@@ -84,6 +115,8 @@ end
 -- intervals.
 -- @treturn scenario The type of the relation. It is either
 -- `SCENARIO.T` or `SCENARIO.S`.
+-- @treturn table The differences stated by the relation (see
+-- `model:difference`).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -94,17 +127,20 @@ function allen.overlaps(item1, item2, d)
     assert(typeof(item2) == 'item', 'Wrong type for argument item2.')
     assert(not d or type(d) == 'number', 'Wrong type for argument d.')
     
-    local exp
+    local exp, atom
     if d then
-        exp = smt.eq(item2.ti, smt.sum{item1.ti, smt.real(d)})
+        exp = {'eq', item2.ti, {'sum', item1.ti, d}}
+        atom = {item2.ti, 'eq', item1.ti, d}
     else
-        exp = smt.lt(item1.te, item2.ti)
+        exp = {'lt', item1.te, item2.ti}
+        atom = {item1.te, 'lt', item2.ti}
     end
     
-    return smt.land{
-                smt.lt(item1.ti, item2.ti),
+    return smt.compile{'and',
+                {'lt', item1.ti, item2.ti},
                 exp,
-                smt.lt(item1.te, item2.te)}, SCENARIO.T
+                {'lt', item1.te, item2.te}}, SCENARIO.T,
+        differences{{item1.ti, 'lt', item2.ti}, atom, {item1.te, 'lt', item2.te}}
 end
 
 
@@ -119,6 +155,8 @@ end
 -- intervals.
 -- @treturn scenario The type of the relation. It is either
 -- `SCENARIO.T` or `SCENARIO.S`.
+-- @treturn table The differences stated by the relation (see
+-- `model:difference`).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -128,10 +166,10 @@ function allen.starts(item1, item2)
     assert(typeof(item1) == 'item', 'Wrong type for argument item1.')
     assert(typeof(item2) == 'item', 'Wrong type for argument item2.')
     
-    return smt.land{
-                smt.eq(item1.ti, item2.ti),
-                exp,
-                smt.lt(item1.te, item2.te)}, SCENARIO.T
+    return smt.compile{'and',
+                {'eq', item1.ti, item2.ti},
+                {'lt', item1.te, item2.te}}, SCENARIO.T,
+        differences{{item1.ti, 'eq', item2.ti}, {item1.te, 'lt', item2.te}}
 end
 
 
@@ -151,6 +189,8 @@ end
 -- intervals.
 -- @treturn scenario The type of the relation. It is either
 -- `SCENARIO.T` or `SCENARIO.S`.
+-- @treturn table The differences stated by the relation (see
+-- `model:difference`).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -161,16 +201,19 @@ function allen.during(item1, item2, d)
     assert(typeof(item2) == 'item', 'Wrong type for argument item2.')
     assert(not d or type(d) == 'number', 'Wrong type for argument d.')
     
-    local exp
+    local exp, atom
     if d then
-        exp = smt.eq(item1.ti, smt.sum{item2.ti, smt.real(d)})
+        exp = {'eq', item1.ti, {'sum', item2.ti, d}}
+        atom = {item1.ti, 'eq', item2.ti, d}
     else
-        exp = smt.lt(item1.ti, item2.ti)
+        exp = {'lt', item1.ti, item2.ti}
+        atom = {item1.ti, 'lt', item2.ti}
     end
     
-    return smt.land{
+    return smt.compile{'and',
                 exp,
-                smt.lt(item1.te, item2.te)}, SCENARIO.T
+                {'lt', item1.te, item2.te}}, SCENARIO.T,
+        differences{atom, {item1.te, 'lt', item2.te}}
 end
 
 
@@ -185,6 +228,8 @@ end
 -- intervals.
 -- @treturn scenario The type of the relation. It is either
 -- `SCENARIO.T` or `SCENARIO.S`.
+-- @treturn table The differences stated by the relation (see
+-- `model:difference`).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -194,10 +239,10 @@ function allen.finishes(item1, item2)
     assert(typeof(item1) == 'item', 'Wrong type for argument item1.')
     assert(typeof(item2) == 'item', 'Wrong type for argument item2.')
     
-    return smt.land{
-                smt.gt(item1.ti, item2.ti),
-                exp,
-                smt.eq(item1.te, item2.te)}, SCENARIO.T
+    return smt.compile{'and',
+                {'gt', item1.ti, item2.ti},
+                {'eq', item1.te, item2.te}}, SCENARIO.T,
+        differences{{item2.ti, 'lt', item1.ti}, {item1.te, 'eq', item2.te}}
 end
 
 
@@ -212,6 +257,8 @@ end
 -- intervals.
 -- @treturn scenario The type of the relation. It is either
 -- `SCENARIO.T` or `SCENARIO.S`.
+-- @treturn table The differences stated by the relation (see
+-- `model:difference`).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -221,9 +268,10 @@ function allen.equals(item1, item2)
     assert(typeof(item1) == 'item', 'Wrong type for argument item1.')
     assert(typeof(item2) == 'item', 'Wrong type for argument item2.')
     
-    return smt.land{
-                smt.eq(item1.ti, item2.ti),
-                smt.eq(item1.te, item2.te)}, SCENARIO.T
+    return smt.compile{'and',
+                {'eq', item1.ti, item2.ti},
+                {'eq', item1.te, item2.te}}, SCENARIO.T,
+        differences{{item1.ti, 'eq', item2.ti}, {item1.te, 'eq', item2.te}}
 end
 
 
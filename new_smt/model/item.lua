@@ -112,78 +112,87 @@ function item:configure(cond_end, pausable, selectable)
     _t = typeof(selectable)
     assert(_t == 'nil' or _t == 'boolean', 'Wrong type for argument selectable.')
     
+    local forms = {}
     
     if self.model.scenario == SCENARIO.T or self.model.scenario == SCENARIO.ST then
-        self.ti = smt.constant(smt.REAL, self.name .. '.ti')
-        self.tc = smt.constant(smt.REAL, self.name .. '.tc')
-        self.te = smt.constant(smt.REAL, self.name .. '.te')
-        self.ts = smt.constant(smt.REAL, self.name .. '.ts')
+        self.ti, self.tc, self.te, self.ts = self.model:interval(self.name .. '.t', cond_end and self.t_size ~= self.model.INF, forms)
         self.pl = smt.constant(smt.BOOL, self.name .. '.pl')
         
-        self.model:config_interval(self.ti, self.tc, self.te, self.ts, cond_end and self.t_size ~= self.model.INF)
-        smt.assert(self.model, smt.ge(self.ti, self.model.canvas.ti))
-        smt.assert(self.model, smt.le(self.te, self.model.canvas.te))
+        forms[#forms + 1] = smt.ge(self.ti, self.model.canvas.ti)
+        forms[#forms + 1] = smt.le(self.te, self.model.canvas.te)
         
         if self.t_init then
-            smt.assert(self.model, smt.eq(self.ti, smt.real(self.t_init)))
+            forms[#forms + 1] = smt.eq(self.ti, smt.real(self.t_init))
         end
         if self.t_end then
-            smt.assert(self.model, smt.eq(self.te, smt.real(self.t_end)))
+            forms[#forms + 1] = smt.eq(self.te, smt.real(self.t_end))
+        end
+        
+        -- the same bounds in the temporal network of the model, the
+        -- pauses only making the item longer
+        local network = self.model
+        network:difference(self.ti, network.canvas.ti, 0)
+        network:difference(network.canvas.te, self.te, 0)
+        if cond_end or self.t_size == network.INF then
+            network:difference(self.te, self.ti, 0, true)
+        else
+            network:difference(self.te, self.ti, self.t_size)
+            if not pausable then
+                network:difference(self.ti, self.te, -self.t_size)
+            end
+        end
+        if self.t_init then
+            network:difference(self.ti, nil, self.t_init)
+            network:difference(nil, self.ti, -self.t_init)
+        end
+        if self.t_end then
+            network:difference(self.te, nil, self.t_end)
+            network:difference(nil, self.te, -self.t_end)
         end
     end
     
     if self.model.scenario == SCENARIO.ST then
         self.oc = smt.constant(smt.BOOL, self.name .. '.oc')
         
-        smt.assert(self.model,
-            smt.lor{
-                smt.land{
-                    self.pl,
-                    smt.ge(self.model.T, self.ti),
-                    smt.le(self.model.T, self.te),
-                    self.oc
+        forms[#forms + 1] = smt.lor{
+            smt.land{
+                self.pl,
+                smt.ge(self.model.T, self.ti),
+                smt.le(self.model.T, self.te),
+                self.oc
+            },
+            smt.land{
+                smt.lor{
+                    smt.lnot(self.pl),
+                    smt.lt(self.model.T, self.ti),
+                    smt.gt(self.model.T, self.te)
                 },
-                smt.land{
-                    smt.lor{
-                        smt.lnot(self.pl),
-                        smt.lt(self.model.T, self.ti),
-                        smt.gt(self.model.T, self.te)
-                    },
-                    smt.lnot(self.oc)
-                }
-            })
+                smt.lnot(self.oc)
+            }
+        }
     end
     
     if self.model.scenario == SCENARIO.S or self.model.scenario == SCENARIO.ST then
-        self.xi = smt.constant(smt.REAL, self.name .. '.xi')
-        self.xc = smt.constant(smt.REAL, self.name .. '.xc')
-        self.xe = smt.constant(smt.REAL, self.name .. '.xe')
-        self.xs = smt.constant(smt.REAL, self.name .. '.xs')
-        self.yi = smt.constant(smt.REAL, self.name .. '.yi')
-        self.yc = smt.constant(smt.REAL, self.name .. '.yc')
-        self.ye = smt.constant(smt.REAL, self.name .. '.ye')
-        self.ys = smt.constant(smt.REAL, self.name .. '.ys')
-        
-        self.model:config_interval(self.xi, self.xc, self.xe, self.xs)
-        self.model:config_interval(self.yi, self.yc, self.ye, self.ys)
+        self.xi, self.xc, self.xe, self.xs = self.model:interval(self.name .. '.x', nil, forms)
+        self.yi, self.yc, self.ye, self.ys = self.model:interval(self.name .. '.y', nil, forms)
         
         if self.x_size then
-            smt.assert(self.model, smt.eq(self.xs, smt.real(self.x_size)))
+            self.model:equate(self.xs, self.x_size, nil, forms)
         end
         if self.x_init then
-            smt.assert(self.model, smt.eq(self.xi, smt.real(self.x_init)))
+            self.model:equate(self.xi, self.x_init, nil, forms)
         end
         if self.x_end then
-            smt.assert(self.model, smt.eq(self.xe, smt.real(self.x_end)))
+            self.model:equate(self.xe, self.x_end, nil, forms)
         end
         if self.y_size then
-            smt.assert(self.model, smt.eq(self.ys, smt.real(self.y_size)))
+            self.model:equate(self.ys, self.y_size, nil, forms)
         end
         if self.y_init then
-            smt.assert(self.model, smt.eq(self.yi, smt.real(self.y_init)))
+            self.model:equate(self.yi, self.y_init, nil, forms)
         end
         if self.y_end then
-            smt.assert(self.model, smt.eq(self.ye, smt.real(self.y_end)))
+            self.model:equate(self.ye, self.y_end, nil, forms)
         end
     end
     
@@ -196,27 +205,21 @@ function item:configure(cond_end, pausable, selectable)
                 local ip = item:new(self.model, self.name .. '_p' .. tostring(#self.i_pause + 1), {type = 'pause', t_size = self.model.INF})
                 self.i_pause[#self.i_pause + 1] = ip
                 
-                ip.ti = smt.constant(smt.REAL, ip.name .. '.ti')
-                ip.tc = smt.constant(smt.REAL, ip.name .. '.tc')
-                ip.te = smt.constant(smt.REAL, ip.name .. '.te')
-                ip.ts = smt.constant(smt.REAL, ip.name .. '.ts')
+                ip.ti, ip.tc, ip.te, ip.ts = self.model:interval(ip.name .. '.t', nil, forms)
                 ip.pl = smt.constant(smt.BOOL, ip.name .. '.pl')
                 
-                self.model:config_interval(ip.ti, ip.tc, ip.te, ip.ts)
-                smt.assert(self.model, smt.ge(ip.ti, self.ti))
-                smt.assert(self.model, smt.le(ip.te, self.te))
-                smt.assert(self.model,
-                    smt.lor{
-                        smt.land{ip.pl, smt.gt(ip.ts, smt.real(0))},
-                        smt.land{smt.lnot(ip.pl), smt.eq(ip.ts, smt.real(0))}
-                    })
+                forms[#forms + 1] = smt.ge(ip.ti, self.ti)
+                forms[#forms + 1] = smt.le(ip.te, self.te)
+                forms[#forms + 1] = smt.lor{
+                    smt.land{ip.pl, smt.gt(ip.ts, smt.real(0))},
+                    smt.land{smt.lnot(ip.pl), smt.eq(ip.ts, smt.real(0))}
+                }
                 
                 if i > 1 then
-                    smt.assert(self.model,
-                        smt.imp{
-                            ip.pl,
-                            smt.land{self.i_pause[i - 1].pl, allen.before(self.i_pause[i - 1], ip)}
-                        })
+                    forms[#forms + 1] = smt.imp{
+                        ip.pl,
+                        smt.land{self.i_pause[i - 1].pl, allen.before(self.i_pause[i - 1], ip)}
+                    }
                 end
                 
                 d[#d + 1] = ip.ts
@@ -225,15 +228,15 @@ function item:configure(cond_end, pausable, selectable)
             if self.t_size ~= self.model.INF then
                 d[#d + 1] = smt.real(self.t_size)
                 
-                smt.assert(self.model, smt.eq(self.ts, smt.sum(d)))
+                forms[#forms + 1] = smt.eq(self.ts, smt.sum(d))
             else
-                smt.assert(self.model, smt.gt(self.ts, smt.sum(d)))
+                forms[#forms + 1] = smt.gt(self.ts, smt.sum(d))
             end
         else
             if self.t_size ~= self.model.INF then
-                smt.assert(self.model, smt.eq(self.ts, smt.real(self.t_size)))
+                forms[#forms + 1] = smt.eq(self.ts, smt.real(self.t_size))
             else
-                smt.assert(self.model, smt.gt(self.ts, smt.real(0)))
+                forms[#forms + 1] = smt.gt(self.ts, smt.real(0))
             end
         end
         
@@ -246,17 +249,18 @@ function item:configure(cond_end, pausable, selectable)
                 is.ti = smt.constant(smt.REAL, is.name .. '.ti')
                 is.pl = smt.constant(smt.BOOL, is.name .. '.pl')
                 
-                smt.assert(self.model, smt.imp(is.pl, smt.between(self.ti, is.ti, self.te, true)))
+                forms[#forms + 1] = smt.imp(is.pl, smt.between(self.ti, is.ti, self.te, true))
                 if i > 1 then
-                    smt.assert(self.model,
-                        smt.imp{
-                            is.pl,
-                            smt.land{self.i_selec[i - 1].pl, smt.lt(self.i_selec[i - 1].ti, is.ti)}
-                        })
+                    forms[#forms + 1] = smt.imp{
+                        is.pl,
+                        smt.land{self.i_selec[i - 1].pl, smt.lt(self.i_selec[i - 1].ti, is.ti)}
+                    }
                 end
             end
         end
     end
+    
+    self.model:assert_group(forms)
 end
 
 
@@ -293,15 +297,29 @@ function item:anchor(anchor, t_init, t_end)
     assert(not t_init or type(t_init) == 'number', 'Wrong type for argument t_init.')
     assert(not t_end or type(t_end) == 'number', 'Wrong type for argument t_end.')
     
+    local forms = {}
     if t_init then
-        smt.assert(self.model, smt.eq(anchor.ti, smt.sum{self.ti, smt.real(t_init)}))
+        forms[#forms + 1] = smt.eq(anchor.ti, smt.sum{self.ti, smt.real(t_init)})
     else
-        smt.assert(self.model, smt.eq(anchor.ti, self.ti))
+        forms[#forms + 1] = smt.eq(anchor.ti, self.ti)
     end
     if t_end then
-        smt.assert(self.model, smt.eq(anchor.te, smt.sum{self.ti, smt.real(t_end)}))
+        forms[#forms + 1] = smt.eq(anchor.te, smt.sum{self.ti, smt.real(t_end)})
+    else
+        forms[#forms + 1] = smt.eq(anchor.te, self.te)
+    end
+    self.model:assert_group(forms)
+    
+    -- the same equalities in the temporal network of the model
+    local network = self.model
+    network:difference(anchor.ti, self.ti, t_init or 0)
+    network:difference(self.ti, anchor.ti, -(t_init or 0))
+    if t_end then
+        network:difference(anchor.te, self.ti, t_end)
+        network:difference(self.ti, anchor.te, -t_end)
     else
-        smt.assert(self.model, smt.eq(anchor.te, self.te))
+        network:difference(anchor.te, self.te, 0)
+        network:difference(self.te, anchor.te, 0)
     end
     
     self.anchors[#self.anchors + 1] = anchor
@@ -321,7 +339,7 @@ function item:place_anchors()
         np[#np + 1] = smt.lnot(a.pl)
     end
     
-    smt.assert(self.model, smt.lor{smt.land(p),smt.land(np)})
+    self.model:assert_group{smt.lor{smt.land(p),smt.land(np)}}
 end
 
 
@@ -1,6 +1,10 @@
 ---------------------------------------------------------------------
 -- Represent RCC relations.
 --
+-- The relations are simplified by the regions the items bound by
+-- their properties (`x_init`, `x_size`, `x_end`, `y_init`, `y_size`
+-- and `y_end`), so the solver only sees the cases that can hold.
+--
 -- @module model.rcc
 -- @author Joel dos Santos <joel@dossantos.cc>
 
@@ -11,6 +15,212 @@ local smt = require('lib.smt')
 local rcc = {}
 
 
+---------------------------------------------------------------------
+-- Widens a range computed from other values, unless it is exact.
+-- The solver compares the properties as exact rationals, so a bound
+-- Lua derives from them may be rounded to the other side of the
+-- value the solver sees (`0.1 + 0.9` is `1` in Lua). Only sums and
+-- differences of integers are computed exactly.
+-- 
+-- @tparam number lo Lower bound.
+-- @tparam number hi Upper bound.
+-- @tparam boolean exact Whether the bounds were computed from
+-- integers known exactly.
+-- 
+-- @treturn number Lower bound.
+-- @treturn number Upper bound.
+-- @treturn boolean Whether the bounds are exact.
+local function widen(lo, hi, exact)
+    if exact then
+        return lo, hi, true
+    end
+    return lo - 1e-9 * (1 + math.abs(lo)), hi + 1e-9 * (1 + math.abs(hi)), false
+end
+
+
+---------------------------------------------------------------------
+-- Checks whether the given values are integers.
+-- 
+-- @param ... Numbers.
+-- 
+-- @treturn boolean Whether all values are integers.
+local function integers(...)
+    for k = 1, select('#', ...) do
+        local v = select(k, ...)
+        if v % 1 ~= 0 then
+            return false
+        end
+    end
+    return true
+end
+
+
+---------------------------------------------------------------------
+-- Adds the ranges of the region terms of an item that follow from
+-- its `x_init`, `x_size`, `x_end`, `y_init`, `y_size` and `y_end`.
+-- The terms not bounded by the item are left out.
+-- 
+-- @tparam item item The item.
+-- @tparam table ranges Ranges (triples lower bound, upper bound and
+-- whether they are exact, see `widen`) indexed by the term indexes.
+local function region(item, ranges)
+    for _, axis in ipairs{'x', 'y'} do
+        local i, s, e = item[axis .. '_init'], item[axis .. '_size'], item[axis .. '_end']
+        local exact = integers(i or 0, s or 0, e or 0)
+        
+        if i then
+            ranges[item[axis .. 'i'].index] = {i, i, true}
+        end
+        if s then
+            ranges[item[axis .. 's'].index] = {s, s, true}
+        end
+        if e then
+            ranges[item[axis .. 'e'].index] = {e, e, true}
+        end
+        
+        -- two of them give the third and the center
+        if i and s and not e then
+            e = i + s
+            ranges[item[axis .. 'e'].index] = {widen(e, e, exact)}
+        elseif i and e and not s then
+            ranges[item[axis .. 's'].index] = {widen(e - i, e - i, exact)}
+        elseif s and e and not i then
+            i = e - s
+            ranges[item[axis .. 'i'].index] = {widen(i, i, exact)}
+        end
+        if i and e then
+            local c = (i + e) / 2
+            ranges[item[axis .. 'c'].index] = {widen(c, c, exact and c % 1 == 0)}
+        end
+    end
+end
+
+
+---------------------------------------------------------------------
+-- Gets the range of an operand of an expression of `smt.compile`.
+-- 
+-- @param v A number, a term or a `sum` or `sub` expression.
+-- @tparam table ranges Ranges indexed by the term indexes (see
+-- `region`).
+-- 
+-- @treturn number Lower bound (`-math.huge` if unbounded).
+-- @treturn number Upper bound (`math.huge` if unbounded).
+-- @treturn boolean Whether the bounds are exact.
+local function range(v, ranges)
+    if type(v) == 'number' then
+        return v, v, true
+    elseif typeof(v) == 'term' then
+        local r = ranges[v.index]
+        if r then
+            return r[1], r[2], r[3]
+        end
+    elseif v[1] == 'sub' then
+        local lo1, hi1, exact1 = range(v[2], ranges)
+        local lo2, hi2, exact2 = range(v[3], ranges)
+        return widen(lo1 - hi2, hi1 - lo2, exact1 and exact2 and integers(lo1, hi1, lo2, hi2))
+    elseif v[1] == 'sum' then
+        local lo, hi, exact = 0, 0, true
+        for k = 2, #v do
+            local l, h, e = range(v[k], ranges)
+            lo, hi, exact = lo + l, hi + h, exact and e and integers(l, h)
+        end
+        return widen(lo, hi, exact)
+    end
+    return -math.huge, math.huge, false
+end
+
+
+---------------------------------------------------------------------
+-- Simplifies an expression of `smt.compile` by the ranges of its
+-- terms. The comparisons decided by the ranges are replaced by their
+-- values, dropping the disjuncts that are geometrically impossible
+-- and the conjuncts that always hold.
+-- 
+-- @tparam table exp The expression.
+-- @tparam table ranges Ranges indexed by the term indexes (see
+-- `region`).
+-- 
+-- @return The simplified expression, `true` or `false`.
+local function prune(exp, ranges)
+    local op = exp[1]
+    
+    if op == 'and' or op == 'or' then
+        local decided = op == 'or'
+        local kept = {op}
+        for k = 2, #exp do
+            local p = prune(exp[k], ranges)
+            if p == decided then
+                return decided
+            elseif p ~= not decided then
+                kept[#kept + 1] = p
+            end
+        end
+        if #kept == 1 then
+            return not decided
+        elseif #kept == 2 then
+            return kept[2]
+        end
+        return kept
+    end
+    
+    local lo1, hi1 = range(exp[2], ranges)
+    local lo2, hi2 = range(exp[3], ranges)
+    if op == 'gt' or op == 'lt' then
+        if op == 'lt' then
+            lo1, hi1, lo2, hi2 = lo2, hi2, lo1, hi1
+        end
+        if lo1 > hi2 then
+            return true
+        elseif hi1 <= lo2 then
+            return false
+        end
+    elseif op == 'ge' or op == 'le' then
+        if op == 'le' then
+            lo1, hi1, lo2, hi2 = lo2, hi2, lo1, hi1
+        end
+        if lo1 >= hi2 then
+            return true
+        elseif hi1 < lo2 then
+            return false
+        end
+    elseif op == 'eq' then
+        if lo1 == hi1 and lo2 == hi2 and lo1 == lo2 then
+            return true
+        elseif hi1 < lo2 or hi2 < lo1 then
+            return false
+        end
+    end
+    return exp
+end
+
+
+---------------------------------------------------------------------
+-- Creates the term of a relation between item regions, simplified
+-- by the regions the items bound (see `prune`). Relations between
+-- items placed by their properties are decided before reaching the
+-- solver, and the others lose the case splits they cannot take.
+-- 
+-- @tparam item item1 The first item.
+-- @tparam item item2 The second item.
+-- @tparam table exp Expression of the relation.
+-- 
+-- @treturn term Term representing the relation, `smt.TRUE` or
+-- `smt.FALSE` if it was decided.
+local function compile(item1, item2, exp)
+    local ranges = {}
+    region(item1, ranges)
+    region(item2, ranges)
+    
+    local p = prune(exp, ranges)
+    if p == true then
+        return smt.TRUE
+    elseif p == false then
+        return smt.FALSE
+    end
+    return smt.compile(p)
+end
+
+
 ---------------------------------------------------------------------
 -- Creates expression for a given angle between item regions.
 -- 
@@ -26,7 +236,8 @@ local rcc = {}
 -- @tparam number dist Distance between regions centers.
 -- 
 -- @treturn table Table with parts of the expression among item
--- regions (expression must be used inside a `(and )` expression).
+-- regions, as expressions of `smt.compile` (they must be used inside
+-- an `and` expression).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -63,41 +274,41 @@ local function angle(item1, item2, angl, dist)
         end
     end
     
-    local cmax = smt.real(math.cos(math.rad(angl + delta)) * dist)
-    local cmin = smt.real(math.cos(math.rad(angl - delta)) * dist)
-    local smax = smt.real(math.sin(math.rad(angl + delta)) * dist)
-    local smin = smt.real(math.sin(math.rad(angl - delta)) * dist)
+    local cmax = math.cos(math.rad(angl + delta)) * dist
+    local cmin = math.cos(math.rad(angl - delta)) * dist
+    local smax = math.sin(math.rad(angl + delta)) * dist
+    local smin = math.sin(math.rad(angl - delta)) * dist
     
-    local dx = smt.sub(item1.xc, item2.xc)
-    local dy = smt.sub(item2.yc, item1.yc)
+    local dx = {'sub', item1.xc, item2.xc}
+    local dy = {'sub', item2.yc, item1.yc}
     local exp = {}
     
     if cmin < cmax then
-        exp[#exp + 1] = smt.ge(dx, cmin)
-        exp[#exp + 1] = smt.le(dx, cmax)
+        exp[#exp + 1] = {'ge', dx, cmin}
+        exp[#exp + 1] = {'le', dx, cmax}
     elseif cmax < cmin then
-        exp[#exp + 1] = smt.ge(dx, cmax)
-        exp[#exp + 1] = smt.le(dx, cmin)
+        exp[#exp + 1] = {'ge', dx, cmax}
+        exp[#exp + 1] = {'le', dx, cmin}
     elseif cmax > 0 then
-        exp[#exp + 1] = smt.ge(dx, cmin)
-        exp[#exp + 1] = smt.le(dx, dist)
+        exp[#exp + 1] = {'ge', dx, cmin}
+        exp[#exp + 1] = {'le', dx, dist}
     else
-        exp[#exp + 1] = smt.ge(dx, smt.neg(dist))
-        exp[#exp + 1] = smt.le(dx, cmax)
+        exp[#exp + 1] = {'ge', dx, -dist}
+        exp[#exp + 1] = {'le', dx, cmax}
     end
     
     if smin < smax then
-        exp[#exp + 1] = smt.ge(dy, smin)
-        exp[#exp + 1] = smt.le(dy, smax)
+        exp[#exp + 1] = {'ge', dy, smin}
+        exp[#exp + 1] = {'le', dy, smax}
     elseif smax < smin then
-        exp[#exp + 1] = smt.ge(dy, smax)
-        exp[#exp + 1] = smt.le(dy, smin)
+        exp[#exp + 1] = {'ge', dy, smax}
+        exp[#exp + 1] = {'le', dy, smin}
     elseif smax > 0 then
-        exp[#exp + 1] = smt.ge(dy, smin)
-        exp[#exp + 1] = smt.le(dy, dist)
+        exp[#exp + 1] = {'ge', dy, smin}
+        exp[#exp + 1] = {'le', dy, dist}
     else
-        exp[#exp + 1] = smt.ge(dy, smt.neg(dist))
-        exp[#exp + 1] = smt.le(dy, smax)
+        exp[#exp + 1] = {'ge', dy, -dist}
+        exp[#exp + 1] = {'le', dy, smax}
     end
     
     return exp
@@ -133,18 +344,18 @@ function rcc.dcon(item1, item2, a, d)
     assert(not a or _t == 'number' or _t == 'string', 'Wrong type for argument a.')
     assert(not d or type(d) == 'number', 'Wrong type for argument d.')
     
-    local exp = smt.lor{
-                    smt.gt(item1.xi, item2.xe),
-                    smt.lt(item1.xe, item2.xi),
-                    smt.gt(item1.yi, item2.ye),
-                    smt.lt(item1.ye, item2.yi)
+    local exp = {'or',
+                    {'gt', item1.xi, item2.xe},
+                    {'lt', item1.xe, item2.xi},
+                    {'gt', item1.yi, item2.ye},
+                    {'lt', item1.ye, item2.yi}
                 }
     if a and d then
         local t = angle(item1, item2, a, d)
         t[#t + 1] = exp
-        return smt.land(t), SCENARIO.S
+        return compile(item1, item2, {'and', unpack(t)}), SCENARIO.S
     else
-        return exp, SCENARIO.S
+        return compile(item1, item2, exp), SCENARIO.S
     end
 end
 
@@ -178,30 +389,30 @@ function rcc.econ(item1, item2, a, d)
     assert(not a or _t == 'number' or _t == 'string', 'Wrong type for argument a.')
     assert(not d or type(d) == 'number', 'Wrong type for argument d.')
     
-    local exp = smt.lor{
-                    smt.land{
-                        smt.lor{
-                            smt.eq(item1.xi, item2.xe),
-                            smt.eq(item1.xe, item2.xi)
+    local exp = {'or',
+                    {'and',
+                        {'or',
+                            {'eq', item1.xi, item2.xe},
+                            {'eq', item1.xe, item2.xi}
                         },
-                        smt.le(item1.yi, item2.ye),
-                        smt.ge(item1.ye, item2.yi)
+                        {'le', item1.yi, item2.ye},
+                        {'ge', item1.ye, item2.yi}
                     },
-                    smt.land{
-                        smt.lor{
-                            smt.eq(item1.yi, item2.ye),
-                            smt.eq(item1.ye, item2.yi)
+                    {'and',
+                        {'or',
+                            {'eq', item1.yi, item2.ye},
+                            {'eq', item1.ye, item2.yi}
                         },
-                        smt.le(item1.xi, item2.xe),
-                        smt.ge(item1.xe, item2.xi)
+                        {'le', item1.xi, item2.xe},
+                        {'ge', item1.xe, item2.xi}
                     }
                 }
     if a and d then
         local t = angle(item1, item2, a, d)
         t[#t + 1] = exp
-        return smt.land(t), SCENARIO.S
+        return compile(item1, item2, {'and', unpack(t)}), SCENARIO.S
     else
-        return exp, SCENARIO.S
+        return compile(item1, item2, exp), SCENARIO.S
     end
 end
 
@@ -235,42 +446,42 @@ function rcc.pover(item1, item2, a, d)
     assert(not a or _t == 'number' or _t == 'string', 'Wrong type for argument a.')
     assert(not d or type(d) == 'number', 'Wrong type for argument d.')
     
-    local exp = smt.lor{
-                    smt.land{
-                        smt.lt(item1.xi, item2.xi),
-                        smt.gt(item1.xe, item2.xi),
-                        smt.lt(item1.xe, item2.xe),
-                        smt.lt(item1.yi, item2.ye),
-                        smt.gt(item1.ye, item2.yi)
+    local exp = {'or',
+                    {'and',
+                        {'lt', item1.xi, item2.xi},
+                        {'gt', item1.xe, item2.xi},
+                        {'lt', item1.xe, item2.xe},
+                        {'lt', item1.yi, item2.ye},
+                        {'gt', item1.ye, item2.yi}
                     },
-                    smt.land{
-                        smt.gt(item1.xi, item2.xi),
-                        smt.lt(item1.xi, item2.xe),
-                        smt.gt(item1.xe, item2.xe),
-                        smt.lt(item1.yi, item2.ye),
-                        smt.gt(item1.ye, item2.yi)
+                    {'and',
+                        {'gt', item1.xi, item2.xi},
+                        {'lt', item1.xi, item2.xe},
+                        {'gt', item1.xe, item2.xe},
+                        {'lt', item1.yi, item2.ye},
+                        {'gt', item1.ye, item2.yi}
                     },
-                    smt.land{
-                        smt.lt(item1.yi, item2.yi),
-                        smt.gt(item1.ye, item2.yi),
-                        smt.lt(item1.ye, item2.ye),
-                        smt.lt(item1.xi, item2.xe),
-                        smt.gt(item1.xe, item2.xi)
+                    {'and',
+                        {'lt', item1.yi, item2.yi},
+                        {'gt', item1.ye, item2.yi},
+                        {'lt', item1.ye, item2.ye},
+                        {'lt', item1.xi, item2.xe},
+                        {'gt', item1.xe, item2.xi}
                     },
-                    smt.land{
-                        smt.gt(item1.yi, item2.yi),
-                        smt.lt(item1.yi, item2.ye),
-                        smt.gt(item1.ye, item2.ye),
-                        smt.lt(item1.xi, item2.xe),
-                        smt.gt(item1.xe, item2.xi)
+                    {'and',
+                        {'gt', item1.yi, item2.yi},
+                        {'lt', item1.yi, item2.ye},
+                        {'gt', item1.ye, item2.ye},
+                        {'lt', item1.xi, item2.xe},
+                        {'gt', item1.xe, item2.xi}
                     }
                 }
     if a and d then
         local t = angle(item1, item2, a, d)
         t[#t + 1] = exp
-        return smt.land(t), SCENARIO.S
+        return compile(item1, item2, {'and', unpack(t)}), SCENARIO.S
     else
-        return exp, SCENARIO.S
+        return compile(item1, item2, exp), SCENARIO.S
     end
 end
 
@@ -308,35 +519,35 @@ function rcc.tpp(item1, item2, a, d)
     if a and d then
         exp = angle(item1, item2, a, d)
     end
-    exp[#exp + 1] = smt.lor{
-                        smt.land{
-                            smt.lt(item1.xs, item2.xs),
-                            smt.le(item1.ys, item2.ys)
+    exp[#exp + 1] = {'or',
+                        {'and',
+                            {'lt', item1.xs, item2.xs},
+                            {'le', item1.ys, item2.ys}
                         },
-                        smt.land{
-                            smt.le(item1.xs, item2.xs),
-                            smt.lt(item1.ys, item2.ys)
+                        {'and',
+                            {'le', item1.xs, item2.xs},
+                            {'lt', item1.ys, item2.ys}
                         }
                     }
-    exp[#exp + 1] = smt.lor{
-                        smt.land{
-                            smt.lor{
-                                smt.eq(item1.xi, item2.xi),
-                                smt.eq(item1.xe, item2.xe)
+    exp[#exp + 1] = {'or',
+                        {'and',
+                            {'or',
+                                {'eq', item1.xi, item2.xi},
+                                {'eq', item1.xe, item2.xe}
                             },
-                            smt.ge(item1.yi, item2.yi),
-                            smt.le(item1.ye, item2.ye)
+                            {'ge', item1.yi, item2.yi},
+                            {'le', item1.ye, item2.ye}
                         },
-                        smt.land{
-                            smt.lor{
-                                smt.eq(item1.yi, item2.yi),
-                                smt.eq(item1.ye, item2.ye)
+                        {'and',
+                            {'or',
+                                {'eq', item1.yi, item2.yi},
+                                {'eq', item1.ye, item2.ye}
                             },
-                            smt.ge(item1.xi, item2.xi),
-                            smt.le(item1.xe, item2.xe)
+                            {'ge', item1.xi, item2.xi},
+                            {'le', item1.xe, item2.xe}
                         }
                     }
-    return smt.land(exp), SCENARIO.S
+    return compile(item1, item2, {'and', unpack(exp)}), SCENARIO.S
 end
 
 
@@ -373,11 +584,11 @@ function rcc.ntpp(item1, item2, a, d)
     if a and d then
         exp = angle(item1, item2, a, d)
     end
-    exp[#exp + 1] = smt.gt(item1.xi, item2.xi)
-    exp[#exp + 1] = smt.lt(item1.xe, item2.xe)
-    exp[#exp + 1] = smt.gt(item1.yi, item2.yi)
-    exp[#exp + 1] = smt.lt(item1.ye, item2.ye)
-    return smt.land(exp), SCENARIO.S
+    exp[#exp + 1] = {'gt', item1.xi, item2.xi}
+    exp[#exp + 1] = {'lt', item1.xe, item2.xe}
+    exp[#exp + 1] = {'gt', item1.yi, item2.yi}
+    exp[#exp + 1] = {'lt', item1.ye, item2.ye}
+    return compile(item1, item2, {'and', unpack(exp)}), SCENARIO.S
 end
 
 
@@ -401,12 +612,12 @@ function rcc.equal(item1, item2)
     assert(typeof(item1) == 'item', 'Wrong type for argument item1.')
     assert(typeof(item2) == 'item', 'Wrong type for argument item2.')
     
-    return smt.land{
-                smt.eq(item1.xi, item2.xi),
-                smt.eq(item1.xe, item2.xe),
-                smt.eq(item1.yi, item2.yi),
-                smt.eq(item1.ye, item2.ye)
-            }, SCENARIO.S
+    return compile(item1, item2, {'and',
+                {'eq', item1.xi, item2.xi},
+                {'eq', item1.xe, item2.xe},
+                {'eq', item1.yi, item2.yi},
+                {'eq', item1.ye, item2.ye}
+            }), SCENARIO.S
 end
 
 
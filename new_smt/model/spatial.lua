@@ -30,6 +30,8 @@ spatial.BORD = enum{'OUT_INIT', 'INIT', 'CENTER', 'END', 'OUT_END', 'OUT'}
 -- @treturn term Term representing the expression among item regions.
 -- @treturn scenario The type of the relation. It is either
 -- `SCENARIO.T` or `SCENARIO.S`.
+-- @treturn table The sides `{a, b, d}` of the equality `a = b + d`
+-- (see `model:equate`).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -50,12 +52,13 @@ function spatial.same_size(item1, item2, axis, d)
         var1 = item1.ys
         var2 = item2.ys
     end
+    local equality = {var1, var2, d}
     
     if d then
         var2 = smt.sum{var2, smt.real(d)}
     end
     
-    return smt.eq(var1, var2), SCENARIO.S
+    return smt.eq(var1, var2), SCENARIO.S, equality
 end
 
 
@@ -153,6 +156,8 @@ end
 -- @treturn term Term representing the expression among item regions.
 -- @treturn scenario The type of the relation. It is either
 -- `SCENARIO.T` or `SCENARIO.S`.
+-- @treturn table The sides `{a, b}` of the equality `a = b` (see
+-- `model:equate`).
 -- 
 -- @raise Error if one of the following occurs:
 --
@@ -193,7 +198,7 @@ function spatial.align(item1, item2, axis, bord)
         error('spatial.BORD option not supported', 2)
     end
     
-    return smt.eq(item1[var1], item2[var2]), SCENARIO.S
+    return smt.eq(item1[var1], item2[var2]), SCENARIO.S, {item1[var1], item2[var2]}
 end
 
 